@@ -43,7 +43,7 @@ $build_system_modules[:gtest] = {
         description("Build the unit tests executable for '#{app}'").
         aliases("unit_tests_#{app}").
         sources([ "tests/unit/#{app}" ], :type => :dir).
-        libraries(gtest_libs[app], :mtxunittest, $common_libs, :gtest, :pthread).
+        libraries(gtest_libs[app], :mtxunittest, $common_libs, :flac, :gtest, :pthread).
         create
     end
   end,
@@ -20,22 +20,32 @@
 class bit_cursor_c {
 private:
   const unsigned char *m_end_of_data;
-  const unsigned char *m_byte_position;
+  const unsigned char *m_byte_position; // next byte to load into the cache
   const unsigned char *m_start_of_data;
-  unsigned int m_bits_valid;
+  uint64_t m_cache;                     // unread bits, MSB first; unused bits are 0
+  unsigned int m_cache_bits;
   bool m_out_of_data;
 
+  // Used when reading an AVC/HEVC NALU as RBSP: emulation prevention
+  // bytes (the 0x03 in 00 00 03) are skipped while reading.
+  bool m_skip_emulation_prevention;
+  unsigned int m_num_zero_bytes, m_num_skipped_bytes;
+
 public:
-  bit_cursor_c(const unsigned char *data, unsigned int len) {
-    init(data, len);
+  bit_cursor_c(const unsigned char *data, unsigned int len, bool skip_emulation_prevention = false) {
+    init(data, len, skip_emulation_prevention);
   }
 
-  void init(const unsigned char *data, unsigned int len) {
-    m_end_of_data   = data + len;
-    m_byte_position = data;
-    m_start_of_data = data;
-    m_bits_valid    = 8;
-    m_out_of_data   = m_byte_position >= m_end_of_data;
+  void init(const unsigned char *data, unsigned int len, bool skip_emulation_prevention = false) {
+    m_end_of_data               = data + len;
+    m_byte_position             = data;
+    m_start_of_data             = data;
+    m_cache                     = 0;
+    m_cache_bits                = 0;
+    m_out_of_data               = m_byte_position >= m_end_of_data;
+    m_skip_emulation_prevention = skip_emulation_prevention;
+    m_num_zero_bytes            = 0;
+    m_num_skipped_bytes         = 0;
   }
 
   bool eof() {
@@ -43,34 +53,24 @@ public:
   }
 
   uint64_t get_bits(unsigned int n) {
-    uint64_t r = 0;
-
-    while (n > 0) {
-      if (m_byte_position >= m_end_of_data) {
-        m_out_of_data = true;
-        throw mtx::mm_io::end_of_file_x();
-      }
-
-      unsigned int b = 8; // number of bits to extract from the current byte
-      if (b > n)
-        b = n;
-      if (b > m_bits_valid)
-        b = m_bits_valid;
-
-      unsigned int rshift = m_bits_valid - b;
-
-      r <<= b;
-      r  |= ((*m_byte_position) >> rshift) & (0xff >> (8 - b));
+    if (32 < n) {
+      uint64_t r = get_bits(n - 32) << 32;
+      return r | get_bits(32);
+    }
 
-      m_bits_valid -= b;
-      if (0 == m_bits_valid) {
-        m_bits_valid     = 8;
-        m_byte_position += 1;
-      }
+    if (0 == n)
+      return 0;
 
-      n -= b;
+    if (m_cache_bits < n) {
+      refill();
+      if (m_cache_bits < n)
+        out_of_data();
     }
 
+    uint64_t r     = m_cache >> (64 - n);
+    m_cache      <<= n;
+    m_cache_bits  -= n;
+
     return r;
   }
 
@@ -94,36 +94,40 @@ public:
     return get_bits(1) + 1;
   }
 
-  uint64_t peek_bits(unsigned int n) {
-    uint64_t r                             = 0;
-    const unsigned char *tmp_byte_position = m_byte_position;
-    unsigned int tmp_bits_valid            = m_bits_valid;
+  // Exp-Golomb coded ue(v) and se(v) values as used by AVC
+  uint64_t get_unsigned_golomb() {
+    if (32 > m_cache_bits)
+      refill();
 
-    while (0 < n) {
-      if (tmp_byte_position >= m_end_of_data)
-        throw mtx::mm_io::end_of_file_x();
+    unsigned int num_zeros = m_cache ? count_leading_zeros(m_cache) : 64;
+    if ((32 > num_zeros) && ((2 * num_zeros + 1) <= m_cache_bits)) {
+      unsigned int num_bits = 2 * num_zeros + 1;
+      uint64_t value        = m_cache >> (64 - num_bits);
+      m_cache             <<= num_bits;
+      m_cache_bits         -= num_bits;
 
-      unsigned int b = 8; // number of bits to extract from the current byte
-      if (b > n)
-        b = n;
-      if (b > tmp_bits_valid)
-        b = tmp_bits_valid;
+      return value - 1;
+    }
 
-      unsigned int rshift = tmp_bits_valid - b;
+    num_zeros = 0;
+    while (!get_bit())
+      ++num_zeros;
 
-      r <<= b;
-      r  |= ((*tmp_byte_position) >> rshift) & (0xff >> (8 - b));
+    // No valid syntax element is that long.
+    if (63 < num_zeros)
+      throw mtx::mm_io::end_of_file_x();
 
-      tmp_bits_valid -= b;
-      if (0 == tmp_bits_valid) {
-        tmp_bits_valid     = 8;
-        tmp_byte_position += 1;
-      }
+    return (1ull << num_zeros) - 1 + get_bits(num_zeros);
+  }
 
-      n -= b;
-    }
+  int64_t get_signed_golomb() {
+    int64_t value = get_unsigned_golomb();
+    return value & 1 ? (value + 1) / 2 : -(value / 2);
+  }
 
-    return r;
+  uint64_t peek_bits(unsigned int n) {
+    bit_cursor_c tmp(*this);
+    return tmp.get_bits(n);
   }
 
   void get_bytes(unsigned char *buf, size_t n) {
@@ -133,34 +137,123 @@ public:
   }
 
   void byte_align() {
-    if (8 == m_bits_valid)
+    // Only whole bytes are loaded into the cache.
+    unsigned int num_bits = m_cache_bits % 8;
+    if (0 == num_bits)
       return;
 
     if (m_out_of_data)
       throw mtx::mm_io::end_of_file_x();
 
-    m_bits_valid     = 0;
-    m_byte_position += 1;
+    m_cache      <<= num_bits;
+    m_cache_bits  -= num_bits;
   }
 
   void set_bit_position(unsigned int pos) {
+    if (m_skip_emulation_prevention) {
+      // The RBSP size isn't known without scanning the whole buffer;
+      // therefore walk forward from the closest known position.
+      if (pos < static_cast<unsigned int>(get_bit_position()))
+        init(m_start_of_data, m_end_of_data - m_start_of_data, true);
+
+      for (unsigned int to_skip = pos - get_bit_position(); 0 < to_skip; to_skip -= std::min(to_skip, 32u))
+        get_bits(std::min(to_skip, 32u));
+
+      return;
+    }
+
     if (pos >= (static_cast<unsigned int>(m_end_of_data - m_start_of_data) * 8)) {
       m_byte_position = m_end_of_data;
+      m_cache         = 0;
+      m_cache_bits    = 0;
       m_out_of_data   = true;
 
       throw mtx::mm_io::end_of_file_x();
     }
 
     m_byte_position = m_start_of_data + (pos / 8);
-    m_bits_valid    = 8 - (pos % 8);
+    m_cache         = 0;
+    m_cache_bits    = 0;
+
+    if (pos % 8) {
+      refill();
+      m_cache      <<= pos % 8;
+      m_cache_bits  -= pos % 8;
+    }
   }
 
   int get_bit_position() {
-    return (m_byte_position - m_start_of_data) * 8 + 8 - m_bits_valid;
+    return (m_byte_position - m_start_of_data - m_num_skipped_bytes) * 8 - m_cache_bits;
   }
 
   void skip_bits(unsigned int num) {
-    set_bit_position(get_bit_position() + num);
+    if (num >= m_cache_bits) {
+      set_bit_position(get_bit_position() + num);
+      return;
+    }
+
+    m_cache      <<= num;
+    m_cache_bits  -= num;
+  }
+
+private:
+  // Loads whole bytes until the cache holds more than 56 bits or all
+  // data has been loaded.
+  void refill() {
+    if (!m_skip_emulation_prevention && (8 <= (m_end_of_data - m_byte_position))) {
+      auto p             = m_byte_position;
+      uint64_t value     =  (static_cast<uint64_t>(p[0]) << 56) | (static_cast<uint64_t>(p[1]) << 48) | (static_cast<uint64_t>(p[2]) << 40) | (static_cast<uint64_t>(p[3]) << 32)
+                          | (static_cast<uint64_t>(p[4]) << 24) | (static_cast<uint64_t>(p[5]) << 16) | (static_cast<uint64_t>(p[6]) <<  8) |  static_cast<uint64_t>(p[7]);
+      unsigned int bytes = (63 - m_cache_bits) / 8;
+
+      m_cache_bits      += bytes * 8;
+      m_cache           |= (value >> (m_cache_bits - bytes * 8)) & ~(~0ull >> m_cache_bits);
+      m_byte_position   += bytes;
+
+      return;
+    }
+
+    while ((56 >= m_cache_bits) && (m_byte_position < m_end_of_data)) {
+      m_cache      |= static_cast<uint64_t>(*m_byte_position) << (56 - m_cache_bits);
+      m_cache_bits += 8;
+      next_byte();
+    }
+  }
+
+  void next_byte() {
+    if (!m_skip_emulation_prevention) {
+      ++m_byte_position;
+      return;
+    }
+
+    m_num_zero_bytes = *m_byte_position ? 0 : m_num_zero_bytes + 1;
+    ++m_byte_position;
+
+    if ((2 <= m_num_zero_bytes) && (m_byte_position < m_end_of_data) && (0x03 == *m_byte_position)) {
+      ++m_byte_position;
+      ++m_num_skipped_bytes;
+      m_num_zero_bytes = 0;
+    }
+  }
+
+  void out_of_data() {
+    m_byte_position = m_end_of_data;
+    m_cache         = 0;
+    m_cache_bits    = 0;
+    m_out_of_data   = true;
+
+    throw mtx::mm_io::end_of_file_x();
+  }
+
+  static unsigned int count_leading_zeros(uint64_t value) {
+#if defined(__GNUC__)
+    return __builtin_clzll(value);
+#else
+    unsigned int num_zeros = 0;
+    for (; !(value & 0x8000000000000000ull); value <<= 1)
+      ++num_zeros;
+    return num_zeros;
+#endif
   }
 };
 
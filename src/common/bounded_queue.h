@@ -0,0 +1,90 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a bounded lock-free queue for one producer and one consumer thread
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_BOUNDED_QUEUE_H
+#define MTX_COMMON_BOUNDED_QUEUE_H
+
+#include "common/common_pch.h"
+
+#include <atomic>
+
+/** \brief A queue with a fixed capacity that doesn't use locks
+
+   Exactly one thread may call \c push() and exactly one other thread
+   may call \c pop(). Neither of them ever blocks: \c push() fails if
+   the queue is full and \c pop() fails if it is empty. Waiting for
+   the other thread is up to the caller.
+*/
+template<typename T>
+class bounded_queue_c {
+protected:
+  std::vector<T> m_slots;
+  // Both only ever increase. m_tail is only written by the producer
+  // and m_head only by the consumer.
+  std::atomic<size_t> m_head, m_tail;
+
+public:
+  bounded_queue_c(size_t capacity)
+    : m_slots(capacity)
+    , m_head(0)
+    , m_tail(0)
+  {
+  }
+
+  bounded_queue_c(bounded_queue_c const &) = delete;
+  bounded_queue_c &operator =(bounded_queue_c const &) = delete;
+
+  bool push(T const &value) {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    if ((tail - m_head.load(std::memory_order_acquire)) == m_slots.size())
+      return false;
+
+    m_slots[tail % m_slots.size()] = value;
+    m_tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool pop(T &value) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+
+    // Don't keep a reference to the popped value in the slot.
+    auto &slot = m_slots[head % m_slots.size()];
+    value      = std::move(slot);
+    slot       = T{};
+    m_head.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Only exact if neither push() nor pop() are running at the same time.
+  size_t size() const {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return !size();
+  }
+
+  bool full() const {
+    return size() >= m_slots.size();
+  }
+
+  size_t capacity() const {
+    return m_slots.size();
+  }
+};
+
+#endif  // MTX_COMMON_BOUNDED_QUEUE_H
@@ -18,11 +18,23 @@
 
 #include "common/memory.h"
 
+/* A FIFO of bytes that always offers the unconsumed data as one
+   contiguous block.
+
+   remove() only advances the start of that block; consumed data is
+   never moved right away. The space in front of the block is reclaimed
+   in add() once there's no room left at the end, and only if at least
+   as much data has been consumed as has to be moved. Otherwise the
+   buffer grows. This way the number of bytes moved never exceeds the
+   number of bytes consumed instead of all data being moved on every
+   remove().
+*/
 class byte_buffer_c {
 private:
   unsigned char *m_data;
   size_t m_filled, m_offset, m_size, m_chunk_size;
   size_t m_num_reallocs, m_max_alloced_size;
+  uint64_t m_num_moves, m_num_moved_bytes, m_num_removed_bytes;
 
 public:
   byte_buffer_c(size_t chunk_size = 128 * 1024)
@@ -33,6 +45,9 @@ public:
     , m_chunk_size(chunk_size)
     , m_num_reallocs(1)
     , m_max_alloced_size(chunk_size)
+    , m_num_moves(0)
+    , m_num_moved_bytes(0)
+    , m_num_removed_bytes(0)
   {
   };
 
@@ -40,13 +55,10 @@ public:
     safefree(m_data);
   }
 
+  // Moves the data to the front and releases unneeded memory.
   void trim() {
-    if (m_offset == 0)
-      return;
+    move_to_front();
 
-    memmove(m_data, &m_data[m_offset], m_filled);
-
-    m_offset        = 0;
     size_t new_size = (m_filled / m_chunk_size + 1) * m_chunk_size;
 
     if (new_size != m_size) {
@@ -57,15 +69,12 @@ public:
     }
   }
 
-  void add(const unsigned char *new_data, int new_size) {
-    if ((m_offset != 0) && ((m_offset + m_filled + new_size) >= m_chunk_size))
-      trim();
+  void add(const unsigned char *new_data, size_t new_size) {
+    if (!new_size)
+      return;
 
-    if ((m_offset + m_filled + new_size) > m_size) {
-      m_size = ((m_offset + m_filled + new_size) / m_chunk_size + 1) * m_chunk_size;
-      m_data = saferealloc(m_data, m_size);
-      count_alloc(m_size);
-    }
+    if ((m_offset + m_filled + new_size) > m_size)
+      make_room(new_size);
 
     memcpy(&m_data[m_offset + m_filled], new_data, new_size);
     m_filled += new_size;
@@ -78,11 +87,13 @@ public:
   void remove(size_t num) {
     if (num > m_filled)
       mxerror("byte_buffer_c: num > m_filled. Should not have happened. Please file a bug report.\n");
-    m_offset += num;
-    m_filled -= num;
+    m_offset            += num;
+    m_filled            -= num;
+    m_num_removed_bytes += num;
 
-    if (m_filled >= m_chunk_size)
-      trim();
+    // Nothing left: start at the front again without moving anything.
+    if (!m_filled)
+      m_offset = 0;
   }
 
   unsigned char *get_buffer() {
@@ -98,7 +109,61 @@ public:
     trim();
   }
 
+  uint64_t get_num_moves() const {
+    return m_num_moves;
+  }
+
+  uint64_t get_num_moved_bytes() const {
+    return m_num_moved_bytes;
+  }
+
+  // The bytes consumed without having to move the remaining data
+  // directly afterwards.
+  uint64_t get_num_removed_bytes() const {
+    return m_num_removed_bytes;
+  }
+
 private:
+  void move_to_front() {
+    if (!m_offset)
+      return;
+
+    if (m_filled) {
+      memmove(m_data, &m_data[m_offset], m_filled);
+      ++m_num_moves;
+      m_num_moved_bytes += m_filled;
+    }
+
+    m_offset = 0;
+  }
+
+  void make_room(size_t num) {
+    if ((m_offset >= m_filled) && ((m_filled + num) <= m_size)) {
+      move_to_front();
+      return;
+    }
+
+    // Leave at least as much room behind the data as it occupies so
+    // that the next call can usually reclaim the consumed space
+    // instead of growing again.
+    size_t new_size = ((2 * m_filled + num) / m_chunk_size + 1) * m_chunk_size;
+
+    if (!m_offset)
+      m_data = saferealloc(m_data, new_size);
+
+    else {
+      // Only copy the data that hasn't been consumed yet.
+      unsigned char *new_data = safemalloc(new_size);
+      memcpy(new_data, &m_data[m_offset], m_filled);
+      safefree(m_data);
+
+      m_data   = new_data;
+      m_offset = 0;
+    }
+
+    m_size = new_size;
+    count_alloc(new_size);
+  }
 
   void count_alloc(size_t filled) {
     ++m_num_reallocs;
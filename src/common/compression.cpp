@@ -20,6 +20,7 @@
 #include "common/ebml.h"
 #include "common/endian.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 
 using namespace libmatroska;
 
@@ -52,6 +53,17 @@ compressor_c::~compressor_c() {
          % raw_size % compressed_size % items % (compressed_size * 100.0 / raw_size) % (compressed_size / items));
 }
 
+void
+compressor_c::take_statistics(compressor_c &other) {
+  raw_size        += other.raw_size;
+  compressed_size += other.compressed_size;
+  items           += other.items;
+
+  other.raw_size        = 0;
+  other.compressed_size = 0;
+  other.items           = 0;
+}
+
 void
 compressor_c::set_track_headers(KaxContentEncoding &c_encoding) {
   KaxContentCompression *c_comp = &GetChild<KaxContentCompression>(c_encoding);
@@ -141,3 +153,58 @@ compressor_c::decompress(std::string const &buffer) {
   auto new_buffer = decompress(memory_cptr(new memory_c(const_cast<char *>(&buffer[0]), buffer.length(), false)));
   return std::string(reinterpret_cast<char const *>(new_buffer->get_buffer()), new_buffer->get_size());
 }
+
+// ------------------------------------------------------------
+
+async_compressor_c::async_compressor_c(compression_method_e method)
+  : m_method(method)
+{
+}
+
+async_compressor_c::~async_compressor_c() {
+  // All jobs have finished as they keep this object alive.
+  size_t idx;
+  for (idx = 1; m_idle_compressors.size() > idx; ++idx)
+    m_idle_compressors[0]->take_statistics(*m_idle_compressors[idx]);
+}
+
+bool
+async_compressor_c::is_supported(compression_method_e method) {
+  return (COMPRESSION_ZLIB == method) || (COMPRESSION_BZ2 == method) || (COMPRESSION_LZO == method);
+}
+
+compressor_ptr
+async_compressor_c::acquire_compressor() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_idle_compressors.empty()) {
+      compressor_ptr compressor = m_idle_compressors.back();
+      m_idle_compressors.pop_back();
+      return compressor;
+    }
+  }
+
+  return compressor_c::create(m_method);
+}
+
+void
+async_compressor_c::release_compressor(compressor_ptr const &compressor) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_idle_compressors.push_back(compressor);
+}
+
+std::future<memory_cptr>
+async_compressor_c::compress(memory_cptr const &buffer) {
+  auto self = shared_from_this();
+  auto task = std::make_shared< std::packaged_task<memory_cptr()> >([self, buffer]() -> memory_cptr {
+    compressor_ptr compressor = self->acquire_compressor();
+    memory_cptr result        = compressor->compress(buffer);
+    self->release_compressor(compressor);
+    return result;
+  });
+
+  auto result = task->get_future();
+  thread_pool_c::global().enqueue([task]() { (*task)(); });
+
+  return result;
+}
@@ -16,6 +16,9 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+#include <mutex>
+
 #include <matroska/KaxContentEncoding.h>
 
 /* compression types */
@@ -83,6 +86,10 @@ public:
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
+  // Adds the other compressor's statistics to this one's and resets
+  // the other's so that they're only output once.
+  void take_statistics(compressor_c &other);
+
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
   static compressor_ptr create_from_file_name(std::string const &file_name);
@@ -96,6 +103,37 @@ protected:
   }
 };
 
+/** \brief Compresses buffers on the global thread pool
+
+   Each job uses a compressor of its own so that the compressors'
+   state doesn't have to be protected. Idle compressors are re-used
+   by later jobs. The jobs keep the object alive until they've
+   finished even if the caller drops its reference. The compressors'
+   statistics are combined and output once like those of a single
+   compressor.
+*/
+class async_compressor_c: public std::enable_shared_from_this<async_compressor_c> {
+protected:
+  compression_method_e m_method;
+  std::vector<compressor_ptr> m_idle_compressors;
+  std::mutex m_mutex;
+
+public:
+  async_compressor_c(compression_method_e method);
+  ~async_compressor_c();
+
+  // The buffer must not be modified until the result is available.
+  std::future<memory_cptr> compress(memory_cptr const &buffer);
+
+  // Only methods that are expensive enough are worth the hand-over.
+  static bool is_supported(compression_method_e method);
+
+protected:
+  compressor_ptr acquire_compressor();
+  void release_compressor(compressor_ptr const &compressor);
+};
+typedef std::shared_ptr<async_compressor_c> async_compressor_cptr;
+
 #include "common/compression/bzlib.h"
 #include "common/compression/header_removal.h"
 #include "common/compression/lzo.h"
@@ -16,6 +16,7 @@
 #include "common/content_decoder.h"
 #include "common/ebml.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 
 kax_content_encoding_t::kax_content_encoding_t()
   : order(0)
@@ -175,6 +176,66 @@ content_decoder_c::reverse(memory_cptr &memory,
       memory = ce.compressor->decompress(memory);
 }
 
+/** \brief Decodes several buffers on the global thread pool
+
+   The buffers are split between up to one job per worker thread. The
+   function returns once all of them have been decoded. Decompression
+   doesn't modify the compressors' state, so the jobs can share them.
+   The buffers are decoded on the calling thread if no encoding is
+   expensive enough to make the hand-over worthwhile.
+*/
+void
+content_decoder_c::reverse(std::vector<memory_cptr> &buffers,
+                           content_encoding_scope_e scope) {
+  if (!is_ok() || encodings.empty() || buffers.empty())
+    return;
+
+  size_t num_jobs = std::min(buffers.size(), thread_pool_c::global().get_num_threads());
+
+  if ((2 > num_jobs) || !has_expensive_encodings(scope)) {
+    for (auto &buffer : buffers)
+      reverse(buffer, scope);
+    return;
+  }
+
+  std::vector<std::future<void> > results;
+  size_t job;
+  for (job = 0; num_jobs > job; ++job) {
+    auto task = std::make_shared< std::packaged_task<void()> >([this, &buffers, scope, job, num_jobs]() {
+      size_t idx;
+      for (idx = job; buffers.size() > idx; idx += num_jobs)
+        reverse(buffers[idx], scope);
+    });
+
+    results.push_back(task->get_future());
+    thread_pool_c::global().enqueue([task]() { (*task)(); });
+  }
+
+  // All jobs must be done with the buffers before an exception may be
+  // passed on.
+  for (auto &result : results)
+    result.wait();
+  for (auto &result : results)
+    get_job_result(result);
+}
+
+bool
+content_decoder_c::has_expensive_encodings(content_encoding_scope_e scope) {
+  for (auto &ce : encodings)
+    if ((0 != (ce.scope & scope)) && async_compressor_c::is_supported(ce.compressor->get_method()))
+      return true;
+
+  return false;
+}
+
+// Used when the data in that scope is decoded by someone else, e.g. in
+// batches by the caller before it is handed over.
+void
+content_decoder_c::remove_scope(content_encoding_scope_e scope) {
+  for (auto &ce : encodings)
+    ce.scope &= ~scope;
+}
+
 std::string
 content_decoder_c::descriptive_algorithm_list() {
   std::string list;
@@ -52,6 +52,9 @@ public:
 
   bool initialize(KaxTrackEntry &ktentry);
   void reverse(memory_cptr &data, content_encoding_scope_e scope);
+  void reverse(std::vector<memory_cptr> &data, content_encoding_scope_e scope);
+  bool has_expensive_encodings(content_encoding_scope_e scope);
+  void remove_scope(content_encoding_scope_e scope);
   bool is_ok() {
     return ok;
   }
@@ -19,6 +19,7 @@
 #include "common/bit_cursor.h"
 #include "common/dirac.h"
 #include "common/endian.h"
+#include "common/start_code.h"
 
 dirac::sequence_header_t::sequence_header_t() {
   memset(this, 0, sizeof(dirac::sequence_header_t));
@@ -218,67 +219,57 @@ dirac::es_parser_c::~es_parser_c() {
 void
 dirac::es_parser_c::add_bytes(unsigned char *buffer,
                               size_t size) {
-  memory_slice_cursor_c cursor;
-
-  bool previous_found         = false;
-  size_t previous_pos         = 0;
   int64_t previous_stream_pos = m_stream_pos;
+  size_t unparsed_size        = m_unparsed_buffer ? m_unparsed_buffer->get_size() : 0;
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker = (1 << 24) | ((unsigned int)cursor.get_char() << 16) | ((unsigned int)cursor.get_char() << 8) | (unsigned int)cursor.get_char();
-
-    while (1) {
-      if (DIRAC_SYNC_WORD == marker) {
-        if (!previous_found) {
-          previous_found = true;
-          previous_pos   = cursor.get_position() - 4;
-          m_stream_pos   = previous_stream_pos + previous_pos;
-
-          if (!cursor.char_available())
-            break;
+  memory_cptr data;
+  if (unparsed_size) {
+    m_unparsed_buffer->add(buffer, size);
+    data = m_unparsed_buffer;
+  } else
+    data = memory_cptr(new memory_c(buffer, size, false));
 
-          marker <<= 8;
-          marker  |= (unsigned int)cursor.get_char();
+  unsigned char *start     = data->get_buffer();
+  unsigned char *end       = start + data->get_size();
+  unsigned char *scan_from = start;
+  unsigned char *previous  = nullptr;
 
-          continue;
-        }
+  while (true) {
+    unsigned char *marker = mtx::start_code::find_marker(scan_from, end, DIRAC_SYNC_WORD);
+    if (marker == end)
+      break;
 
-        unsigned char offset_buffer[4];
-        cursor.copy(offset_buffer, previous_pos + 4 + 1, 4);
-        uint32_t next_offset = get_uint32_be(offset_buffer);
+    scan_from = std::max(marker + 1, mtx::start_code::first_unsearched(start, unparsed_size, 4));
 
-        if ((0 == next_offset) || ((previous_pos + next_offset) <= (cursor.get_position() - 4))) {
-          int new_size = cursor.get_position() - 4 - previous_pos;
+    if (!previous) {
+      previous     = marker;
+      m_stream_pos = previous_stream_pos + (previous - start);
+      continue;
+    }
 
-          memory_cptr packet = memory_c::alloc(new_size);
-          cursor.copy(packet->get_buffer(), previous_pos, new_size);
+    if ((previous + 4 + 1 + 4) > end)
+      continue;
 
-          handle_unit(packet);
+    uint32_t next_offset = get_uint32_be(previous + 4 + 1);
 
-          previous_pos = cursor.get_position() - 4;
-          m_stream_pos = previous_stream_pos + previous_pos;
-        }
-      }
+    if ((0 != next_offset) && ((previous + next_offset) > marker))
+      continue;
 
-      if (!cursor.char_available())
-        break;
+    handle_unit(memory_c::clone(previous, marker - previous));
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
-    }
+    previous     = marker;
+    m_stream_pos = previous_stream_pos + (previous - start);
   }
 
-  unsigned int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    memory_cptr new_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(new_unparsed_buffer->get_buffer(), previous_pos, new_size);
-    m_unparsed_buffer = new_unparsed_buffer;
+  size_t previous_pos = previous ? previous - start : 0;
 
-  } else
+  if (!previous_pos && unparsed_size)
+    return;
+
+  size_t new_size = data->get_size() - previous_pos;
+  if (0 != new_size)
+    m_unparsed_buffer = memory_c::clone(start + previous_pos, new_size);
+  else
     m_unparsed_buffer.reset();
 }
 
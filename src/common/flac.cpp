@@ -11,18 +11,239 @@
    Written by Moritz Bunkus <moritz@bunkus.org>.
 */
 
-#include "config.h"
+#include "common/common_pch.h"
 
-#if defined(HAVE_FLAC_FORMAT_H)
+#include "common/checksums.h"
+#include "common/flac.h"
 
-#include "common/common_pch.h"
+flac_frame_parser_c::flac_frame_parser_c()
+  : m_synced(false)
+  , m_scan_pos(0)
+  , m_crc_pos(0)
+  , m_crc(0)
+{
+}
+
+void
+flac_frame_parser_c::add_data(unsigned char const *data,
+                              size_t size) {
+  if (!data || !size)
+    return;
+
+  m_buffer.add(data, size);
+  parse(false);
+}
+
+void
+flac_frame_parser_c::flush() {
+  parse(true);
+}
+
+bool
+flac_frame_parser_c::frame_available()
+  const {
+  return !m_frames.empty();
+}
+
+memory_cptr
+flac_frame_parser_c::get_next_frame() {
+  if (m_frames.empty())
+    return memory_cptr{};
+
+  memory_cptr frame = m_frames.front();
+  m_frames.pop_front();
+
+  return frame;
+}
+
+// See http://flac.sourceforge.net/format.html#frame_header
+bool
+flac_frame_parser_c::decode_header(unsigned char const *buf,
+                                   size_t size,
+                                   header_t &header) {
+  if (   (6 > size)
+      || (0xff != buf[0])
+      || (0xf8 != (buf[1] & 0xfe))
+      || (0xff == buf[4]))
+    return false;
+
+  unsigned int block_size_code  = buf[2] >> 4;
+  unsigned int sample_rate_code = buf[2] & 0x0f;
+  unsigned int channels_code    = buf[3] >> 4;
+  unsigned int sample_size_code = (buf[3] >> 1) & 0x07;
+
+  if (   (0  == block_size_code)
+      || (15 == sample_rate_code)
+      || (10 <  channels_code)
+      || (3  == sample_size_code)
+      || (buf[3] & 0x01))
+    return false;
+
+  // Frame or sample number coded like UTF-8, up to seven bytes
+  unsigned int num_bytes = 0;
+  uint64_t number        = buf[4];
+
+  while ((7 > num_bytes) && (buf[4] & (0x80 >> num_bytes)))
+    ++num_bytes;
+
+  if (1 == num_bytes)
+    return false;
+  if (num_bytes)
+    number &= 0x7f >> num_bytes;
+  else
+    num_bytes = 1;
+
+  size_t pos = 5;
+  for (; (4 + num_bytes) > pos; ++pos) {
+    if ((pos >= size) || (0x80 != (buf[pos] & 0xc0)))
+      return false;
+    number = (number << 6) | (buf[pos] & 0x3f);
+  }
+
+  header.block_size = 1 == block_size_code ? 192
+                    : 5 >= block_size_code ? 576 << (block_size_code - 2)
+                    : 8 <= block_size_code ? 256 << (block_size_code - 8)
+                    :                        0;
+
+  if (6 == block_size_code) {
+    if ((pos + 1) > size)
+      return false;
+    header.block_size = buf[pos] + 1;
+    pos              += 1;
+
+  } else if (7 == block_size_code) {
+    if ((pos + 2) > size)
+      return false;
+    header.block_size = ((buf[pos] << 8) | buf[pos + 1]) + 1;
+    pos              += 2;
+  }
+
+  pos += 12 == sample_rate_code ? 1
+       : 13 <= sample_rate_code ? 2
+       :                          0;
+
+  // The CRC-8 covers the whole header including the CRC itself.
+  if (   ((pos + 1) > size)
+      || crc_calc(crc_get_table(CRC_8_ATM), 0, buf, pos + 1))
+    return false;
+
+  header.variable_block_size = buf[1] & 0x01;
+  header.header_size         = pos + 1;
+  header.number              = number;
+
+  return true;
+}
+
+bool
+flac_frame_parser_c::resync() {
+  unsigned char const *data = m_buffer.get_buffer();
+  size_t size               = m_buffer.get_size();
+  size_t pos;
+
+  for (pos = 0; (pos + max_header_size) <= size; ++pos)
+    if (decode_header(&data[pos], size - pos, m_header)) {
+      m_buffer.remove(pos);
+
+      m_synced   = true;
+      m_scan_pos = m_header.header_size;
+      m_crc_pos  = 0;
+      m_crc      = 0;
+
+      return true;
+    }
+
+  // Keep the tail as it might contain the start of a header.
+  m_buffer.remove(pos);
+
+  return false;
+}
+
+void
+flac_frame_parser_c::update_crc(size_t up_to) {
+  m_crc     = crc_calc(crc_get_table(CRC_16_ANSI), m_crc, m_buffer.get_buffer() + m_crc_pos, up_to - m_crc_pos);
+  m_crc_pos = up_to;
+}
+
+void
+flac_frame_parser_c::parse(bool end_of_stream) {
+  if (!m_synced && !resync())
+    return;
+
+  while (true) {
+    unsigned char const *data = m_buffer.get_buffer();
+    size_t size               = m_buffer.get_size();
+    size_t pos                = m_scan_pos;
+    uint64_t expected_number  = m_header.number + (m_header.variable_block_size ? m_header.block_size : 1);
+    bool found                = false;
+    header_t next;
+
+    for (; (pos + 1) < size; ++pos) {
+      if ((0xff != data[pos]) || (0xf8 != (data[pos + 1] & 0xfe)))
+        continue;
+
+      // Wait for more data before deciding about this one.
+      if (!end_of_stream && ((pos + max_header_size) > size))
+        break;
+
+      if (   !decode_header(&data[pos], size - pos, next)
+          || (next.variable_block_size != m_header.variable_block_size))
+        continue;
+
+      // The CRC-16 covers the whole frame including the CRC itself.
+      update_crc(pos);
+      if (!m_crc || (next.number == expected_number)) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      m_scan_pos = pos;
+      if (end_of_stream)
+        finish();
+      return;
+    }
+
+    m_frames.push_back(memory_c::clone(data, pos));
+    m_buffer.remove(pos);
+
+    m_header   = next;
+    m_scan_pos = next.header_size;
+    m_crc_pos  = 0;
+    m_crc      = 0;
+  }
+}
+
+void
+flac_frame_parser_c::finish() {
+  size_t size = m_buffer.get_size();
+  if (!size)
+    return;
+
+  // Leave out trailing data that isn't part of the last frame
+  // (e.g. ID3 tags) if a shorter part of it has a valid CRC-16.
+  size_t end = size;
+  size_t pos = m_crc_pos;
+
+  while (pos < size) {
+    update_crc(++pos);
+    if (!m_crc && (pos > (m_header.header_size + 2)))
+      end = pos;
+  }
+
+  m_frames.push_back(memory_c::clone(m_buffer.get_buffer(), end));
+  m_buffer.remove(size);
+
+  m_synced = false;
+}
+
+#if defined(HAVE_FLAC_FORMAT_H)
 
 #include <stdarg.h>
 
 #include <FLAC/stream_decoder.h>
 
 #include "common/bit_cursor.h"
-#include "common/flac.h"
 
 static bool
 flac_skip_utf8(bit_cursor_c &bits,
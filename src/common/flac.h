@@ -16,6 +16,54 @@
 
 #include "common/common_pch.h"
 
+#include <deque>
+
+#include "common/byte_buffer.h"
+
+/** \brief Splits a raw FLAC stream into frames
+
+   Frames are found by their sync code. A frame header is only accepted
+   if its CRC-8 is valid. The data in front of it is only taken as the
+   previous frame if that frame's CRC-16 is valid or if the header
+   carries the expected frame or sample number. The stream must not
+   contain the metadata blocks.
+*/
+class flac_frame_parser_c {
+protected:
+  struct header_t {
+    bool variable_block_size;
+    unsigned int block_size, header_size;
+    uint64_t number;
+  };
+
+  static size_t const max_header_size = 16;
+
+  byte_buffer_c m_buffer;
+  std::deque<memory_cptr> m_frames;
+  bool m_synced;
+  header_t m_header;
+  size_t m_scan_pos, m_crc_pos;
+  uint32_t m_crc;
+
+public:
+  flac_frame_parser_c();
+
+  void add_data(unsigned char const *data, size_t size);
+  // Outputs the remaining data as the last frame.
+  void flush();
+
+  bool frame_available() const;
+  memory_cptr get_next_frame();
+
+protected:
+  void parse(bool end_of_stream);
+  bool resync();
+  void finish();
+  void update_crc(size_t up_to);
+
+  static bool decode_header(unsigned char const *buf, size_t size, header_t &header);
+};
+
 #if defined(HAVE_FLAC_FORMAT_H)
 
 #include <FLAC/format.h>
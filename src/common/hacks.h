@@ -36,7 +36,8 @@
 #define ENGAGE_MERGE_TRUEHD_FRAMES          15
 #define ENGAGE_REMOVE_BITSTREAM_AR_INFO     16
 #define ENGAGE_VOBSUB_SUBPIC_STOP_CMDS      17
-#define ENGAGE_MAX_IDX                      ENGAGE_VOBSUB_SUBPIC_STOP_CMDS
+#define ENGAGE_THREADED_READING             18
+#define ENGAGE_MAX_IDX                      ENGAGE_THREADED_READING
 
 void engage_hacks(const std::string &hacks);
 bool hack_engaged(unsigned int id);
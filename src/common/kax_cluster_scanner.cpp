@@ -0,0 +1,442 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   lightweight scanner for the blocks in a Matroska cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxBlockData.h>
+#include <matroska/KaxClusterData.h>
+
+#include "common/ebml.h"
+#include "common/endian.h"
+#include "common/kax_cluster_scanner.h"
+#include "common/vint.h"
+
+namespace {
+
+// Reads an element's ID and size. Elements with an unknown size or
+// ones that exceed the parent's size are not supported.
+bool
+read_element_header(unsigned char const *data,
+                    size_t size,
+                    size_t &pos,
+                    uint32_t &id,
+                    size_t &element_size) {
+  vint_c id_vint = vint_c::read_ebml_id(data + pos, size - pos);
+  if (!id_vint.is_valid())
+    return false;
+
+  vint_c size_vint = vint_c::read(data + pos + id_vint.m_coded_size, size - pos - id_vint.m_coded_size);
+  if (!size_vint.is_valid() || size_vint.is_unknown())
+    return false;
+
+  pos          += id_vint.m_coded_size + size_vint.m_coded_size;
+  id            = id_vint.m_value;
+  element_size  = size_vint.m_value;
+
+  return static_cast<uint64_t>(size_vint.m_value) <= (size - pos);
+}
+
+bool
+read_uint(unsigned char const *data,
+          size_t size,
+          uint64_t &value) {
+  if (8 < size)
+    return false;
+
+  value = 0;
+  for (size_t idx = 0; size > idx; ++idx)
+    value = (value << 8) | data[idx];
+
+  return true;
+}
+
+bool
+read_sint(unsigned char const *data,
+          size_t size,
+          int64_t &value) {
+  if (8 < size)
+    return false;
+
+  value = size && (data[0] & 0x80) ? -1 : 0;
+  for (size_t idx = 0; size > idx; ++idx)
+    value = static_cast<int64_t>((static_cast<uint64_t>(value) << 8) | data[idx]);
+
+  return true;
+}
+
+}
+
+kax_cluster_scanner_c::kax_cluster_scanner_c()
+  : m_tc_scale(TIMECODE_SCALE)
+  , m_timecode(0)
+{
+}
+
+void
+kax_cluster_scanner_c::set_timecode_scale(int64_t tc_scale) {
+  m_tc_scale = tc_scale;
+}
+
+void
+kax_cluster_scanner_c::reset() {
+  m_timecode = 0;
+  m_blocks.clear();
+  m_frames.clear();
+  m_additions.clear();
+}
+
+bool
+kax_cluster_scanner_c::read(mm_io_c &in,
+                            size_t size) {
+  int64_t position = in.getFilePointer();
+
+  if (!m_buffer || (m_buffer->get_size() < size))
+    m_buffer = memory_c::alloc(size);
+
+  if (in.read(m_buffer->get_buffer(), size) != size) {
+    reset();
+    return false;
+  }
+
+  return scan(m_buffer->get_buffer(), size, position);
+}
+
+bool
+kax_cluster_scanner_c::scan(unsigned char const *data,
+                            size_t size,
+                            int64_t position) {
+  reset();
+
+  size_t pos = 0;
+  while (pos < size) {
+    size_t element_start = pos, element_size;
+    uint32_t id;
+
+    if (!read_element_header(data, size, pos, id, element_size))
+      return false;
+
+    if (EBML_ID_VALUE(EBML_ID(KaxSimpleBlock)) == id) {
+      m_blocks.push_back(kax_scanned_block_t());
+      auto &block       = m_blocks.back();
+      block.is_simple   = true;
+      block.block_found = true;
+      block.position    = position + element_start;
+
+      if (!scan_block(data + pos, element_size, block))
+        return false;
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxBlockGroup)) == id) {
+      m_blocks.push_back(kax_scanned_block_t());
+      auto &block    = m_blocks.back();
+      block.position = position + element_start;
+
+      if (!scan_block_group(data + pos, element_size, block))
+        return false;
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxClusterTimecode)) == id) {
+      if (!read_uint(data + pos, element_size, m_timecode))
+        return false;
+    }
+
+    pos += element_size;
+  }
+
+  // The cluster timecode may follow the blocks. Until here the
+  // blocks' timecodes are relative to it.
+  for (auto &block : m_blocks)
+    block.timecode = static_cast<int64_t>(m_timecode * m_tc_scale) + block.timecode * m_tc_scale;
+
+  return true;
+}
+
+bool
+kax_cluster_scanner_c::scan_block(unsigned char const *data,
+                                  size_t size,
+                                  kax_scanned_block_t &block) {
+  vint_c track_number = vint_c::read(data, size);
+  if (!track_number.is_valid() || ((track_number.m_coded_size + 3u) > size))
+    return false;
+
+  auto p             = data + track_number.m_coded_size;
+  auto end           = data + size;
+  block.track_number = track_number.m_value;
+  block.timecode     = static_cast<int16_t>(get_uint16_be(p));
+  unsigned int flags = p[2];
+  p                 += 3;
+
+  if (block.is_simple) {
+    block.keyframe    = 0x80 == (flags & 0x80);
+    block.discardable = 0x01 == (flags & 0x01);
+  }
+
+  block.first_frame = m_frames.size();
+
+  unsigned int lacing = (flags & 0x06) >> 1;
+  if (0 == lacing) {
+    block.num_frames = 1;
+    m_frames.push_back(kax_scanned_frame_t{ p, static_cast<size_t>(end - p) });
+    return true;
+  }
+
+  if (p >= end)
+    return false;
+
+  block.num_frames = static_cast<size_t>(*p) + 1;
+  ++p;
+
+  // Collect the sizes of all but the last frame first.
+  size_t total_size = 0;
+
+  if (1 == lacing) {            // Xiph
+    for (size_t idx = 0; (block.num_frames - 1) > idx; ++idx) {
+      size_t frame_size = 0;
+      do {
+        if (p >= end)
+          return false;
+        frame_size += *p;
+      } while (0xff == *p++);
+
+      m_frames.push_back(kax_scanned_frame_t{ nullptr, frame_size });
+      total_size += frame_size;
+    }
+
+  } else if (3 == lacing) {     // EBML
+    int64_t frame_size = 0;
+
+    for (size_t idx = 0; (block.num_frames - 1) > idx; ++idx) {
+      vint_c value = vint_c::read(p, end - p);
+      if (!value.is_valid() || value.is_unknown())
+        return false;
+
+      if (!idx)
+        frame_size = value.m_value;
+      else
+        frame_size += value.m_value - ((1ll << (7 * value.m_coded_size - 1)) - 1);
+
+      if (0 > frame_size)
+        return false;
+
+      p += value.m_coded_size;
+      m_frames.push_back(kax_scanned_frame_t{ nullptr, static_cast<size_t>(frame_size) });
+      total_size += frame_size;
+    }
+
+  } else {                      // fixed size
+    size_t frame_size = (end - p) / block.num_frames;
+    for (size_t idx = 0; (block.num_frames - 1) > idx; ++idx)
+      m_frames.push_back(kax_scanned_frame_t{ nullptr, frame_size });
+    total_size = frame_size * (block.num_frames - 1);
+  }
+
+  if (total_size > static_cast<size_t>(end - p))
+    return false;
+
+  size_t last_size = 2 == lacing ? (end - p) / block.num_frames : (end - p) - total_size;
+  m_frames.push_back(kax_scanned_frame_t{ nullptr, last_size });
+
+  for (size_t idx = 0; block.num_frames > idx; ++idx) {
+    auto &frame = m_frames[block.first_frame + idx];
+    frame.data  = p;
+    p          += frame.size;
+  }
+
+  return true;
+}
+
+bool
+kax_cluster_scanner_c::scan_block_group(unsigned char const *data,
+                                        size_t size,
+                                        kax_scanned_block_t &block) {
+  bool additions_found = false;
+  size_t pos           = 0;
+
+  while (pos < size) {
+    size_t element_size;
+    uint32_t id;
+
+    if (!read_element_header(data, size, pos, id, element_size))
+      return false;
+
+    auto element = data + pos;
+    pos         += element_size;
+
+    if (EBML_ID_VALUE(EBML_ID(KaxBlock)) == id) {
+      if (block.block_found)
+        continue;
+
+      block.block_found = true;
+      if (!scan_block(element, element_size, block))
+        return false;
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxReferenceBlock)) == id) {
+      int64_t value;
+      if (!read_sint(element, element_size, value))
+        return false;
+
+      if (0 >= value) {
+        block.bref       = value;
+        block.bref_found = true;
+      } else {
+        block.fref       = value;
+        block.fref_found = true;
+      }
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxBlockDuration)) == id) {
+      if (block.duration_found)
+        continue;
+
+      if (!read_uint(element, element_size, block.duration))
+        return false;
+      block.duration_found = true;
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxCodecState)) == id) {
+      if (!block.codec_state.data)
+        block.codec_state = kax_scanned_frame_t{ element, element_size };
+
+    } else if (EBML_ID_VALUE(EBML_ID(KaxBlockAdditions)) == id) {
+      if (additions_found)
+        continue;
+
+      additions_found      = true;
+      block.first_addition = m_additions.size();
+      scan_block_additions(element, element_size);
+      block.num_additions  = m_additions.size() - block.first_addition;
+    }
+  }
+
+  return true;
+}
+
+void
+kax_cluster_scanner_c::scan_block_additions(unsigned char const *data,
+                                            size_t size) {
+  size_t pos = 0;
+
+  while (pos < size) {
+    size_t element_size;
+    uint32_t id;
+
+    if (!read_element_header(data, size, pos, id, element_size))
+      return;
+
+    auto more = data + pos;
+    pos      += element_size;
+
+    if (EBML_ID_VALUE(EBML_ID(KaxBlockMore)) != id)
+      continue;
+
+    kax_scanned_frame_t additional{ nullptr, 0 };
+    size_t more_pos = 0;
+
+    while (more_pos < element_size) {
+      size_t additional_size;
+      if (!read_element_header(more, element_size, more_pos, id, additional_size))
+        break;
+
+      if (EBML_ID_VALUE(EBML_ID(KaxBlockAdditional)) == id) {
+        additional = kax_scanned_frame_t{ more + more_pos, additional_size };
+        break;
+      }
+
+      more_pos += additional_size;
+    }
+
+    m_additions.push_back(additional);
+  }
+}
+
+void
+kax_cluster_scanner_c::import(KaxCluster &cluster) {
+  reset();
+
+  KaxClusterTimecode *ctc = static_cast<KaxClusterTimecode *>(cluster.FindFirstElt(EBML_INFO(KaxClusterTimecode), false));
+  m_timecode              = ctc ? uint64(*ctc) : 0;
+  cluster.InitTimecode(m_timecode, m_tc_scale);
+
+  for (size_t idx = 0; cluster.ListSize() > idx; ++idx) {
+    EbmlElement *element = cluster[idx];
+    KaxInternalBlock *internal_block;
+    kax_scanned_block_t block;
+
+    memset(&block, 0, sizeof(block));
+
+    if (is_id(element, KaxSimpleBlock)) {
+      auto simple_block = static_cast<KaxSimpleBlock *>(element);
+      internal_block    = simple_block;
+      block.is_simple   = true;
+      block.keyframe    = simple_block->IsKeyframe();
+      block.discardable = simple_block->IsDiscardable();
+
+    } else if (is_id(element, KaxBlockGroup)) {
+      auto block_group = static_cast<KaxBlockGroup *>(element);
+      internal_block   = static_cast<KaxBlock *>(block_group->FindFirstElt(EBML_INFO(KaxBlock), false));
+
+      KaxReferenceBlock *ref_block = static_cast<KaxReferenceBlock *>(block_group->FindFirstElt(EBML_INFO(KaxReferenceBlock), false));
+      while (ref_block) {
+        if (0 >= int64(*ref_block)) {
+          block.bref       = int64(*ref_block);
+          block.bref_found = true;
+        } else {
+          block.fref       = int64(*ref_block);
+          block.fref_found = true;
+        }
+
+        ref_block = static_cast<KaxReferenceBlock *>(block_group->FindNextElt(*ref_block, false));
+      }
+
+      KaxBlockDuration *duration = static_cast<KaxBlockDuration *>(block_group->FindFirstElt(EBML_INFO(KaxBlockDuration), false));
+      if (duration) {
+        block.duration_found = true;
+        block.duration       = uint64(*duration);
+      }
+
+      KaxCodecState *codec_state = static_cast<KaxCodecState *>(block_group->FindFirstElt(EBML_INFO(KaxCodecState)));
+      if (codec_state)
+        block.codec_state = kax_scanned_frame_t{ codec_state->GetBuffer(), static_cast<size_t>(codec_state->GetSize()) };
+
+      KaxBlockAdditions *blockadd = static_cast<KaxBlockAdditions *>(block_group->FindFirstElt(EBML_INFO(KaxBlockAdditions), false));
+      block.first_addition        = m_additions.size();
+      if (blockadd)
+        for (size_t k = 0; blockadd->ListSize() > k; ++k) {
+          if (!is_id((*blockadd)[k], KaxBlockMore))
+            continue;
+
+          KaxBlockAdditional *additional = &GetChild<KaxBlockAdditional>(*static_cast<KaxBlockMore *>((*blockadd)[k]));
+          m_additions.push_back(kax_scanned_frame_t{ additional->GetBuffer(), static_cast<size_t>(additional->GetSize()) });
+        }
+      block.num_additions = m_additions.size() - block.first_addition;
+
+    } else
+      continue;
+
+    block.position    = element->GetElementPosition();
+    block.first_frame = m_frames.size();
+
+    if (internal_block) {
+      internal_block->SetParent(cluster);
+
+      block.block_found  = true;
+      block.track_number = internal_block->TrackNum();
+      block.timecode     = internal_block->GlobalTimecode();
+      block.num_frames   = internal_block->NumberFrames();
+
+      for (size_t frame_idx = 0; block.num_frames > frame_idx; ++frame_idx) {
+        DataBuffer &data_buffer = internal_block->GetBuffer(frame_idx);
+        m_frames.push_back(kax_scanned_frame_t{ data_buffer.Buffer(), static_cast<size_t>(data_buffer.Size()) });
+      }
+    }
+
+    m_blocks.push_back(block);
+  }
+}
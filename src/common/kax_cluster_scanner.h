@@ -0,0 +1,104 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   lightweight scanner for the blocks in a Matroska cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_KAX_CLUSTER_SCANNER_H
+#define __MTX_COMMON_KAX_CLUSTER_SCANNER_H
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCluster.h>
+
+using namespace libebml;
+using namespace libmatroska;
+
+struct kax_scanned_frame_t {
+  unsigned char const *data;
+  size_t size;
+};
+
+struct kax_scanned_block_t {
+  uint64_t track_number;
+  int64_t timecode;             // absolute, in ns
+  int64_t position;             // of the SimpleBlock or BlockGroup element
+  bool is_simple, block_found, keyframe, discardable;
+
+  // Only used for BlockGroups; the reference values are the last ones
+  // found and are in the file's timecode scale.
+  bool duration_found, bref_found, fref_found;
+  uint64_t duration;
+  int64_t bref, fref;
+  kax_scanned_frame_t codec_state;
+
+  size_t first_frame, num_frames;
+  size_t first_addition, num_additions;
+};
+
+/** \brief Locates the blocks and frames in a cluster without libebml
+
+   \c read() loads the cluster's content into a buffer that is re-used
+   for the following clusters and parses the SimpleBlock and
+   BlockGroup headers including lacing. Frames are returned as slices
+   of that buffer, so they're only valid until the next cluster is
+   read.
+
+   Clusters that the scanner doesn't handle (e.g. elements with an
+   unknown size or broken lacing) make \c read() return \c false. The
+   caller can then read the cluster with libebml and hand it to \c
+   import() so that both paths produce the same block list.
+*/
+class kax_cluster_scanner_c {
+protected:
+  memory_cptr m_buffer;
+  int64_t m_tc_scale;
+  uint64_t m_timecode;
+  std::vector<kax_scanned_block_t> m_blocks;
+  std::vector<kax_scanned_frame_t> m_frames, m_additions;
+
+public:
+  kax_cluster_scanner_c();
+
+  void set_timecode_scale(int64_t tc_scale);
+
+  // Reads \c size bytes of cluster content from the current position.
+  bool read(mm_io_c &in, size_t size);
+  bool scan(unsigned char const *data, size_t size, int64_t position);
+  void import(KaxCluster &cluster);
+
+  uint64_t get_timecode() const {
+    return m_timecode;
+  }
+
+  std::vector<kax_scanned_block_t> const &get_blocks() const {
+    return m_blocks;
+  }
+
+  memory_cptr get_frame(kax_scanned_block_t const &block, size_t idx) const {
+    return get_slice(m_frames[block.first_frame + idx]);
+  }
+
+  memory_cptr get_addition(kax_scanned_block_t const &block, size_t idx) const {
+    return get_slice(m_additions[block.first_addition + idx]);
+  }
+
+  static memory_cptr get_slice(kax_scanned_frame_t const &frame) {
+    return memory_cptr(new memory_c(const_cast<unsigned char *>(frame.data), frame.size, false));
+  }
+
+protected:
+  void reset();
+  bool scan_block(unsigned char const *data, size_t size, kax_scanned_block_t &block);
+  bool scan_block_group(unsigned char const *data, size_t size, kax_scanned_block_t &block);
+  void scan_block_additions(unsigned char const *data, size_t size);
+};
+
+#endif  // __MTX_COMMON_KAX_CLUSTER_SCANNER_H
@@ -0,0 +1,130 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   helper functions for Matroska cues and seek heads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCuesData.h>
+
+#include "common/at_scope_exit.h"
+#include "common/ebml.h"
+#include "common/kax_cues.h"
+
+/** \brief Returns the IDs and absolute positions of the elements a
+    SeekHead refers to
+
+   Seek entries without an ID or a position are skipped.
+*/
+std::vector<kax_seek_entry_t>
+read_seek_entries(KaxSeekHead const &seek_head,
+                  KaxSegment const &segment) {
+  std::vector<kax_seek_entry_t> entries;
+
+  for (auto seek_head_child : seek_head) {
+    KaxSeek *seek         = dynamic_cast<KaxSeek *>(seek_head_child);
+    KaxSeekID *kid        = seek ? FindChild<KaxSeekID>(seek)       : nullptr;
+    KaxSeekPosition *kpos = seek ? FindChild<KaxSeekPosition>(seek) : nullptr;
+    if (!kid || !kpos)
+      continue;
+
+    EbmlId id(kid->GetBuffer(), kid->GetSize());
+    entries.push_back(kax_seek_entry_t{ static_cast<uint32_t>(EBML_ID_VALUE(id)), static_cast<int64_t>(segment.GetGlobalPosition(uint64(*kpos))) });
+  }
+
+  return entries;
+}
+
+/** \brief Returns one entry for each track position of each cue point
+
+   Cue points without a time and track positions without a track or a
+   cluster position are skipped. The entries are in the order in which
+   they're stored.
+*/
+std::vector<kax_cue_point_t>
+read_cue_points(KaxCues const &cues,
+                KaxSegment const &segment,
+                int64_t tc_scale) {
+  std::vector<kax_cue_point_t> cue_points;
+
+  for (auto cues_child : cues) {
+    KaxCuePoint *cue_point = dynamic_cast<KaxCuePoint *>(cues_child);
+    KaxCueTime *cue_time   = cue_point ? FindChild<KaxCueTime>(cue_point) : nullptr;
+    if (!cue_time)
+      continue;
+
+    for (auto cue_point_child : *cue_point) {
+      KaxCueTrackPositions *positions = dynamic_cast<KaxCueTrackPositions *>(cue_point_child);
+      KaxCueTrack *cue_track          = positions ? FindChild<KaxCueTrack>(positions)           : nullptr;
+      KaxCueClusterPosition *cue_pos  = positions ? FindChild<KaxCueClusterPosition>(positions) : nullptr;
+      if (!cue_track || !cue_pos)
+        continue;
+
+      cue_points.push_back(kax_cue_point_t{ static_cast<int64_t>(uint64(*cue_time)) * tc_scale,
+                                            static_cast<int64_t>(segment.GetGlobalPosition(uint64(*cue_pos))),
+                                            uint64(*cue_track) });
+    }
+  }
+
+  return cue_points;
+}
+
+/** \brief Reads the cue points from the Cues element at \c position
+
+   The file position is restored afterwards. An empty list is returned
+   if no Cues element can be read there.
+*/
+std::vector<kax_cue_point_t>
+read_cue_points(mm_io_c &in,
+                kax_file_c &file,
+                int64_t position,
+                KaxSegment const &segment,
+                int64_t tc_scale) {
+  in.save_pos(position);
+  at_scope_exit_c restore([&in]() { in.restore_pos(); });
+
+  std::unique_ptr<EbmlElement> cues(file.read_next_level1_element(EBML_ID_VALUE(EBML_ID(KaxCues))));
+  if (!cues || !dynamic_cast<KaxCues *>(cues.get()))
+    return std::vector<kax_cue_point_t>{};
+
+  return read_cue_points(*static_cast<KaxCues *>(cues.get()), segment, tc_scale);
+}
+
+/** \brief Finds the cue point to start reading a time range at
+
+   For each track for which \c use_track returns \c true the latest cue
+   point at or before \c timecode is determined. The earliest of those
+   is returned so that reading from its cluster on reaches a key frame
+   of each of these tracks before \c timecode. Returns \c nullptr if
+   none of the tracks has such a cue point.
+*/
+kax_cue_point_t const *
+find_range_start_cue_point(std::vector<kax_cue_point_t> const &cue_points,
+                           int64_t timecode,
+                           std::function<bool(uint64_t)> const &use_track) {
+  std::map<uint64_t, kax_cue_point_t const *> best_by_track;
+
+  for (auto &cue_point : cue_points) {
+    if ((cue_point.timecode > timecode) || !use_track(cue_point.track_number))
+      continue;
+
+    auto &best = best_by_track[cue_point.track_number];
+    if (!best || (best->timecode < cue_point.timecode))
+      best = &cue_point;
+  }
+
+  kax_cue_point_t const *start = nullptr;
+  for (auto &best : best_by_track)
+    if (!start || (best.second->timecode < start->timecode))
+      start = best.second;
+
+  return start;
+}
@@ -0,0 +1,46 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   helper functions for Matroska cues and seek heads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_KAX_CUES_H
+#define __MTX_COMMON_KAX_CUES_H
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCues.h>
+#include <matroska/KaxSeekHead.h>
+#include <matroska/KaxSegment.h>
+
+#include "common/kax_file.h"
+
+using namespace libebml;
+using namespace libmatroska;
+
+struct kax_cue_point_t {
+  int64_t timecode;             // in ns
+  int64_t position;             // absolute position of the cluster
+  uint64_t track_number;
+};
+
+struct kax_seek_entry_t {
+  uint32_t id;
+  int64_t position;             // absolute position of the element
+};
+
+std::vector<kax_seek_entry_t> read_seek_entries(KaxSeekHead const &seek_head, KaxSegment const &segment);
+
+std::vector<kax_cue_point_t> read_cue_points(KaxCues const &cues, KaxSegment const &segment, int64_t tc_scale);
+std::vector<kax_cue_point_t> read_cue_points(mm_io_c &in, kax_file_c &file, int64_t position, KaxSegment const &segment, int64_t tc_scale);
+
+kax_cue_point_t const *find_range_start_cue_point(std::vector<kax_cue_point_t> const &cue_points, int64_t timecode, std::function<bool(uint64_t)> const &use_track);
+
+#endif  // __MTX_COMMON_KAX_CUES_H
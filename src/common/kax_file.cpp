@@ -263,6 +263,43 @@ kax_file_c::read_next_cluster() {
   return static_cast<KaxCluster *>(read_next_level1_element(EBML_ID_VALUE(EBML_ID(KaxCluster))));
 }
 
+/** \brief Hands the next cluster to a scanner instead of libebml
+
+   This only works if the next element is a cluster with a known size
+   that the scanner can parse. Otherwise the file position is left
+   unchanged, and \c false is returned so that the caller can fall back
+   to \c read_next_cluster(), which also takes care of skipping other
+   level 1 elements and of resyncing.
+*/
+bool
+kax_file_c::scan_next_cluster(kax_cluster_scanner_c &scanner) {
+  int64_t start_pos = m_in->getFilePointer();
+
+  try {
+    vint_c id = vint_c::read_ebml_id(m_in);
+
+    if (id.is_valid() && (EBML_ID_VALUE(EBML_ID(KaxCluster)) == id.m_value)) {
+      vint_c size = vint_c::read(m_in);
+
+      if (   size.is_valid()
+          && !size.is_unknown()
+          && ((m_in->getFilePointer() + size.m_value) <= m_file_size)
+          && scanner.read(*m_in, size.m_value)) {
+        m_resynced         = false;
+        m_resync_start_pos = 0;
+
+        return true;
+      }
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  m_in->setFilePointer(start_pos, seek_beginning);
+
+  return false;
+}
+
 bool
 kax_file_c::was_resynced() const {
   return m_resynced;
@@ -19,6 +19,7 @@
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxCluster.h>
 
+#include "common/kax_cluster_scanner.h"
 #include "common/vint.h"
 
 using namespace libebml;
@@ -44,6 +45,7 @@ public:
 
   virtual EbmlElement *read_next_level1_element(uint32_t wanted_id = 0);
   virtual KaxCluster *read_next_cluster();
+  virtual bool scan_next_cluster(kax_cluster_scanner_c &scanner);
 
   virtual EbmlElement *resync_to_level1_element(uint32_t wanted_id = 0);
   virtual KaxCluster *resync_to_cluster();
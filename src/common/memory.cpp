@@ -13,26 +13,217 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
+
 #include "common/memory.h"
 #include "common/error.h"
 
+namespace mtx {
+namespace mem {
+
+class pool_c {
+protected:
+  // Each power of two is split into four block sizes, starting at
+  // min_block_size.
+  static size_t const min_block_size    = 32;
+  static size_t const min_block_shift   = 5;
+  static size_t const max_retained_size = 32 * 1024 * 1024;
+
+  std::vector<std::vector<void *> > m_free_blocks;
+  size_t m_retained_size;
+  std::mutex m_mutex;
+
+public:
+  pool_c();
+
+  void *alloc(size_t block_size);
+  void free(void *block, size_t block_size);
+
+  static size_t get_block_size(size_t size, size_t &idx);
+
+  // Created on first use and never destroyed so that memory released
+  // by static objects during exit can still be returned.
+  static pool_c &global();
+};
+
+pool_c::pool_c()
+  : m_retained_size(0)
+{
+  size_t idx;
+  get_block_size(max_pool_block_size, idx);
+  m_free_blocks.resize(idx + 1);
+}
+
+size_t
+pool_c::get_block_size(size_t size,
+                       size_t &idx) {
+  idx = 0;
+  if (min_block_size >= size)
+    return min_block_size;
+
+  size_t shift = min_block_shift;
+  while ((static_cast<size_t>(2) << shift) < size)
+    ++shift;
+
+  size_t base = static_cast<size_t>(1) << shift;
+  size_t step = base / 4;
+  size_t num  = (size - base + step - 1) / step;
+  idx         = (shift - min_block_shift) * 4 + num;
+
+  return base + num * step;
+}
+
+void *
+pool_c::alloc(size_t block_size) {
+  size_t idx;
+  if ((max_pool_block_size >= block_size) && (get_block_size(block_size, idx) == block_size)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto &blocks = m_free_blocks[idx];
+    if (!blocks.empty()) {
+      void *block      = blocks.back();
+      blocks.pop_back();
+      m_retained_size -= block_size;
+
+      return block;
+    }
+  }
+
+  return safemalloc(block_size);
+}
+
+void
+pool_c::free(void *block,
+             size_t block_size) {
+  if (!block)
+    return;
+
+  size_t idx;
+  if ((max_pool_block_size >= block_size) && (get_block_size(block_size, idx) == block_size)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Keep a handful of blocks of each size, but don't let big blocks
+    // eat up all of the retained memory.
+    auto &blocks = m_free_blocks[idx];
+    if (   ((m_retained_size + block_size) <= max_retained_size)
+        && ((blocks.size() < 2) || ((blocks.size() * block_size) < (max_retained_size / 16)))) {
+      blocks.push_back(block);
+      m_retained_size += block_size;
+
+      return;
+    }
+  }
+
+  ::free(block);
+}
+
+pool_c &
+pool_c::global() {
+  static pool_c *s_pool = new pool_c;
+  return *s_pool;
+}
+
+size_t
+get_pool_block_size(size_t size) {
+  if (max_pool_block_size < size)
+    return size;
+
+  size_t idx;
+  return pool_c::get_block_size(size, idx);
+}
+
+void *
+pool_alloc(size_t block_size) {
+  return pool_c::global().alloc(block_size);
+}
+
+void
+pool_free(void *block,
+          size_t block_size) {
+  pool_c::global().free(block, block_size);
+}
+
+}
+}
+
+// Keeps the inline buffer suitably aligned for any kind of data.
+size_t
+memory_c::counter::get_header_size() {
+  return (sizeof(counter) + 15) & ~static_cast<size_t>(15);
+}
+
+memory_c::counter *
+memory_c::counter::create(X *p,
+                          size_t s,
+                          bool f) {
+  size_t block_size = mtx::mem::get_pool_block_size(sizeof(counter));
+  return new (mtx::mem::pool_alloc(block_size)) counter(p, s, f, block_size);
+}
+
+memory_c::counter *
+memory_c::counter::create_with_buffer(size_t s) {
+  size_t block_size = mtx::mem::get_pool_block_size(get_header_size() + s);
+  if (mtx::mem::max_pool_block_size < block_size)
+    return create(static_cast<X *>(safemalloc(s)), s, true);
+
+  X *block     = static_cast<X *>(mtx::mem::pool_alloc(block_size));
+  counter *c   = new (block) counter(block + get_header_size(), s, true, block_size);
+  c->is_inline = true;
+
+  return c;
+}
+
+void
+memory_c::counter::destroy(counter *c) {
+  if (c->is_free && !c->is_inline)
+    free(c->ptr);
+
+  size_t block_size = c->block_size;
+  c->~counter();
+  mtx::mem::pool_free(c, block_size);
+}
+
+size_t
+memory_c::counter::get_inline_capacity()
+  const {
+  return is_inline ? block_size - get_header_size() : 0;
+}
+
+void
+memory_c::counter::move_to_heap(size_t new_size) {
+  X *tmp = static_cast<X *>(safemalloc(new_size));
+  memcpy(tmp, ptr, std::min(size, new_size));
+
+  ptr       = tmp;
+  size      = new_size;
+  is_inline = false;
+}
+
 void
 memory_c::resize(size_t new_size)
   throw()
 {
   if (!its_counter)
-    its_counter = new counter(nullptr, 0, false);
+    its_counter = counter::create(nullptr, 0, false);
+
+  if (its_counter->is_inline) {
+    // Grow in place as long as the memory block is big enough.
+    if ((new_size + its_counter->offset) <= its_counter->get_inline_capacity())
+      its_counter->size = new_size + its_counter->offset;
+    else
+      its_counter->move_to_heap(new_size + its_counter->offset);
 
-  if (its_counter->is_free) {
+  } else if (its_counter->is_free) {
     its_counter->ptr  = (X *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
     its_counter->size = new_size + its_counter->offset;
 
   } else {
     X *tmp = (X *)safemalloc(new_size);
-    memcpy(tmp, its_counter->ptr + its_counter->offset, its_counter->size - its_counter->offset);
+    memcpy(tmp, its_counter->ptr + its_counter->offset, std::min(new_size, its_counter->size - its_counter->offset));
     its_counter->ptr     = tmp;
     its_counter->is_free = true;
     its_counter->size    = new_size;
+    its_counter->offset  = 0;
   }
 }
 
@@ -39,6 +39,18 @@ namespace mtx {
         return m_message.c_str();
       }
     };
+
+    /* A pool of recycled memory blocks. Requested sizes are rounded up
+       to one of a limited number of block sizes so that buffers of
+       similar sizes (e.g. audio frames) can be reused without going
+       through malloc() and free() each time. Blocks larger than
+       max_pool_block_size are allocated and freed directly. The pool
+       can be used from several threads at once. */
+    size_t const max_pool_block_size = 4 * 1024 * 1024;
+
+    size_t get_pool_block_size(size_t size);
+    void *pool_alloc(size_t block_size);
+    void pool_free(void *block, size_t block_size);
   }
 }
 
@@ -91,11 +103,12 @@ public:
     : its_counter(nullptr)
   {
     if (p)
-      its_counter = new counter(static_cast<unsigned char *>(p), s, f);
+      its_counter = counter::create(static_cast<unsigned char *>(p), s, f);
   }
 
+  // The buffer is placed in the same memory block as the counter.
   explicit memory_c(size_t s)
-    : its_counter(new counter(static_cast<unsigned char *>(safemalloc(s)), s, true))
+    : its_counter(counter::create_with_buffer(s))
   {
   }
 
@@ -161,8 +174,13 @@ public:
   }
 
   void lock() {
-    if (its_counter)
-      its_counter->is_free = false;
+    if (!its_counter)
+      return;
+
+    // The caller takes over the buffer and will free() it.
+    if (its_counter->is_inline)
+      its_counter->move_to_heap(its_counter->size);
+    its_counter->is_free = false;
   }
 
   void resize(size_t new_size) throw();
@@ -200,33 +218,68 @@ public:
 public:
   static memory_cptr
   alloc(size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
+    return memory_cptr(new memory_c(size));
   };
 
   static inline memory_cptr
   clone(const void *buffer,
         size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safememdup(buffer, size)), size, true));
+    if (!buffer)
+      return memory_cptr(new memory_c());
+
+    memory_cptr mem(new memory_c(size));
+    memcpy(mem->get_buffer(), buffer, size);
+    return mem;
+  }
+
+  // Refers to a part of another buffer without copying it. The other
+  // buffer is kept alive for as long as the view exists. Modifying the
+  // view's size or calling grab() copies the data first.
+  static inline memory_cptr
+  view(memory_cptr const &parent,
+       size_t offset,
+       size_t size) {
+    memory_cptr keep_alive = parent;
+    return memory_cptr(new memory_c(parent->get_buffer() + offset, size, false), [keep_alive](memory_c *mem) { delete mem; });
+  }
+
+  static void *operator new(size_t size) {
+    return mtx::mem::pool_alloc(mtx::mem::get_pool_block_size(size));
+  }
+
+  static void operator delete(void *p,
+                              size_t size) {
+    mtx::mem::pool_free(p, mtx::mem::get_pool_block_size(size));
   }
 
 private:
   struct counter {
     X *ptr;
     size_t size;
-    bool is_free;
+    bool is_free, is_inline;
     unsigned count;
-    size_t offset;
+    size_t offset, block_size;
 
-    counter(X *p = nullptr,
-            size_t s = 0,
-            bool f = false,
-            unsigned c = 1)
+    counter(X *p,
+            size_t s,
+            bool f,
+            size_t bs)
       : ptr(p)
       , size(s)
       , is_free(f)
-      , count(c)
+      , is_inline(false)
+      , count(1)
       , offset(0)
+      , block_size(bs)
     { }
+
+    size_t get_inline_capacity() const;
+    void move_to_heap(size_t new_size);
+
+    static size_t get_header_size();
+    static counter *create(X *p, size_t s, bool f);
+    static counter *create_with_buffer(size_t s);
+    static void destroy(counter *c);
   } *its_counter;
 
   void acquire(counter *c) throw() { // increment the count
@@ -237,11 +290,8 @@ private:
 
   void release() { // decrement the count, delete if it is 0
     if (its_counter) {
-      if (--its_counter->count == 0) {
-        if (its_counter->is_free)
-          free(its_counter->ptr);
-        delete its_counter;
-      }
+      if (--its_counter->count == 0)
+        counter::destroy(its_counter);
       its_counter = 0;
     }
   }
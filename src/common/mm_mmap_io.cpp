@@ -0,0 +1,158 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#if !defined(SYS_WINDOWS)
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "common/locale.h"
+#include "common/mm_mmap_io.h"
+
+mm_mmap_io_c::mm_mmap_io_c(const std::string &path)
+  : m_file_name(path)
+  , m_mem(nullptr)
+  , m_size(0)
+  , m_fd(-1)
+  , m_eof(false)
+{
+#if defined(SYS_WINDOWS)
+  throw mtx::mm_io::open_x();
+
+#else  // SYS_WINDOWS
+  std::string local_path = g_cc_local_utf8->native(path);
+
+  m_fd = ::open(local_path.c_str(), O_RDONLY);
+  if (-1 == m_fd)
+    throw mtx::mm_io::open_x();
+
+  struct stat st;
+  if (   (0 != fstat(m_fd, &st))
+      || !S_ISREG(st.st_mode)
+      || (0 == st.st_size)
+      || (static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(std::numeric_limits<size_t>::max()))) {
+    close();
+    throw mtx::mm_io::open_x();
+  }
+
+  // A read-only mapping isn't charged against the system's commit
+  // limit the way a writable private one is.
+  void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (MAP_FAILED == mem) {
+    close();
+    throw mtx::mm_io::open_x();
+  }
+
+  m_mem         = static_cast<unsigned char *>(mem);
+  m_size        = st.st_size;
+  m_cached_size = m_size;
+
+  // Views handed out by read_view() keep the mapping alive after the
+  // file has been closed.
+  size_t mapping_size = m_size;
+  m_mapping           = memory_cptr(new memory_c(m_mem, m_size, false), [mapping_size](memory_c *mapping) {
+    munmap(mapping->get_buffer(), mapping_size);
+    delete mapping;
+  });
+
+  // Input files are mostly read from front to back.
+  madvise(m_mem, m_size, MADV_SEQUENTIAL);
+#endif  // SYS_WINDOWS
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+void
+mm_mmap_io_c::close() {
+#if !defined(SYS_WINDOWS)
+  if (-1 != m_fd)
+    ::close(m_fd);
+#endif  // SYS_WINDOWS
+
+  m_mapping.reset();
+  m_mem = nullptr;
+  m_fd  = -1;
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_current_position;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size             + offset
+    :                          m_current_position + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x();
+
+  m_current_position = new_pos;
+  m_eof              = false;
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_eof;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  int64_t available = std::max<int64_t>(m_size - m_current_position, 0);
+  size_t num_read   = std::min<int64_t>(size, available);
+
+  if (num_read)
+    memcpy(buffer, m_mem + m_current_position, num_read);
+
+  m_current_position += num_read;
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+memory_cptr
+mm_mmap_io_c::read_view(size_t size) {
+  if ((m_current_position + static_cast<int64_t>(size)) > m_size) {
+    m_eof = true;
+    throw mtx::mm_io::end_of_file_x();
+  }
+
+  memory_cptr view     = memory_c::view(m_mapping, m_current_position, size);
+  m_current_position += size;
+
+  return view;
+}
@@ -0,0 +1,79 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_MM_MMAP_IO_H
+#define __MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/** \brief Read-only file I/O served from a memory mapping of the whole file
+
+   Reads are plain copies from the mapping, seeking only moves the
+   cursor, and the file size is known after opening. No additional
+   read buffer is needed on top of this class.
+
+   The constructor throws \c mtx::mm_io::open_x if the file cannot be
+   mapped (e.g. on platforms without \c mmap, for non-regular files or
+   for files larger than the address space). Callers should fall back
+   to \c mm_file_io_c in that case.
+
+   The mapping is read-only, and so are the views returned by
+   \c read_view(). Writing to them crashes the program. Consumers that
+   modify data in place must copy it first, e.g. with
+   \c memory_c::grab(). If the file is truncated by another process while it is mapped, accessing
+   the pages beyond the new end raises \c SIGBUS; there is no way to
+   turn that into an error. Only use this class for inputs that are
+   not modified while they're read.
+*/
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  std::string m_file_name;
+  unsigned char *m_mem;
+  memory_cptr m_mapping;
+  int64_t m_size;
+  int m_fd;
+  bool m_eof;
+
+public:
+  mm_mmap_io_c(const std::string &path);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual void close();
+  virtual bool eof();
+  virtual int64_t get_size();
+
+  virtual std::string get_file_name() const {
+    return m_file_name;
+  }
+
+  /** \brief Return the next \c size bytes without copying them
+
+     The returned buffer points directly into the mapping, which stays
+     mapped until the last view has been released, even if this object
+     is closed earlier. Throws \c mtx::mm_io::end_of_file_x if fewer
+     than \c size bytes are left.
+  */
+  virtual memory_cptr read_view(size_t size);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+};
+
+typedef std::shared_ptr<mm_mmap_io_c> mm_mmap_io_cptr;
+
+#endif // __MTX_COMMON_MM_MMAP_IO_H
@@ -0,0 +1,123 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_probe_buffer_io.h"
+
+mm_probe_buffer_io_c::mm_probe_buffer_io_c(mm_io_c *in,
+                                           size_t max_prefix_size,
+                                           bool delete_in)
+  : mm_proxy_io_c(in, delete_in)
+  , m_prefix(memory_c::alloc(0))
+  , m_prefix_fill(0)
+  , m_max_prefix_size(max_prefix_size)
+  , m_eof(false)
+  , m_debug(debugging_requested("probe_buffer_io"))
+{
+}
+
+mm_probe_buffer_io_c::~mm_probe_buffer_io_c() {
+  close();
+}
+
+uint64
+mm_probe_buffer_io_c::getFilePointer() {
+  return m_current_position;
+}
+
+void
+mm_probe_buffer_io_c::setFilePointer(int64 offset,
+                                     seek_mode mode) {
+  int64_t new_pos = seek_beginning == mode ? offset : m_current_position + offset;
+
+  if (seek_end == mode) {
+    // The proxied file knows how it interprets offsets relative to the end.
+    m_proxy_io->setFilePointer(offset, seek_end);
+    new_pos = m_proxy_io->getFilePointer();
+  }
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x();
+
+  m_current_position = new_pos;
+  m_eof              = false;
+}
+
+bool
+mm_probe_buffer_io_c::eof() {
+  return m_eof;
+}
+
+int64_t
+mm_probe_buffer_io_c::get_size() {
+  return m_proxy_io->get_size();
+}
+
+void
+mm_probe_buffer_io_c::fill_prefix(size_t end) {
+  if (end <= m_prefix_fill)
+    return;
+
+  // Grow in bigger steps than requested as the probes usually read
+  // small pieces one after the other.
+  size_t new_size = std::max<size_t>(std::max<size_t>(end, 2 * m_prefix_fill), 64 * 1024);
+  new_size        = std::min<int64_t>(std::min(new_size, m_max_prefix_size), get_size());
+
+  if (new_size <= m_prefix_fill)
+    return;
+
+  m_prefix->resize(new_size);
+  m_proxy_io->setFilePointer(m_prefix_fill, seek_beginning);
+  size_t num_read = m_proxy_io->read(m_prefix->get_buffer() + m_prefix_fill, new_size - m_prefix_fill);
+
+  mxdebug_if(m_debug, boost::format("probe buffer: read %1% bytes from the proxy at %2%\n") % num_read % m_prefix_fill);
+
+  m_prefix_fill += num_read;
+}
+
+uint32
+mm_probe_buffer_io_c::_read(void *buffer,
+                            size_t size) {
+  auto buf        = static_cast<unsigned char *>(buffer);
+  size_t num_read = 0;
+
+  if (m_current_position < static_cast<int64_t>(m_max_prefix_size)) {
+    fill_prefix(std::min<int64_t>(m_current_position + size, m_max_prefix_size));
+
+    if (m_current_position < static_cast<int64_t>(m_prefix_fill)) {
+      num_read = std::min<size_t>(size, m_prefix_fill - m_current_position);
+      memcpy(buf, m_prefix->get_buffer() + m_current_position, num_read);
+      m_current_position += num_read;
+    }
+  }
+
+  if ((num_read < size) && (m_current_position >= static_cast<int64_t>(m_max_prefix_size))) {
+    m_proxy_io->setFilePointer(m_current_position, seek_beginning);
+    size_t num_read_from_proxy  = m_proxy_io->read(buf + num_read, size - num_read);
+    num_read                   += num_read_from_proxy;
+    m_current_position         += num_read_from_proxy;
+  }
+
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_probe_buffer_io_c::_write(const void *,
+                             size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
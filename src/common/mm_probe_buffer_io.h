@@ -0,0 +1,52 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_MM_PROBE_BUFFER_IO_H
+#define __MTX_COMMON_MM_PROBE_BUFFER_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/** \brief Read-only I/O that keeps the beginning of a file in memory
+
+   Meant for probing a file with many different readers. Each byte
+   within the first \c max_prefix_size bytes is read from the proxied
+   file only once; the buffer holding them grows on demand. Reads
+   beyond that prefix are passed through to the proxied file.
+*/
+class mm_probe_buffer_io_c: public mm_proxy_io_c {
+protected:
+  memory_cptr m_prefix;
+  size_t m_prefix_fill, m_max_prefix_size;
+  bool m_eof, m_debug;
+
+public:
+  mm_probe_buffer_io_c(mm_io_c *in, size_t max_prefix_size, bool delete_in = false);
+  virtual ~mm_probe_buffer_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual bool eof();
+  virtual int64_t get_size();
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  virtual void fill_prefix(size_t end);
+};
+
+typedef std::shared_ptr<mm_probe_buffer_io_c> mm_probe_buffer_io_cptr;
+
+#endif // __MTX_COMMON_MM_PROBE_BUFFER_IO_H
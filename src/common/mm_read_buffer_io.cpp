@@ -18,7 +18,8 @@
 
 mm_read_buffer_io_c::mm_read_buffer_io_c(mm_io_c *in,
                                          size_t buffer_size,
-                                         bool delete_in)
+                                         bool delete_in,
+                                         bool read_ahead)
   : mm_proxy_io_c(in, delete_in)
   , m_af_buffer(memory_c::alloc(buffer_size))
   , m_buffer(m_af_buffer->get_buffer())
@@ -30,11 +31,27 @@ mm_read_buffer_io_c::mm_read_buffer_io_c(mm_io_c *in,
   , m_buffering(true)
   , m_debug_seek(debugging_requested("read_buffer_io") || debugging_requested("read_buffer_io_read"))
   , m_debug_read(debugging_requested("read_buffer_io") || debugging_requested("read_buffer_io_read"))
+  , m_read_ahead(read_ahead)
+  , m_read_ahead_offset(0)
+  , m_read_ahead_size(0)
+  , m_read_ahead_fill(0)
+  , m_read_ahead_state(ras_idle)
+  , m_read_ahead_cancelled(false)
+  , m_reader_stop(false)
 {
+  if (m_read_ahead) {
+    m_read_ahead_buffer = memory_c::alloc(buffer_size);
+    // Determine the size now so that the proxy's cached value can be
+    // used while the reader thread is working on it.
+    get_size();
+    m_reader = std::thread(&mm_read_buffer_io_c::run_reader, this);
+  }
+
   setFilePointer(0, seek_beginning);
 }
 
 mm_read_buffer_io_c::~mm_read_buffer_io_c() {
+  stop_reader();
   close();
 }
 
@@ -83,6 +100,30 @@ mm_read_buffer_io_c::setFilePointer(int64 offset,
     return;
   }
 
+  if (m_read_ahead) {
+    // Within the data being read ahead? Otherwise that data is
+    // dropped. The proxy is only positioned by the next physical read
+    // so that seeking never has to wait for the reader thread.
+    if (use_read_ahead_buffer(new_pos)) {
+      start_read_ahead();
+      return;
+    }
+
+    cancel_read_ahead();
+
+    if (seek_end == mode)
+      new_pos = get_size() + offset;
+    if (0 > new_pos)
+      throw mtx::mm_io::seek_x();
+
+    mxdebug_if(m_debug_seek, boost::format("seek from %1% to %2% without physical seek\n") % (m_offset + m_cursor) % std::min(new_pos, get_size()));
+
+    m_offset = std::min(new_pos, get_size());
+    m_cursor = m_fill = 0;
+
+    return;
+  }
+
   int64_t previous_pos = m_proxy_io->getFilePointer();
 
   // Actual seeking
@@ -139,7 +180,19 @@ mm_read_buffer_io_c::_read(void *buffer,
         break;
       }
 
+      if (use_read_ahead_buffer(m_offset)) {
+        start_read_ahead();
+        continue;
+      }
+
+      if (m_read_ahead)
+        wait_for_reader();
+
       int64_t previous_pos = m_proxy_io->getFilePointer();
+      if (m_read_ahead && (previous_pos != m_offset)) {
+        m_proxy_io->setFilePointer(m_offset, seek_beginning);
+        previous_pos = m_offset;
+      }
 
       m_fill = m_proxy_io->read(m_buffer, avail);
       mxdebug_if(m_debug_read, boost::format("physical read from position %3% for %1% returned %2%\n") % avail % m_fill % previous_pos);
@@ -148,6 +201,8 @@ mm_read_buffer_io_c::_read(void *buffer,
         if (!m_fill)
           break;
       }
+
+      start_read_ahead();
     }
   }
 
@@ -163,6 +218,9 @@ mm_read_buffer_io_c::_write(const void *,
 
 void
 mm_read_buffer_io_c::enable_buffering(bool enable) {
+  cancel_read_ahead();
+  wait_for_reader();
+
   m_buffering = enable;
   if (!m_buffering) {
     m_offset = 0;
@@ -170,3 +228,143 @@ mm_read_buffer_io_c::enable_buffering(bool enable) {
     m_fill   = 0;
   }
 }
+
+void
+mm_read_buffer_io_c::start_read_ahead() {
+  if (!m_read_ahead || !m_buffering)
+    return;
+
+  int64_t offset = m_offset + m_fill;
+  int64_t avail  = std::min(get_size() - offset, static_cast<int64_t>(m_size));
+  if (0 >= avail)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // A cancelled read-ahead may still be running. The next refill
+  // waits for it and starts a new one.
+  if (ras_idle != m_read_ahead_state)
+    return;
+
+  m_read_ahead_offset    = offset;
+  m_read_ahead_size      = avail;
+  m_read_ahead_fill      = 0;
+  m_read_ahead_cancelled = false;
+  m_read_ahead_state     = ras_requested;
+  m_cond.notify_all();
+}
+
+void
+mm_read_buffer_io_c::cancel_read_ahead() {
+  m_read_ahead_cancelled = true;
+}
+
+bool
+mm_read_buffer_io_c::use_read_ahead_buffer(int64_t new_pos) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  int64_t in_buf = new_pos - m_read_ahead_offset;
+  if (   (ras_idle == m_read_ahead_state)
+      || m_read_ahead_cancelled
+      || (0 > in_buf)
+      || (static_cast<int64_t>(m_read_ahead_size) <= in_buf))
+    return false;
+
+  m_cond.wait(lock, [this]() { return ras_done == m_read_ahead_state; });
+
+  m_read_ahead_state = ras_idle;
+  size_t fill        = m_read_ahead_fill;
+
+  mxdebug_if(m_debug_read, boost::format("read-ahead from position %1% returned %2%; %3%\n") % m_read_ahead_offset % fill % (static_cast<int64_t>(fill) > in_buf ? "used" : "dropped"));
+
+  if (m_reader_exception) {
+    // Errors are reported without holding the lock as reporting them
+    // may exit the program, and the destructor still needs the lock.
+    auto error         = m_reader_exception;
+    m_reader_exception = nullptr;
+    lock.unlock();
+
+    rethrow_worker_exception(error);
+  }
+
+  if (static_cast<int64_t>(fill) <= in_buf)
+    return false;
+
+  std::swap(m_af_buffer, m_read_ahead_buffer);
+  m_buffer = m_af_buffer->get_buffer();
+  m_offset = m_read_ahead_offset;
+  m_fill   = fill;
+  m_cursor = in_buf;
+
+  return true;
+}
+
+void
+mm_read_buffer_io_c::wait_for_reader() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_cond.wait(lock, [this]() { return ras_requested != m_read_ahead_state; });
+
+  // Data and errors of a read-ahead that wasn't used are dropped. If
+  // an error was real, the physical read will run into it as well.
+  m_read_ahead_state = ras_idle;
+  m_reader_exception = nullptr;
+}
+
+void
+mm_read_buffer_io_c::stop_reader() {
+  if (!m_reader.joinable())
+    return;
+
+  cancel_read_ahead();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reader_stop = true;
+    m_cond.notify_all();
+  }
+
+  m_reader.join();
+}
+
+void
+mm_read_buffer_io_c::run_reader() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_cond.wait(lock, [this]() { return m_reader_stop || (ras_requested == m_read_ahead_state); });
+
+    if (m_reader_stop)
+      return;
+
+    int64_t offset      = m_read_ahead_offset;
+    size_t size         = m_read_ahead_size;
+    unsigned char *dest = m_read_ahead_buffer->get_buffer();
+    size_t fill         = 0;
+    std::exception_ptr error;
+    lock.unlock();
+
+    try {
+      if (static_cast<int64_t>(m_proxy_io->getFilePointer()) != offset)
+        m_proxy_io->setFilePointer(offset, seek_beginning);
+
+      while ((fill < size) && !m_read_ahead_cancelled) {
+        size_t num_wanted = std::min<size_t>(size - fill, s_read_ahead_piece_size);
+        size_t num_read   = m_proxy_io->read(dest + fill, num_wanted);
+        fill             += num_read;
+
+        if (num_read != num_wanted)
+          break;
+      }
+
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    m_read_ahead_fill  = fill;
+    m_reader_exception = error;
+    m_read_ahead_state = ras_done;
+    m_cond.notify_all();
+  }
+}
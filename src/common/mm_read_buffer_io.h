@@ -17,6 +17,12 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "common/mm_io.h"
 
 class mm_read_buffer_io_c: public mm_proxy_io_c {
@@ -30,8 +36,33 @@ protected:
   const size_t m_size;
   bool m_buffering, m_debug_seek, m_debug_read;
 
+  // Double buffering: a second buffer of the same size is filled by
+  // a separate reader thread with the data following the current
+  // buffer. While a read-ahead is pending only that thread may use
+  // the proxy. Seeking elsewhere only cancels it; the reader checks
+  // for that between pieces of at most s_read_ahead_piece_size bytes.
+  enum read_ahead_state_e {
+    ras_idle,
+    ras_requested,
+    ras_done,
+  };
+
+  bool m_read_ahead;
+  memory_cptr m_read_ahead_buffer;
+  int64_t m_read_ahead_offset;
+  size_t m_read_ahead_size, m_read_ahead_fill;
+  read_ahead_state_e m_read_ahead_state;
+  std::atomic<bool> m_read_ahead_cancelled;
+  std::thread m_reader;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_reader_stop;
+  std::exception_ptr m_reader_exception;
+
+  static size_t const s_read_ahead_piece_size = 1 << 18;
+
 public:
-  mm_read_buffer_io_c(mm_io_c *in, size_t buffer_size = 1 << 12, bool delete_in = true);
+  mm_read_buffer_io_c(mm_io_c *in, size_t buffer_size = 1 << 12, bool delete_in = true, bool read_ahead = false);
   virtual ~mm_read_buffer_io_c();
 
   virtual uint64 getFilePointer();
@@ -43,6 +74,13 @@ public:
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
+
+  virtual void start_read_ahead();
+  virtual void cancel_read_ahead();
+  virtual bool use_read_ahead_buffer(int64_t new_pos);
+  virtual void wait_for_reader();
+  virtual void stop_reader();
+  virtual void run_reader();
 };
 
 typedef std::shared_ptr<mm_read_buffer_io_c> mm_read_buffer_io_cptr;
@@ -18,7 +18,8 @@
 
 mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
                                            size_t buffer_size,
-                                           bool delete_out)
+                                           bool delete_out,
+                                           unsigned int num_async_buffers)
   : mm_proxy_io_c(out, delete_out)
   , m_af_buffer(memory_c::alloc(buffer_size))
   , m_buffer(m_af_buffer->get_buffer())
@@ -26,22 +27,43 @@ mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
   , m_size(buffer_size)
   , m_debug_seek( debugging_requested("write_buffer_io") || debugging_requested("write_buffer_io_read"))
   , m_debug_write(debugging_requested("write_buffer_io") || debugging_requested("write_buffer_io_write"))
+  , m_closed(false)
+  , m_destructing(false)
+  , m_num_async_buffers(num_async_buffers)
+  , m_async_position(0)
+  , m_writer_stop(false)
 {
+  if (!m_num_async_buffers)
+    return;
+
+  m_async_position = mm_proxy_io_c::getFilePointer();
+  m_writer         = std::thread(&mm_write_buffer_io_c::run_writer, this);
 }
 
 mm_write_buffer_io_c::~mm_write_buffer_io_c() {
-  close();
+  // The destructor may run while the program is already exiting due
+  // to an error. Errors are therefore only warned about here.
+  m_destructing = true;
+
+  try {
+    close();
+  } catch (mtx::exception &ex) {
+    mxwarn(boost::format(Y("Writing to the file failed: %1%\n")) % ex.error());
+  } catch (...) {
+    mxwarn(Y("Writing to the file failed.\n"));
+  }
 }
 
 mm_io_cptr
 mm_write_buffer_io_c::open(const std::string &file_name,
-                           size_t buffer_size) {
-  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size));
+                           size_t buffer_size,
+                           unsigned int num_async_buffers) {
+  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size, true, num_async_buffers));
 }
 
 uint64
 mm_write_buffer_io_c::getFilePointer() {
-  return mm_proxy_io_c::getFilePointer() + m_fill;
+  return (m_num_async_buffers ? m_async_position : mm_proxy_io_c::getFilePointer()) + m_fill;
 }
 
 void
@@ -56,6 +78,7 @@ mm_write_buffer_io_c::setFilePointer(int64 offset,
     return;
 
   flush_buffer();
+  wait_for_writer();
 
   if (m_debug_seek) {
     int64_t previous_pos = mm_proxy_io_c::getFilePointer();
@@ -63,18 +86,46 @@ mm_write_buffer_io_c::setFilePointer(int64 offset,
   }
 
   mm_proxy_io_c::setFilePointer(offset, mode);
+
+  if (m_num_async_buffers)
+    m_async_position = mm_proxy_io_c::getFilePointer();
 }
 
 void
 mm_write_buffer_io_c::flush() {
+  if (m_closed)
+    return;
+
   flush_buffer();
+  wait_for_writer();
   mm_proxy_io_c::flush();
 }
 
 void
 mm_write_buffer_io_c::close() {
-  flush_buffer();
+  if (m_closed)
+    return;
+
+  m_closed = true;
+
+  // The writer thread must be stopped and the file closed even if
+  // writing the remaining data fails.
+  std::exception_ptr error;
+  try {
+    flush_buffer();
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  stop_writer();
   mm_proxy_io_c::close();
+
+  if (error)
+    std::rethrow_exception(error);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_writer_exception)
+    rethrow_writer_exception(lock);
 }
 
 uint32
@@ -87,13 +138,16 @@ mm_write_buffer_io_c::_read(void *,
 size_t
 mm_write_buffer_io_c::_write(const void *buffer,
                              size_t size) {
+  if (m_closed)
+    throw mtx::mm_io::wrong_read_write_access_x();
+
   size_t avail;
   const char *buf = static_cast<const char *>(buffer);
   size_t remain   = size;
 
   // whole blocks
   while (remain >= (avail = m_size - m_fill)) {
-    if (m_fill) {
+    if (m_fill || m_num_async_buffers) {
       // Fill the buffer in an attempt to defeat potentially
       // lousy OS I/O scheduling
       memcpy(m_buffer + m_fill, buf, avail);
@@ -126,6 +180,11 @@ mm_write_buffer_io_c::flush_buffer() {
   if (!m_fill)
     return;
 
+  if (m_num_async_buffers) {
+    queue_buffer();
+    return;
+  }
+
   size_t written = mm_proxy_io_c::_write(m_buffer, m_fill);
   size_t fill    = m_fill;
   m_fill         = 0;
@@ -135,3 +194,107 @@ mm_write_buffer_io_c::flush_buffer() {
   if (written != fill)
     throw mtx::mm_io::insufficient_space_x();
 }
+
+void
+mm_write_buffer_io_c::queue_buffer() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_cond.wait(lock, [this]() { return m_queue.size() < m_num_async_buffers; });
+
+  if (m_writer_exception)
+    rethrow_writer_exception(lock);
+
+  m_af_buffer->set_size(m_fill);
+  m_queue.push_back(m_af_buffer);
+  m_async_position += m_fill;
+
+  if (!m_free_buffers.empty()) {
+    m_af_buffer = m_free_buffers.front();
+    m_free_buffers.pop_front();
+  } else
+    m_af_buffer = memory_c::alloc(m_size);
+
+  m_buffer = m_af_buffer->get_buffer();
+  m_fill   = 0;
+
+  m_cond.notify_all();
+}
+
+void
+mm_write_buffer_io_c::rethrow_writer_exception(std::unique_lock<std::mutex> &lock) {
+  // Errors are reported without holding the lock as reporting them
+  // may exit the program, and the destructor still needs the lock.
+  auto error = m_writer_exception;
+  lock.unlock();
+
+  if (m_destructing)
+    std::rethrow_exception(error);
+  rethrow_worker_exception(error);
+}
+
+void
+mm_write_buffer_io_c::wait_for_writer() {
+  if (!m_num_async_buffers)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_cond.wait(lock, [this]() { return m_queue.empty(); });
+
+  if (m_writer_exception)
+    rethrow_writer_exception(lock);
+}
+
+void
+mm_write_buffer_io_c::stop_writer() {
+  if (!m_writer.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writer_stop = true;
+    m_cond.notify_all();
+  }
+
+  m_writer.join();
+}
+
+void
+mm_write_buffer_io_c::run_writer() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_cond.wait(lock, [this]() { return m_writer_stop || !m_queue.empty(); });
+
+    if (m_queue.empty())
+      return;
+
+    // The buffer stays in the queue until it has been written so that
+    // wait_for_writer() knows when the proxy may be used again.
+    memory_cptr buffer = m_queue.front();
+    bool failed        = !!m_writer_exception;
+    std::exception_ptr error;
+    lock.unlock();
+
+    if (!failed) {
+      try {
+        size_t written = mm_proxy_io_c::_write(buffer->get_buffer(), buffer->get_size());
+
+        mxdebug_if(m_debug_write, boost::format("asynchronous flush_buffer() at %1% for %2% written %3%\n") % (mm_proxy_io_c::getFilePointer() - written) % buffer->get_size() % written);
+
+        if (written != buffer->get_size())
+          throw mtx::mm_io::insufficient_space_x();
+
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+
+    lock.lock();
+    if (error)
+      m_writer_exception = error;
+    m_queue.pop_front();
+    m_free_buffers.push_back(buffer);
+    m_cond.notify_all();
+  }
+}
@@ -17,6 +17,12 @@
 
 #include "common/common_pch.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "common/mm_io.h"
 
 class mm_write_buffer_io_c: public mm_proxy_io_c {
@@ -25,23 +31,45 @@ protected:
   unsigned char *m_buffer;
   size_t m_fill;
   const size_t m_size;
-  bool m_debug_seek, m_debug_write;
+  bool m_debug_seek, m_debug_write, m_closed, m_destructing;
+
+  // Asynchronous mode: full buffers are queued and written by a
+  // separate thread. At most m_num_async_buffers may be queued at
+  // any time.
+  unsigned int m_num_async_buffers;
+  int64_t m_async_position;
+  std::thread m_writer;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<memory_cptr> m_queue, m_free_buffers;
+  bool m_writer_stop;
+  std::exception_ptr m_writer_exception;
 
 public:
-  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true);
+  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true, unsigned int num_async_buffers = 0);
   virtual ~mm_write_buffer_io_c();
 
   virtual uint64 getFilePointer();
   virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  // Both write all buffered data and throw if that fails, including
+  // errors the asynchronous writer has run into. The destructor only
+  // warns about such errors, so callers that care must close()
+  // explicitly. Writing after close() throws.
   virtual void flush();
   virtual void close();
 
-  static mm_io_cptr open(const std::string &file_name, size_t buffer_size);
+  static mm_io_cptr open(const std::string &file_name, size_t buffer_size, unsigned int num_async_buffers = 0);
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
   virtual void flush_buffer();
+
+  virtual void queue_buffer();
+  virtual void rethrow_writer_exception(std::unique_lock<std::mutex> &lock);
+  virtual void wait_for_writer();
+  virtual void stop_writer();
+  virtual void run_writer();
 };
 typedef std::shared_ptr<mm_write_buffer_io_c> mm_write_buffer_io_cptr;
 
@@ -27,6 +27,7 @@
 #include "common/math.h"
 #include "common/mm_io.h"
 #include "common/mpeg4_p10.h"
+#include "common/start_code.h"
 #include "common/strings/formatting.h"
 
 namespace mpeg4 {
@@ -75,20 +76,12 @@ gecopy(bit_cursor_c &r,
 
 static int
 geread(bit_cursor_c &r) {
-  int	n = 0, bit;
-
-  while ((bit = r.get_bit()) == 0)
-    ++n;
-
-  bit = r.get_bits(n);
-
-  return (1 << n) - 1 + bit;
+  return r.get_unsigned_golomb();
 }
 
 static int
 sgeread(bit_cursor_c &r) {
-  int v = geread(r);
-  return v & 1 ? (v + 1) / 2 : -(v / 2);
+  return r.get_signed_golomb();
 }
 
 static int
@@ -483,7 +476,7 @@ bool
 mpeg4::p10::parse_pps(memory_cptr &buffer,
                       pps_info_t &pps) {
   try {
-    bit_cursor_c r(buffer->get_buffer(), buffer->get_size());
+    bit_cursor_c r(buffer->get_buffer(), buffer->get_size(), true);
 
     memset(&pps, 0, sizeof(pps));
 
@@ -699,61 +692,53 @@ mpeg4::p10::avc_es_parser_c::discard_actual_frames(bool discard) {
 void
 mpeg4::p10::avc_es_parser_c::add_bytes(unsigned char *buffer,
                                        size_t size) {
-  memory_slice_cursor_c cursor;
-  int marker_size              = 0;
-  int previous_marker_size     = 0;
-  int previous_pos             = -1;
   uint64_t previous_parsed_pos = m_parsed_position;
+  size_t unparsed_size         = m_unparsed_buffer ? m_unparsed_buffer->get_size() : 0;
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
+  memory_cptr data;
+  if (unparsed_size) {
+    m_unparsed_buffer->add(buffer, size);
+    data = m_unparsed_buffer;
+  } else
+    data = memory_cptr(new memory_c(buffer, size, false));
 
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
+  unsigned char *start      = data->get_buffer();
+  unsigned char *end        = start + data->get_size();
+  unsigned char *scan_from  = start;
+  unsigned char *previous   = nullptr;
+  int previous_marker_size  = 0;
 
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          memory_cptr nalu(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          m_parsed_position = previous_parsed_pos + previous_pos;
-          handle_nalu(nalu);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
+  while (true) {
+    unsigned char *code = mtx::start_code::find(scan_from, end);
+    if (code == end)
+      break;
 
-      if (!cursor.char_available())
-        break;
+    // 00 00 00 01 is a four byte marker.
+    int marker_size       = (code > start) && !code[-1] ? 4 : 3;
+    unsigned char *marker = code - (marker_size - 3);
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+    if (previous) {
+      m_parsed_position = previous_parsed_pos + (previous - start);
+      handle_nalu(memory_c::clone(previous + previous_marker_size, marker - previous - previous_marker_size));
     }
+
+    previous             = marker;
+    previous_marker_size = marker_size;
+    scan_from            = std::max(code + 3, mtx::start_code::first_unsearched(start, unparsed_size, 3));
   }
 
-  if (-1 == previous_pos)
-    previous_pos = 0;
+  size_t previous_pos = previous ? previous - start : 0;
 
   m_stream_position += size;
   m_parsed_position  = previous_parsed_pos + previous_pos;
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    m_unparsed_buffer = memory_cptr(new memory_c(safemalloc(new_size), new_size, true));
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
+  if (!previous_pos && unparsed_size)
+    return;
 
-  } else
+  size_t new_size = data->get_size() - previous_pos;
+  if (0 != new_size)
+    m_unparsed_buffer = memory_c::clone(start + previous_pos, new_size);
+  else
     m_unparsed_buffer.reset();
 }
 
@@ -974,10 +959,8 @@ void
 mpeg4::p10::avc_es_parser_c::handle_pps_nalu(memory_cptr &nalu) {
   pps_info_t pps_info;
 
-  nalu_to_rbsp(nalu);
   if (!parse_pps(nalu, pps_info))
     return;
-  rbsp_to_nalu(nalu);
 
   size_t i;
   for (i = 0; m_pps_info_list.size() > i; ++i)
@@ -1003,9 +986,7 @@ mpeg4::p10::avc_es_parser_c::handle_pps_nalu(memory_cptr &nalu) {
 void
 mpeg4::p10::avc_es_parser_c::handle_sei_nalu(memory_cptr &nalu) {
   try {
-    nalu_to_rbsp(nalu);
-
-    bit_cursor_c r(nalu->get_buffer(), nalu->get_size());
+    bit_cursor_c r(nalu->get_buffer(), nalu->get_size(), true);
 
     r.skip_bits(8);
 
@@ -1094,7 +1075,7 @@ bool
 mpeg4::p10::avc_es_parser_c::parse_slice(memory_cptr &buffer,
                                          slice_info_t &si) {
   try {
-    bit_cursor_c r(buffer->get_buffer(), buffer->get_size());
+    bit_cursor_c r(buffer->get_buffer(), buffer->get_size(), true);
 
     memset(&si, 0, sizeof(si));
 
@@ -136,6 +136,8 @@ void nalu_to_rbsp(memory_cptr &buffer);
 void rbsp_to_nalu(memory_cptr &buffer);
 
 bool parse_sps(memory_cptr &buffer, sps_info_t &sps, bool keep_ar_info = false);
+// Unlike parse_sps() parse_pps() expects the NALU with its emulation
+// prevention bytes intact.
 bool parse_pps(memory_cptr &buffer, pps_info_t &pps);
 
 bool extract_par(uint8_t *&buffer, size_t &buffer_size, uint32_t &par_num, uint32_t &par_den);
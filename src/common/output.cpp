@@ -13,6 +13,9 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
+#include <thread>
+
 #include "common/ebml.h"
 #include "common/endian.h"
 #include "common/locale.h"
@@ -40,6 +43,7 @@ charset_converter_cptr g_cc_stdio = charset_converter_cptr(new charset_converter
 std::shared_ptr<mm_io_c> g_mm_stdio   = std::shared_ptr<mm_io_c>(new mm_stdio_c);
 
 static mxmsg_handler_t s_mxmsg_info_handler, s_mxmsg_warning_handler, s_mxmsg_error_handler;
+static std::thread::id s_main_thread_id;
 
 void
 redirect_stdio(const mm_io_cptr &stdio) {
@@ -65,14 +69,31 @@ set_mxmsg_handler(unsigned int level,
     assert(false);
 }
 
+mxmsg_handler_t
+get_mxmsg_handler(unsigned int level) {
+  if (MXMSG_INFO == level)
+    return s_mxmsg_info_handler;
+  else if (MXMSG_WARNING == level)
+    return s_mxmsg_warning_handler;
+  else if (MXMSG_ERROR == level)
+    return s_mxmsg_error_handler;
+
+  assert(false);
+  return mxmsg_handler_t{};
+}
+
 void
 mxmsg(unsigned int level,
       std::string message) {
   static bool s_saw_cr_after_nl = false;
+  static std::mutex s_mutex;
 
   if (g_suppress_info && (MXMSG_INFO == level))
     return;
 
+  // mkvmerge's reader threads may output messages concurrently.
+  std::lock_guard<std::mutex> lock(s_mutex);
+
   if ('\n' == message[0]) {
     message.erase(0, 1);
     g_mm_stdio->puts("\n");
@@ -143,6 +164,12 @@ mxwarn(std::string const &warning) {
 static void
 default_mxerror(unsigned int,
                 std::string const &error) {
+  // Exiting from a worker thread would tear down the program while
+  // the main thread is still using it. The worker's owner reports the
+  // error with rethrow_worker_exception() instead.
+  if (std::this_thread::get_id() != s_main_thread_id)
+    throw mtx::output::error_x(error);
+
   mxmsg(MXMSG_ERROR, error);
   mxexit(2);
 }
@@ -152,6 +179,23 @@ mxerror(std::string const &error) {
   s_mxmsg_error_handler(MXMSG_ERROR, error);
 }
 
+/** \brief Rethrows an exception a worker thread has passed on
+
+   Errors the worker has reported with mxerror() are reported again on
+   the calling thread. On the main thread this terminates the program
+   the same way it would have if the error had occurred there.
+ */
+void
+rethrow_worker_exception(std::exception_ptr const &error) {
+  try {
+    std::rethrow_exception(error);
+
+  } catch (mtx::output::error_x &ex) {
+    mxerror(ex.error());
+    throw;
+  }
+}
+
 void
 mxinfo_fn(const std::string &file_name,
           const std::string &info) {
@@ -214,6 +258,8 @@ mxverb_tid(unsigned int level,
 
 void
 init_common_output() {
+  s_main_thread_id = std::this_thread::get_id();
+
   set_cc_stdio(get_local_console_charset());
   set_mxmsg_handler(MXMSG_INFO,    default_mxinfo);
   set_mxmsg_handler(MXMSG_WARNING, default_mxwarn);
@@ -16,6 +16,7 @@
 
 #include "common/os.h"
 
+#include <exception>
 #include <functional>
 
 #include <ebml/EbmlElement.h>
@@ -27,6 +28,7 @@ using namespace libebml;
 
 typedef std::function<void(unsigned int level, std::string const &)> mxmsg_handler_t;
 void set_mxmsg_handler(unsigned int level, mxmsg_handler_t const &handler);
+mxmsg_handler_t get_mxmsg_handler(unsigned int level);
 
 extern bool g_suppress_info, g_suppress_warnings;
 extern std::string g_stdio_charset;
@@ -62,12 +64,35 @@ mxwarn(const boost::format &warning) {
   mxwarn(warning.str());
 }
 
+namespace mtx {
+  namespace output {
+    // Thrown by the default error handler instead of exiting if
+    // mxerror() is called from a thread other than the main thread.
+    class error_x: public exception {
+    protected:
+      std::string m_error;
+    public:
+      error_x(std::string const &error)
+        : m_error(error)
+      {
+      }
+      virtual ~error_x() throw() { }
+
+      virtual const char *what() const throw() {
+        return m_error.c_str();
+      }
+    };
+  }
+}
+
 void mxerror(const std::string &error);
 inline void
 mxerror(const boost::format &error) {
   mxerror(error.str());
 }
 
+void rethrow_worker_exception(std::exception_ptr const &error);
+
 #define mxverb(level, message)        \
   if (verbose >= level)               \
     mxinfo(message);
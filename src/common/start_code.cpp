@@ -0,0 +1,176 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   searching for start codes and markers in elementary streams
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include "common/start_code.h"
+
+namespace mtx { namespace start_code {
+
+namespace {
+
+#if defined(__AVX2__)
+
+size_t const s_vector_size = 32;
+typedef __m256i vector_t;
+
+inline vector_t
+equal_to(unsigned char const *p,
+         unsigned char value) {
+  return _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)), _mm256_set1_epi8(static_cast<char>(value)));
+}
+
+inline vector_t
+both(vector_t a,
+     vector_t b) {
+  return _mm256_and_si256(a, b);
+}
+
+inline uint32_t
+to_mask(vector_t v) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+#elif defined(__SSE2__)
+
+size_t const s_vector_size = 16;
+typedef __m128i vector_t;
+
+inline vector_t
+equal_to(unsigned char const *p,
+         unsigned char value) {
+  return _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), _mm_set1_epi8(static_cast<char>(value)));
+}
+
+inline vector_t
+both(vector_t a,
+     vector_t b) {
+  return _mm_and_si128(a, b);
+}
+
+inline uint32_t
+to_mask(vector_t v) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+#endif
+
+inline unsigned int
+lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  unsigned int bit = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// Finds the first position at which all num_bytes bytes of pattern
+// match. The vector loop compares num_bytes shifted loads at once;
+// the remaining bytes are checked one at a time.
+template<size_t num_bytes>
+unsigned char const *
+find_pattern(unsigned char const *begin,
+             unsigned char const *end,
+             unsigned char const (&pattern)[num_bytes],
+             bool vectorized = true) {
+  if (static_cast<size_t>(end - begin) < num_bytes)
+    return end;
+
+  auto p = begin;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  while (vectorized && (static_cast<size_t>(end - p) >= (s_vector_size + num_bytes - 1))) {
+    auto matches = equal_to(p, pattern[0]);
+    for (size_t idx = 1; num_bytes > idx; ++idx)
+      matches = both(matches, equal_to(p + idx, pattern[idx]));
+
+    auto mask = to_mask(matches);
+    if (mask)
+      return p + lowest_bit(mask);
+
+    p += s_vector_size;
+  }
+#else
+  (void)vectorized;
+#endif
+
+  auto last = end - num_bytes;
+  for (; p <= last; ++p) {
+    size_t idx = 0;
+    while ((num_bytes > idx) && (p[idx] == pattern[idx]))
+      ++idx;
+
+    if (num_bytes == idx)
+      return p;
+  }
+
+  return end;
+}
+
+unsigned char const s_start_code[3] = { 0x00, 0x00, 0x01 };
+
+unsigned char const *
+find_marker(unsigned char const *begin,
+            unsigned char const *end,
+            uint32_t marker,
+            bool vectorized) {
+  unsigned char const pattern[4] = {
+    static_cast<unsigned char>((marker >> 24) & 0xff),
+    static_cast<unsigned char>((marker >> 16) & 0xff),
+    static_cast<unsigned char>((marker >>  8) & 0xff),
+    static_cast<unsigned char>( marker        & 0xff),
+  };
+
+  return find_pattern(begin, end, pattern, vectorized);
+}
+
+}
+
+unsigned char const *
+find(unsigned char const *begin,
+     unsigned char const *end) {
+  return find_pattern(begin, end, s_start_code);
+}
+
+unsigned char const *
+find_marker(unsigned char const *begin,
+            unsigned char const *end,
+            uint32_t marker) {
+  return find_marker(begin, end, marker, true);
+}
+
+unsigned char const *
+find_scalar(unsigned char const *begin,
+            unsigned char const *end) {
+  return find_pattern(begin, end, s_start_code, false);
+}
+
+unsigned char const *
+find_marker_scalar(unsigned char const *begin,
+                   unsigned char const *end,
+                   uint32_t marker) {
+  return find_marker(begin, end, marker, false);
+}
+
+}}
@@ -0,0 +1,87 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   searching for start codes and markers in elementary streams
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_START_CODE_H
+#define __MTX_COMMON_START_CODE_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace start_code {
+
+/** \brief Find the next \c 00 00 01 byte sequence
+
+   Searches the range <tt>[begin, end)</tt>. All three bytes of the
+   sequence must lie inside the range. Uses SSE2 or AVX2 if the
+   compiler targets them.
+
+   \return A pointer to the first \c 00 byte of the first start code
+     found or \c end if there's none.
+*/
+unsigned char const *find(unsigned char const *begin, unsigned char const *end);
+
+/** \brief Find the next occurrence of a four-byte marker
+
+   \c marker is compared in big endian byte order. All four bytes must
+   lie inside the range <tt>[begin, end)</tt>.
+
+   \return A pointer to the first byte of the first marker found or \c
+     end if there's none.
+*/
+unsigned char const *find_marker(unsigned char const *begin, unsigned char const *end, uint32_t marker);
+
+/** \brief Reference implementations without vector instructions
+
+   They return the same results as \c find() and \c find_marker() and
+   are only meant for comparing against those.
+*/
+unsigned char const *find_scalar(unsigned char const *begin, unsigned char const *end);
+unsigned char const *find_marker_scalar(unsigned char const *begin, unsigned char const *end, uint32_t marker);
+
+/** \brief Where searching buffered elementary stream data has to resume
+
+   The ES parsers append new data to the data left unparsed by earlier
+   calls, or use the caller's buffer directly if nothing was left
+   over, and search the result as one contiguous buffer. The unparsed
+   data has already been searched except for its last <tt>pattern_size
+   - 1</tt> bytes, which may be the start of a pattern completed by
+   the new data.
+
+   \param start The start of the buffer searched.
+   \param num_unparsed_bytes The number of bytes left unparsed by
+     earlier calls at the buffer's start.
+   \param pattern_size The size of the pattern searched for.
+   \return The first position that hasn't been searched yet.
+*/
+inline unsigned char *
+first_unsearched(unsigned char *start,
+                 size_t num_unparsed_bytes,
+                 size_t pattern_size) {
+  return start + std::max(num_unparsed_bytes, pattern_size - 1) - (pattern_size - 1);
+}
+
+inline unsigned char *
+find(unsigned char *begin,
+     unsigned char *end) {
+  return const_cast<unsigned char *>(find(const_cast<unsigned char const *>(begin), const_cast<unsigned char const *>(end)));
+}
+
+inline unsigned char *
+find_marker(unsigned char *begin,
+            unsigned char *end,
+            uint32_t marker) {
+  return const_cast<unsigned char *>(find_marker(const_cast<unsigned char const *>(begin), const_cast<unsigned char const *>(end), marker));
+}
+
+}}
+
+#endif // __MTX_COMMON_START_CODE_H
@@ -18,33 +18,52 @@
 #include "common/terminal.h"
 #include "common/translation.h"
 
+// Appends the decimal representation of value padded with zeros to
+// at least num_digits digits.
+static void
+append_zero_padded(std::string &dest,
+                   uint64_t value,
+                   unsigned int num_digits) {
+  char digits[20];
+  char *end   = digits + sizeof(digits);
+  char *start = end;
+
+  do {
+    *--start  = '0' + value % 10;
+    value    /= 10;
+  } while (value);
+
+  if (static_cast<unsigned int>(end - start) < num_digits)
+    dest.append(num_digits - (end - start), '0');
+  dest.append(start, end);
+}
+
 std::string
 format_timecode(int64_t timecode,
                 unsigned int precision) {
-  static boost::format s_bf_format("%4%%|1$02d|:%|2$02d|:%|3$02d|");
-  static boost::format s_bf_decimals(".%|1$09d|");
-
-
   bool negative = 0 > timecode;
   if (negative)
     timecode *= -1;
 
-  std::string result = (s_bf_format
-                        % static_cast<int>( timecode / 60 / 60 / 1000000000)
-                        % static_cast<int>((timecode      / 60 / 1000000000) % 60)
-                        % static_cast<int>((timecode           / 1000000000) % 60)
-                        % (negative ? "-" : "")).str();
+  std::string result;
+  if (negative)
+    result += '-';
+
+  append_zero_padded(result,  timecode / 60 / 60 / 1000000000,       2);
+  result += ':';
+  append_zero_padded(result, (timecode      / 60 / 1000000000) % 60, 2);
+  result += ':';
+  append_zero_padded(result, (timecode           / 1000000000) % 60, 2);
 
   if (9 < precision)
     precision = 9;
 
   if (precision) {
-    std::string decimals = (s_bf_decimals % (int)(timecode % 1000000000)).str();
-
-    if (decimals.length() > (precision + 1))
-      decimals.erase(precision + 1);
+    std::string decimals;
+    append_zero_padded(decimals, timecode % 1000000000, 9);
 
-    result += decimals;
+    result += '.';
+    result.append(decimals, 0, precision);
   }
 
   return result;
@@ -70,11 +89,16 @@ to_string(int64_t numerator,
   if (0 == fractional_part)
     return output;
 
-  static boost::format s_bf_precision_format_format(".%%0%1%d");
+  // Same as printf()'s ".%0<precision>d": the sign counts towards
+  // the width.
+  output += '.';
+  if (0 > fractional_part) {
+    output += '-';
+    append_zero_padded(output, -fractional_part, precision ? precision - 1 : 0);
+  } else
+    append_zero_padded(output, fractional_part, precision);
 
-  std::string format         = (s_bf_precision_format_format % precision).str();
-  output                    += (boost::format(format) % fractional_part).str();
-  std::string::iterator end  = output.end() - 1;
+  std::string::iterator end = output.end() - 1;
 
   while (*end == '0')
     --end;
@@ -230,12 +254,17 @@ std::string
 to_hex(const unsigned char *buf,
        size_t size,
        bool compact) {
-  static boost::format s_bf_to_hex("0x%|1$02x|");
-  static boost::format s_bf_to_hex_compact("%|1$02x|");
+  static char const s_hex_digits[] = "0123456789abcdef";
 
   std::string hex;
-  for (size_t idx = 0; idx < size; ++idx)
-    hex += (compact || hex.empty() ? std::string{""} : std::string{" "}) + ((compact ? s_bf_to_hex_compact : s_bf_to_hex) % static_cast<unsigned int>(buf[idx])).str();
+  hex.reserve(size * (compact ? 2 : 5));
+
+  for (size_t idx = 0; idx < size; ++idx) {
+    if (!compact)
+      hex += idx ? " 0x" : "0x";
+    hex += s_hex_digits[buf[idx] >> 4];
+    hex += s_hex_digits[buf[idx] & 0x0f];
+  }
 
   return hex;
 }
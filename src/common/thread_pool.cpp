@@ -0,0 +1,69 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a simple pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/thread_pool.h"
+
+thread_pool_c::thread_pool_c(size_t num_threads)
+  : m_num_threads(std::max<size_t>(num_threads, 1))
+  , m_stop(false)
+{
+  size_t idx;
+  for (idx = 0; m_num_threads > idx; ++idx)
+    m_threads.push_back(std::thread(&thread_pool_c::run, this));
+}
+
+thread_pool_c::~thread_pool_c() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_cond.notify_all();
+  }
+
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+void
+thread_pool_c::enqueue(std::function<void()> const &job) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_jobs.push_back(job);
+  m_cond.notify_one();
+}
+
+void
+thread_pool_c::run() {
+  while (true) {
+    std::function<void()> job;
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return !m_jobs.empty() || m_stop; });
+
+      if (m_stop)
+        return;
+
+      job = m_jobs.front();
+      m_jobs.pop_front();
+    }
+
+    job();
+  }
+}
+
+thread_pool_c &
+thread_pool_c::global() {
+  static thread_pool_c s_pool(std::thread::hardware_concurrency());
+  return s_pool;
+}
@@ -0,0 +1,74 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a simple pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef __MTX_COMMON_THREAD_POOL_H
+#define __MTX_COMMON_THREAD_POOL_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/** \brief Runs jobs on a fixed number of worker threads
+
+   Jobs are run in the order they've been enqueued. The destructor
+   waits for the jobs currently running, discards all others and joins
+   the worker threads.
+*/
+class thread_pool_c {
+protected:
+  std::deque<std::function<void()> > m_jobs;
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  size_t m_num_threads;
+  bool m_stop;
+
+public:
+  thread_pool_c(size_t num_threads);
+  ~thread_pool_c();
+
+  void enqueue(std::function<void()> const &job);
+
+  size_t get_num_threads() const {
+    return m_num_threads;
+  }
+
+  // One thread per CPU; created on first use and destroyed on exit.
+  static thread_pool_c &global();
+
+protected:
+  void run();
+};
+
+/** \brief Waits for the result of a job run on a thread pool
+
+   Errors the job has reported with \c mxerror() are reported again on
+   the calling thread. All other exceptions are passed on unchanged.
+*/
+template<typename T> T
+get_job_result(std::future<T> &result) {
+  try {
+    return result.get();
+
+  } catch (mtx::output::error_x &ex) {
+    mxerror(ex.error());
+    throw;
+  }
+}
+
+#endif  // __MTX_COMMON_THREAD_POOL_H
@@ -16,6 +16,7 @@
 
 #include "common/bit_cursor.h"
 #include "common/endian.h"
+#include "common/start_code.h"
 #include "common/strings/formatting.h"
 #include "common/vc1.h"
 
@@ -296,51 +297,44 @@ vc1::es_parser_c::~es_parser_c() {
 void
 vc1::es_parser_c::add_bytes(unsigned char *buffer,
                             int size) {
-  memory_slice_cursor_c cursor;
-
-  int previous_pos            = -1;
   int64_t previous_stream_pos = m_stream_pos;
+  size_t unparsed_size        = m_unparsed_buffer ? m_unparsed_buffer->get_size() : 0;
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker = (1 << 24) | ((unsigned int)cursor.get_char() << 16) | ((unsigned int)cursor.get_char() << 8) | (unsigned int)cursor.get_char();
-
-    while (1) {
-      if (vc1::is_marker(marker)) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - 4 - previous_pos;
-
-          memory_cptr packet(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(packet->get_buffer(), previous_pos, new_size);
+  memory_cptr data;
+  if (unparsed_size) {
+    m_unparsed_buffer->add(buffer, size);
+    data = m_unparsed_buffer;
+  } else
+    data = memory_cptr(new memory_c(buffer, size, false));
 
-          handle_packet(packet);
-        }
+  unsigned char *start     = data->get_buffer();
+  unsigned char *end       = start + data->get_size();
+  unsigned char *scan_from = start;
+  unsigned char *previous  = nullptr;
 
-        previous_pos = cursor.get_position() - 4;
-        m_stream_pos = previous_stream_pos + previous_pos;
-      }
+  // A marker consists of the start code and one more byte.
+  while (4 <= (end - scan_from)) {
+    unsigned char *marker = mtx::start_code::find(scan_from, end - 1);
+    if (marker == (end - 1))
+      break;
 
-      if (!cursor.char_available())
-        break;
+    if (previous)
+      handle_packet(memory_c::clone(previous, marker - previous));
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
-    }
+    previous     = marker;
+    m_stream_pos = previous_stream_pos + (previous - start);
+    scan_from    = std::max(marker + 1, mtx::start_code::first_unsearched(start, unparsed_size, 4));
   }
 
-  if (-1 == previous_pos)
-    previous_pos = 0;
+  size_t previous_pos = previous ? previous - start : 0;
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    memory_cptr new_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(new_unparsed_buffer->get_buffer(), previous_pos, new_size);
-    m_unparsed_buffer = new_unparsed_buffer;
+  if (!previous_pos && unparsed_size)
+    return;
 
-  } else
+  size_t new_size = data->get_size() - previous_pos;
+  if (0 != new_size)
+    m_unparsed_buffer = memory_c::clone(start + previous_pos, new_size);
+  else
     m_unparsed_buffer.reset();
 }
 
@@ -107,6 +107,42 @@ vint_c::read_ebml_id(mm_io_cptr &in) {
   return read(in.get(), rm_ebml_id);
 }
 
+vint_c
+vint_c::read(unsigned char const *buffer,
+             size_t buffer_size,
+             vint_c::read_mode_e read_mode) {
+  if (!buffer_size || !buffer[0])
+    return vint_c();
+
+  int mask      = 0x80;
+  int value_len = 1;
+
+  while (!(buffer[0] & mask)) {
+    mask >>= 1;
+    value_len++;
+  }
+
+  if (   (static_cast<size_t>(value_len) > buffer_size)
+      || ((rm_ebml_id == read_mode) && (4 < value_len)))
+    return vint_c();
+
+  int64_t value = buffer[0];
+  if (rm_normal == read_mode)
+    value &= ~mask;
+
+  int i;
+  for (i = 1; i < value_len; ++i)
+    value = (value << 8) | buffer[i];
+
+  return vint_c(value, value_len);
+}
+
+vint_c
+vint_c::read_ebml_id(unsigned char const *buffer,
+                     size_t buffer_size) {
+  return read(buffer, buffer_size, rm_ebml_id);
+}
+
 vint_c::operator EbmlId()
   const {
   return EbmlId(m_value, m_coded_size);
@@ -45,6 +45,9 @@ public:                         // static functions
 
   static vint_c read_ebml_id(mm_io_c *in);
   static vint_c read_ebml_id(mm_io_cptr &in);
+
+  static vint_c read(unsigned char const *buffer, size_t buffer_size, read_mode_e read_mode = rm_normal);
+  static vint_c read_ebml_id(unsigned char const *buffer, size_t buffer_size);
 };
 
 #endif  // __MTX_COMMON_VINT_H
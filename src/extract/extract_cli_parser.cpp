@@ -68,6 +68,8 @@ extract_cli_parser_c::init_parser() {
   OPT("blockadd=level", set_blockadd, YT("Keep only the BlockAdditions up to this level (default: keep all levels)"));
   OPT("raw",            set_raw,      YT("Extract the data to a raw file."));
   OPT("fullraw",        set_fullraw,  YT("Extract the data to a raw file including the CodecPrivate as a header."));
+  OPT("start=timecode", set_range_start, YT("Start extracting at the key frame at or before this timecode. The file's index is used for jumping there directly."));
+  OPT("stop=timecode",  set_range_stop,  YT("Stop extracting at this timecode."));
   add_informational_option("TID:out", YT("Write track with the ID TID to the file 'out'."));
 
   add_section_header(YT("Example"));
@@ -166,6 +168,20 @@ extract_cli_parser_c::set_fullraw() {
   m_target_mode = track_spec_t::tm_full_raw;
 }
 
+void
+extract_cli_parser_c::set_range_start() {
+  assert_mode(options_c::em_tracks);
+  if (!parse_timecode(m_next_arg, m_options.m_range_start))
+    mxerror(boost::format(Y("Invalid start time in argument '%1%': %2%\n")) % m_next_arg % timecode_parser_error);
+}
+
+void
+extract_cli_parser_c::set_range_stop() {
+  assert_mode(options_c::em_tracks);
+  if (!parse_timecode(m_next_arg, m_options.m_range_stop))
+    mxerror(boost::format(Y("Invalid stop time in argument '%1%': %2%\n")) % m_next_arg % timecode_parser_error);
+}
+
 void
 extract_cli_parser_c::set_simple() {
   assert_mode(options_c::em_chapters);
@@ -259,5 +275,8 @@ extract_cli_parser_c::run() {
 
   parse_args();
 
+  if ((-1 != m_options.m_range_start) && (-1 != m_options.m_range_stop) && (m_options.m_range_stop <= m_options.m_range_start))
+    mxerror(Y("The stop time must be bigger than the start time.\n"));
+
   return m_options;
 }
@@ -44,6 +44,8 @@ protected:
   void set_blockadd();
   void set_raw();
   void set_fullraw();
+  void set_range_start();
+  void set_range_stop();
   void set_simple();
   void set_mode_or_extraction_spec();
   void set_extraction_mode();
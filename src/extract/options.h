@@ -30,6 +30,9 @@ public:
   kax_analyzer_c::parse_mode_e m_parse_mode;
   extraction_mode_e m_extraction_mode;
 
+  // Time range for track extraction (--start/--stop), -1 if unset
+  int64_t m_range_start, m_range_stop;
+
   std::vector<track_spec_t> m_tracks;
 
 public:
@@ -13,6 +13,11 @@
 #include "common/common_pch.h"
 
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <ebml/EbmlHead.h>
 #include <ebml/EbmlSubHead.h>
@@ -24,8 +29,11 @@
 #include <matroska/KaxBlockData.h>
 #include <matroska/KaxCluster.h>
 #include <matroska/KaxClusterData.h>
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
 #include <matroska/KaxInfo.h>
 #include <matroska/KaxInfoData.h>
+#include <matroska/KaxSeekHead.h>
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxTracks.h>
 #include <matroska/KaxTrackEntryData.h>
@@ -33,6 +41,7 @@
 #include <matroska/KaxTrackVideo.h>
 
 #include "common/ebml.h"
+#include "common/kax_cues.h"
 #include "common/kax_file.h"
 #include "common/matroska.h"
 #include "common/mm_write_buffer_io.h"
@@ -43,6 +52,265 @@ using namespace libmatroska;
 
 static std::vector<xtr_base_c *> extractors;
 
+// Time range to extract: frames are passed to an extractor starting
+// with its first key frame at or after m_offset, which is the time of
+// the cue point the extraction started at.
+struct extraction_range_t {
+  int64_t m_start, m_stop, m_offset;
+  std::set<xtr_base_c *> m_started;
+
+  extraction_range_t(int64_t start,
+                     int64_t stop)
+    : m_start(start)
+    , m_stop(stop)
+    , m_offset(-1 == start ? 0 : start)
+  {
+  }
+
+  bool contains(xtr_base_c *extractor, int64_t timecode, bool keyframe);
+};
+
+// ------------------------------------------------------------------------
+
+/** \brief A frame or codec state waiting to be handed to an extractor
+
+   The frame data points into the cluster it was read from. The job
+   keeps a reference to that cluster so that it isn't freed before the
+   extractor is done with it.
+*/
+struct extraction_job_t {
+  xtr_base_c *m_extractor;
+  std::shared_ptr<EbmlElement> m_cluster;
+  memory_cptr m_frame, m_codec_state;
+  KaxBlockAdditions *m_additions;
+  int64_t m_timecode, m_duration, m_bref, m_fref;
+  bool m_keyframe, m_discardable, m_references_valid;
+
+  extraction_job_t()
+    : m_extractor(nullptr)
+    , m_additions(nullptr)
+    , m_timecode(0)
+    , m_duration(0)
+    , m_bref(0)
+    , m_fref(0)
+    , m_keyframe(false)
+    , m_discardable(false)
+    , m_references_valid(false)
+  {
+  }
+
+  void run() {
+    if (m_codec_state)
+      m_extractor->handle_codec_state(m_codec_state);
+    else
+      m_extractor->handle_frame(m_frame, m_additions, m_timecode, m_duration, m_bref, m_fref, m_keyframe, m_discardable, m_references_valid);
+  }
+};
+
+/** \brief Runs the extractors writing to one output file on their own thread
+
+   Content decoding, codec specific conversions and writing happen on
+   the worker's thread while the main thread keeps parsing
+   clusters. Extractors sharing an output file (e.g. VobSub or RealMedia
+   with several tracks) use the same worker so that they are never run
+   concurrently.
+
+   An error ends the worker's thread, including errors the extractors
+   report with mxerror(). The main thread reports it after all workers
+   have been finished.
+*/
+class extraction_worker_c {
+protected:
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<extraction_job_t> m_jobs;
+  size_t m_queued_bytes;
+  bool m_threaded, m_stop;
+  std::exception_ptr m_exception;
+
+  static size_t const s_max_queued_bytes = 16 * 1024 * 1024;
+
+public:
+  extraction_worker_c(bool threaded)
+    : m_queued_bytes(0)
+    , m_threaded(threaded)
+    , m_stop(false)
+  {
+    if (m_threaded)
+      m_thread = std::thread(&extraction_worker_c::run, this);
+  }
+
+  ~extraction_worker_c() {
+    finish();
+  }
+
+  // Returns false without queueing the job if the worker has run into
+  // an error. finish() returns that error.
+  bool queue(extraction_job_t &&job) {
+    if (!m_threaded) {
+      job.run();
+      return true;
+    }
+
+    size_t size = job.m_frame ? job.m_frame->get_size() : job.m_codec_state->get_size();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_cond.wait(lock, [this]() { return m_exception || (s_max_queued_bytes > m_queued_bytes) || m_jobs.empty(); });
+
+    if (m_exception)
+      return false;
+
+    m_jobs.push_back(std::move(job));
+    m_queued_bytes += size;
+
+    m_cond.notify_all();
+
+    return true;
+  }
+
+  std::exception_ptr finish() {
+    if (!m_thread.joinable())
+      return m_exception;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+      m_cond.notify_all();
+    }
+
+    m_thread.join();
+
+    return m_exception;
+  }
+
+protected:
+  void run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+      m_cond.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+      if (m_jobs.empty())
+        return;
+
+      extraction_job_t job = std::move(m_jobs.front());
+      size_t size          = job.m_frame ? job.m_frame->get_size() : job.m_codec_state->get_size();
+      m_jobs.pop_front();
+      lock.unlock();
+
+      try {
+        job.run();
+      } catch (...) {
+        lock.lock();
+        m_exception = std::current_exception();
+        m_jobs.clear();
+        m_cond.notify_all();
+        return;
+      }
+
+      // Release the cluster before taking the lock again.
+      job = extraction_job_t();
+
+      lock.lock();
+      m_queued_bytes -= size;
+      m_cond.notify_all();
+    }
+  }
+};
+typedef std::shared_ptr<extraction_worker_c> extraction_worker_cptr;
+
+static std::map<xtr_base_c *, extraction_worker_cptr> workers;
+
+// The jobs of one cluster are collected before they're handed to the
+// workers so that the frames of tracks with expensive content
+// encodings can be decoded in one batch on the thread pool. Those
+// tracks' block decoding is moved from their extractors to
+// s_frame_decoders.
+static std::vector<extraction_job_t> s_cluster_jobs;
+static std::map<xtr_base_c *, content_decoder_c> s_frame_decoders;
+
+static void
+create_workers() {
+  bool threaded = !debugging_requested("no_threaded_extraction");
+  std::map<xtr_base_c *, extraction_worker_cptr> workers_by_master;
+
+  for (auto extractor : extractors) {
+    auto master = extractor;
+    while (master->m_master)
+      master = master->m_master;
+
+    auto &worker = workers_by_master[master];
+    if (!worker)
+      worker = extraction_worker_cptr(new extraction_worker_c(threaded));
+
+    workers[extractor] = worker;
+  }
+
+  s_cluster_jobs.clear();
+  s_frame_decoders.clear();
+
+  if (!threaded || debugging_requested("no_threaded_decoding"))
+    return;
+
+  for (auto extractor : extractors)
+    if (extractor->m_content_decoder.has_expensive_encodings(CONTENT_ENCODING_SCOPE_BLOCK)) {
+      s_frame_decoders[extractor] = extractor->m_content_decoder;
+      extractor->m_content_decoder.remove_scope(CONTENT_ENCODING_SCOPE_BLOCK);
+    }
+}
+
+static void
+finish_workers() {
+  // All workers must be finished before an error is reported as
+  // reporting it may exit the program.
+  std::exception_ptr error;
+  for (auto &worker : workers) {
+    auto worker_error = worker.second->finish();
+    if (!error)
+      error = worker_error;
+  }
+
+  workers.clear();
+
+  if (error)
+    rethrow_worker_exception(error);
+}
+
+static void
+queue_cluster_jobs() {
+  for (auto &decoder : s_frame_decoders) {
+    std::vector<memory_cptr> frames;
+    for (auto &job : s_cluster_jobs)
+      if ((job.m_extractor == decoder.first) && job.m_frame)
+        frames.push_back(job.m_frame);
+
+    if (frames.empty())
+      continue;
+
+    decoder.second.reverse(frames, CONTENT_ENCODING_SCOPE_BLOCK);
+
+    auto frame = frames.begin();
+    for (auto &job : s_cluster_jobs)
+      if ((job.m_extractor == decoder.first) && job.m_frame)
+        job.m_frame = *frame++;
+  }
+
+  bool failed = false;
+  for (auto &job : s_cluster_jobs)
+    if (!workers[job.m_extractor]->queue(std::move(job))) {
+      failed = true;
+      break;
+    }
+
+  s_cluster_jobs.clear();
+
+  // Reports the error the worker has run into.
+  if (failed)
+    finish_workers();
+}
+
 // ------------------------------------------------------------------------
 
 static void
@@ -118,11 +386,39 @@ create_extractors(KaxTracks &kax_tracks,
   // Signal that all headers have been taken care of.
   for (i = 0; i < extractors.size(); i++)
     extractors[i]->headers_done();
+
+  create_workers();
+}
+
+bool
+extraction_range_t::contains(xtr_base_c *extractor,
+                              int64_t timecode,
+                              bool keyframe) {
+  if ((-1 != m_stop) && (timecode >= m_stop))
+    return false;
+
+  if (-1 == m_start)
+    return true;
+
+  if (timecode < m_offset)
+    return false;
+
+  if (map_has_key(m_started, extractor))
+    return true;
+
+  if (!keyframe)
+    return false;
+
+  m_started.insert(extractor);
+
+  return true;
 }
 
 static void
 handle_blockgroup(KaxBlockGroup &blockgroup,
                   KaxCluster &cluster,
+                  std::shared_ptr<EbmlElement> const &cluster_ref,
+                  extraction_range_t &range,
                   int64_t tc_scale) {
   // Only continue if this block group actually contains a block.
   KaxBlock *block = FindChild<KaxBlock>(&blockgroup);
@@ -150,6 +446,7 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
   int64_t bref                  = 0;
   int64_t fref                  = 0;
   KaxReferenceBlock *kreference = FindChild<KaxReferenceBlock>(&blockgroup);
+  bool keyframe                 = !kreference;
   for (i = 0; (2 > i) && kreference; i++) {
     if (0 > int64(*kreference))
       bref = int64(*kreference);
@@ -166,8 +463,11 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
 
   KaxCodecState *kcstate = FindChild<KaxCodecState>(&blockgroup);
   if (kcstate) {
-    memory_cptr codec_state(new memory_c(kcstate->GetBuffer(), kcstate->GetSize(), false));
-    extractor->handle_codec_state(codec_state);
+    extraction_job_t job;
+    job.m_extractor   = extractor;
+    job.m_cluster     = cluster_ref;
+    job.m_codec_state = memory_cptr(new memory_c(kcstate->GetBuffer(), kcstate->GetSize(), false));
+    s_cluster_jobs.push_back(std::move(job));
   }
 
   for (i = 0; i < block->NumberFrames(); i++) {
@@ -182,15 +482,30 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
       this_duration = duration / block->NumberFrames();
     }
 
+    if (!range.contains(extractor, this_timecode, keyframe))
+      continue;
+
     DataBuffer &data = block->GetBuffer(i);
-    memory_cptr frame(new memory_c(data.Buffer(), data.Size(), false));
-    extractor->handle_frame(frame, kadditions, this_timecode, this_duration, bref, fref, false, false, true);
+
+    extraction_job_t job;
+    job.m_extractor        = extractor;
+    job.m_cluster          = cluster_ref;
+    job.m_frame            = memory_cptr(new memory_c(data.Buffer(), data.Size(), false));
+    job.m_additions        = kadditions;
+    job.m_timecode         = this_timecode;
+    job.m_duration         = this_duration;
+    job.m_bref             = bref;
+    job.m_fref             = fref;
+    job.m_references_valid = true;
+    s_cluster_jobs.push_back(std::move(job));
   }
 }
 
 static void
 handle_simpleblock(KaxSimpleBlock &simpleblock,
-                   KaxCluster &cluster) {
+                   KaxCluster &cluster,
+                   std::shared_ptr<EbmlElement> const &cluster_ref,
+                   extraction_range_t &range) {
   if (0 == simpleblock.NumberFrames())
     return;
 
@@ -221,9 +536,22 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
       this_duration = duration / simpleblock.NumberFrames();
     }
 
+    if (!range.contains(extractor, this_timecode, simpleblock.IsKeyframe()))
+      continue;
+
     DataBuffer &data = simpleblock.GetBuffer(i);
-    memory_cptr frame(new memory_c(data.Buffer(), data.Size(), false));
-    extractor->handle_frame(frame, nullptr, this_timecode, this_duration, -1, -1, simpleblock.IsKeyframe(), simpleblock.IsDiscardable(), false);
+
+    extraction_job_t job;
+    job.m_extractor   = extractor;
+    job.m_cluster     = cluster_ref;
+    job.m_frame       = memory_cptr(new memory_c(data.Buffer(), data.Size(), false));
+    job.m_timecode    = this_timecode;
+    job.m_duration    = this_duration;
+    job.m_bref        = -1;
+    job.m_fref        = -1;
+    job.m_keyframe    = simpleblock.IsKeyframe();
+    job.m_discardable = simpleblock.IsDiscardable();
+    s_cluster_jobs.push_back(std::move(job));
   }
 }
 
@@ -231,6 +559,8 @@ static void
 close_extractors() {
   size_t i;
 
+  finish_workers();
+
   for (i = 0; i < extractors.size(); i++)
     extractors[i]->finish_track();
 
@@ -239,8 +569,10 @@ close_extractors() {
       extractors[i]->finish_file();
 
   for (i = 0; i < extractors.size(); i++) {
-    if (!extractors[i]->m_master)
+    if (!extractors[i]->m_master) {
       extractors[i]->finish_file();
+      extractors[i]->close_file();
+    }
     delete extractors[i];
   }
 
@@ -312,12 +644,95 @@ find_and_verify_track_uids(KaxTracks &tracks,
       mxerror(boost::format(Y("No track with the ID %1% was found in the source file.\n")) % tspec.tid);
 }
 
+static void
+handle_chapters_and_tags(EbmlElement *l1,
+                         KaxChapters &all_chapters,
+                         KaxTags &all_tags) {
+  if (EbmlId(*l1) == EBML_ID(KaxChapters)) {
+    KaxChapters &chapters = *static_cast<KaxChapters *>(l1);
+
+    while (chapters.ListSize() > 0) {
+      if (EbmlId(*chapters[0]) == EBML_ID(KaxEditionEntry)) {
+        KaxEditionEntry &entry = *static_cast<KaxEditionEntry *>(chapters[0]);
+        while (entry.ListSize() > 0) {
+          if (EbmlId(*entry[0]) == EBML_ID(KaxChapterAtom))
+            all_chapters.PushElement(*entry[0]);
+          entry.Remove(0);
+        }
+      }
+      chapters.Remove(0);
+    }
+
+  } else if (EbmlId(*l1) == EBML_ID(KaxTags)) {
+    KaxTags &tags = *static_cast<KaxTags *>(l1);
+
+    while (tags.ListSize() > 0) {
+      all_tags.PushElement(*tags[0]);
+      tags.Remove(0);
+    }
+  }
+}
+
+/** \brief Remembers the positions of the cues, chapters and tags listed in a seek head
+
+   The positions are needed when clusters are skipped for extracting
+   a time range only.
+*/
+static void
+handle_seek_head(KaxSeekHead &seek_head,
+                 KaxSegment &segment,
+                 std::vector<int64_t> &cues_positions,
+                 std::vector<int64_t> &metadata_positions) {
+  for (auto &entry : read_seek_entries(seek_head, segment)) {
+    if (EBML_ID_VALUE(EBML_ID(KaxCues)) == entry.id)
+      cues_positions.push_back(entry.position);
+
+    else if ((EBML_ID_VALUE(EBML_ID(KaxChapters)) == entry.id) || (EBML_ID_VALUE(EBML_ID(KaxTags)) == entry.id))
+      metadata_positions.push_back(entry.position);
+  }
+}
+
+/** \brief Reads the chapters and tags at the given positions
+
+   Only elements in the range <tt>[from, to)</tt> that haven't been
+   handled yet are read. The file position is restored afterwards.
+*/
+static void
+read_skipped_chapters_and_tags(mm_io_c &in,
+                               kax_file_c &file,
+                               std::vector<int64_t> const &metadata_positions,
+                               std::set<int64_t> &handled_positions,
+                               int64_t from,
+                               int64_t to,
+                               KaxChapters &all_chapters,
+                               KaxTags &all_tags) {
+  for (auto position : metadata_positions) {
+    if ((position < from) || (position >= to) || map_has_key(handled_positions, position))
+      continue;
+
+    handled_positions.insert(position);
+
+    in.save_pos(position);
+    std::unique_ptr<EbmlElement> l1(file.read_next_level1_element());
+    in.restore_pos();
+
+    if (l1)
+      handle_chapters_and_tags(l1.get(), all_chapters, all_tags);
+  }
+}
+
 bool
 extract_tracks(const std::string &file_name,
-               std::vector<track_spec_t> &tspecs) {
+               std::vector<track_spec_t> &tspecs,
+               int64_t range_start,
+               int64_t range_stop) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
+  extraction_range_t range(range_start, range_stop);
+
+  bool needs_chapters_and_tags = tspecs.end() != brng::find_if(tspecs, [](track_spec_t const &tspec) { return tspec.extract_cuesheet; });
+
   // open input file
   mm_io_cptr in;
   kax_file_cptr file;
@@ -372,6 +787,12 @@ extract_tracks(const std::string &file_name,
     KaxChapters all_chapters;
     KaxTags all_tags;
 
+    KaxSegment &segment = *static_cast<KaxSegment *>(l0);
+    std::shared_ptr<EbmlElement> cues;
+    std::vector<int64_t> cues_positions, metadata_positions;
+    std::set<int64_t> handled_positions;
+    bool range_start_handled = -1 == range.m_start;
+
     while ((l1 = file->read_next_level1_element())) {
       if (EbmlId(*l1) == EBML_ID(KaxInfo)) {
         // General info about this Matroska file
@@ -397,10 +818,46 @@ extract_tracks(const std::string &file_name,
         show_element(l1, 1, Y("Cluster"));
         KaxCluster *cluster = static_cast<KaxCluster *>(l1);
 
+        // The extractors' workers free the cluster once they're done
+        // with its frames.
+        std::shared_ptr<EbmlElement> cluster_ref(l1);
+        l1 = nullptr;
+
+        if (!range_start_handled) {
+          // Jump to the cluster of the cue point before the start of
+          // the range. Chapters and tags located between here and there
+          // are read first.
+          range_start_handled = true;
+
+          std::vector<kax_cue_point_t> cue_points;
+          if (cues)
+            cue_points = read_cue_points(*static_cast<KaxCues *>(cues.get()), segment, tc_scale);
+          else if (!cues_positions.empty())
+            cue_points = read_cue_points(*in, *file, cues_positions.front(), segment, tc_scale);
+          cues.reset();
+
+          // All extracted tracks with cue points must start with a key
+          // frame.
+          auto start = find_range_start_cue_point(cue_points, range.m_start, [](uint64_t track_number) {
+            return extractors.end() != brng::find_if(extractors, [track_number](xtr_base_c *extractor) { return extractor->m_track_num == static_cast<int64_t>(track_number); });
+          });
+
+          if (start)
+            range.m_offset = start->timecode;
+
+          if (start && (start->position > cluster->GetElementPosition())) {
+            if (needs_chapters_and_tags)
+              read_skipped_chapters_and_tags(*in, *file, metadata_positions, handled_positions, cluster->GetElementPosition(), start->position, all_chapters, all_tags);
+
+            in->setFilePointer(start->position, seek_beginning);
+            continue;
+          }
+        }
+
         if (0 == verbose)
           mxinfo(boost::format(Y("Progress: %1%%%%2%")) % (int)(in->getFilePointer() * 100 / file_size) % "\r");
 
-        KaxClusterTimecode *ctc = FindChild<KaxClusterTimecode>(l1);
+        KaxClusterTimecode *ctc = FindChild<KaxClusterTimecode>(cluster);
         if (ctc) {
           uint64_t cluster_tc = uint64(*ctc);
           show_element(ctc, 2, boost::format(Y("Cluster timecode: %|1$.3f|s")) % ((float)cluster_tc * (float)tc_scale / 1000000000.0));
@@ -408,42 +865,39 @@ extract_tracks(const std::string &file_name,
         } else
           cluster->InitTimecode(0, tc_scale);
 
+        if ((-1 != range.m_stop) && (static_cast<int64_t>(cluster->GlobalTimecode()) >= range.m_stop)) {
+          if (needs_chapters_and_tags)
+            read_skipped_chapters_and_tags(*in, *file, metadata_positions, handled_positions, cluster->GetElementPosition(), std::numeric_limits<int64_t>::max(), all_chapters, all_tags);
+          break;
+        }
+
         size_t i;
         for (i = 0; cluster->ListSize() > i; ++i) {
           EbmlElement *el = (*cluster)[i];
           if (EbmlId(*el) == EBML_ID(KaxBlockGroup)) {
             show_element(el, 2, Y("Block group"));
-            handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, tc_scale);
+            handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, cluster_ref, range, tc_scale);
 
           } else if (EbmlId(*el) == EBML_ID(KaxSimpleBlock)) {
             show_element(el, 2, Y("SimpleBlock"));
-            handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster);
+            handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster, cluster_ref, range);
           }
         }
 
-      } else if (EbmlId(*l1) == EBML_ID(KaxChapters)) {
-        KaxChapters &chapters = *static_cast<KaxChapters *>(l1);
-
-        while (chapters.ListSize() > 0) {
-          if (EbmlId(*chapters[0]) == EBML_ID(KaxEditionEntry)) {
-            KaxEditionEntry &entry = *static_cast<KaxEditionEntry *>(chapters[0]);
-            while (entry.ListSize() > 0) {
-              if (EbmlId(*entry[0]) == EBML_ID(KaxChapterAtom))
-                all_chapters.PushElement(*entry[0]);
-              entry.Remove(0);
-            }
-          }
-          chapters.Remove(0);
-        }
+        queue_cluster_jobs();
 
-      } else if (EbmlId(*l1) == EBML_ID(KaxTags)) {
-        KaxTags &tags = *static_cast<KaxTags *>(l1);
-
-        while (tags.ListSize() > 0) {
-          all_tags.PushElement(*tags[0]);
-          tags.Remove(0);
+      } else if ((EbmlId(*l1) == EBML_ID(KaxChapters)) || (EbmlId(*l1) == EBML_ID(KaxTags))) {
+        if (!map_has_key(handled_positions, l1->GetElementPosition())) {
+          handled_positions.insert(l1->GetElementPosition());
+          handle_chapters_and_tags(l1, all_chapters, all_tags);
         }
 
+      } else if (EbmlId(*l1) == EBML_ID(KaxSeekHead))
+        handle_seek_head(*static_cast<KaxSeekHead *>(l1), segment, cues_positions, metadata_positions);
+
+      else if ((EbmlId(*l1) == EBML_ID(KaxCues)) && !range_start_handled) {
+        cues = std::shared_ptr<EbmlElement>(l1);
+        l1   = nullptr;
       }
 
       delete l1;
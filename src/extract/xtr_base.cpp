@@ -66,7 +66,7 @@ xtr_base_c::create_file(xtr_base_c *master,
 
   try {
     init_content_decoder(track);
-    m_out = mm_write_buffer_io_c::open(m_file_name, 5 * 1024 * 1024);
+    m_out = mm_write_buffer_io_c::open(m_file_name, 5 * 1024 * 1024, 2);
   } catch(...) {
     mxerror(boost::format(Y("Failed to create the file '%1%': %2% (%3%)\n")) % m_file_name % errno % strerror(errno));
   }
@@ -97,6 +97,18 @@ void
 xtr_base_c::finish_file() {
 }
 
+void
+xtr_base_c::close_file() {
+  if (!m_out)
+    return;
+
+  try {
+    m_out->close();
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("Writing to the file '%1%' failed: %2%\n")) % m_file_name % ex.error());
+  }
+}
+
 void
 xtr_base_c::headers_done() {
 }
@@ -47,6 +47,7 @@ public:
   };
   virtual void finish_track();
   virtual void finish_file();
+  virtual void close_file();
 
   virtual void headers_done();
 
@@ -35,15 +35,16 @@ info_cli_parser_c::init_parser() {
   add_section_header(YT("Options"));
 
 #if defined(HAVE_QT) || defined(HAVE_WXWIDGETS)
-  OPT("g|gui",          set_gui,          YT("Start the GUI (and open inname if it was given)."));
+  OPT("g|gui",           set_gui,           YT("Start the GUI (and open inname if it was given)."));
 #endif
-  OPT("c|checksum",     set_checksum,     YT("Calculate and display checksums of frame contents."));
-  OPT("C|check-mode",   set_check_mode,   YT("Calculate and display checksums and use verbosity level 4."));
-  OPT("s|summary",      set_summary,      YT("Only show summaries of the contents, not each element."));
-  OPT("t|track-info",   set_track_info,   YT("Show statistics for each track in verbose mode."));
-  OPT("x|hexdump",      set_hexdump,      YT("Show the first 16 bytes of each frame as a hex dump."));
-  OPT("X|full-hexdump", set_full_hexdump, YT("Show all bytes of each frame as a hex dump."));
-  OPT("z|size",         set_size,         YT("Show the size of each element including its header."));
+  OPT("c|checksum",      set_checksum,      YT("Calculate and display checksums of frame contents."));
+  OPT("C|check-mode",    set_check_mode,    YT("Calculate and display checksums and use verbosity level 4."));
+  OPT("s|summary",       set_summary,       YT("Only show summaries of the contents, not each element."));
+  OPT("t|track-info",    set_track_info,    YT("Show statistics for each track in verbose mode."));
+  OPT("i|index-summary", set_index_summary, YT("Only show the tracks, the duration and estimated statistics based on the index and a few sampled clusters."));
+  OPT("x|hexdump",       set_hexdump,       YT("Show the first 16 bytes of each frame as a hex dump."));
+  OPT("X|full-hexdump",  set_full_hexdump,  YT("Show all bytes of each frame as a hex dump."));
+  OPT("z|size",          set_size,          YT("Show the size of each element including its header."));
 
   add_common_options();
 
@@ -101,6 +102,11 @@ info_cli_parser_c::set_track_info() {
     verbose = 1;
 }
 
+void
+info_cli_parser_c::set_index_summary() {
+  m_options.m_index_summary = true;
+}
+
 void
 info_cli_parser_c::set_file_name() {
   if (!m_options.m_file_name.empty())
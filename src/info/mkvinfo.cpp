@@ -28,7 +28,11 @@
 #endif
 
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <typeinfo>
 
 #include <avilib.h>
@@ -71,7 +75,10 @@
 #include "common/command_line.h"
 #include "common/ebml.h"
 #include "common/endian.h"
+#include "common/kax_cluster_scanner.h"
+#include "common/kax_cues.h"
 #include "common/kax_file.h"
+#include "common/math.h"
 #include "common/matroska.h"
 #include "common/mm_io.h"
 #include "common/stereo_mode.h"
@@ -79,6 +86,7 @@
 #include "common/strings/formatting.h"
 #include "common/translation.h"
 #include "common/version.h"
+#include "common/vint.h"
 #include "common/xml/ebml_chapters_converter.h"
 #include "common/xml/ebml_tags_converter.h"
 #include "info/mkvinfo.h"
@@ -112,6 +120,7 @@ kax_track_t::kax_track_t()
 {
 }
 typedef std::shared_ptr<kax_track_t> kax_track_cptr;
+typedef std::map<unsigned int, track_info_t> track_info_map_t;
 
 track_info_t::track_info_t()
   : m_size(0)
@@ -135,13 +144,15 @@ track_info_t::max_timecode_unset() {
 
 std::vector<kax_track_cptr> s_tracks;
 std::map<unsigned int, kax_track_cptr> s_tracks_by_number;
-std::map<unsigned int, track_info_t> s_track_info;
+track_info_map_t s_track_info;
 options_c g_options;
 static uint64_t s_tc_scale = TIMECODE_SCALE;
 std::vector<boost::format> g_common_boost_formats;
 size_t s_mkvmerge_track_id = 0;
 
-#define BF_DO(n)                             g_common_boost_formats[n]
+static boost::format &common_boost_format(size_t n);
+
+#define BF_DO(n)                             common_boost_format(n)
 #define BF_ADD(s)                            g_common_boost_formats.push_back(boost::format(s))
 #define BF_SHOW_UNKNOWN_ELEMENT              BF_DO( 0)
 #define BF_EBMLVOID                          BF_DO( 1)
@@ -260,12 +271,13 @@ static void
 _show_unknown_element(EbmlStream *es,
                       EbmlElement *e,
                       int level) {
-  static boost::format s_bf_show_unknown_element("%|1$02x|");
+  static boost::format const s_bf_show_unknown_element("%|1$02x|");
 
+  boost::format bf_element_id(s_bf_show_unknown_element);
   int i;
   std::string element_id;
   for (i = EBML_ID_LENGTH(static_cast<const EbmlId &>(*e)) - 1; 0 <= i; --i)
-    element_id += (s_bf_show_unknown_element % ((EBML_ID_VALUE(static_cast<const EbmlId &>(*e)) >> (i * 8)) & 0xff)).str();
+    element_id += (bf_element_id % ((EBML_ID_VALUE(static_cast<const EbmlId &>(*e)) >> (i * 8)) & 0xff)).str();
 
   std::string s = (BF_SHOW_UNKNOWN_ELEMENT % EBML_NAME(e) % element_id % (e->GetSize() + e->HeadSize())).str();
   _show_element(e, es, true, level, s);
@@ -313,14 +325,15 @@ _show_element(EbmlElement *l,
 static std::string
 create_hexdump(const unsigned char *buf,
                int size) {
-  static boost::format s_bf_create_hexdump(" %|1$02x|");
+  static boost::format const s_bf_create_hexdump(" %|1$02x|");
 
+  boost::format bf_byte(s_bf_create_hexdump);
   std::string hex(" hexdump");
   int bmax = std::min(size, g_options.m_hexdump_max_size);
   int b;
 
   for (b = 0; b < bmax; ++b)
-    hex += (s_bf_create_hexdump % static_cast<int>(buf[b])).str();
+    hex += (bf_byte % static_cast<int>(buf[b])).str();
 
   return hex;
 }
@@ -1361,7 +1374,8 @@ handle_block_group(EbmlStream *&es,
                    EbmlElement *&l3,
                    EbmlElement *&l4,
                    EbmlElement *&l5,
-                   KaxCluster *&cluster) {
+                   KaxCluster *&cluster,
+                   track_info_map_t &track_info) {
   show_element(l2, 2, Y("Block group"));
 
   std::vector<int> frame_sizes;
@@ -1580,7 +1594,7 @@ handle_block_group(EbmlStream *&es,
                  % lf_tnum
                  % (lf_timecode / 1000000));
 
-  track_info_t &tinfo = s_track_info[lf_tnum];
+  track_info_t &tinfo = track_info[lf_tnum];
 
   tinfo.m_blocks                                                                                 += frame_sizes.size();
   tinfo.m_blocks_by_ref_num[bref_found && fref_found ? 2 : bref_found ? 1 : !fref_found ? 0 : 1] += frame_sizes.size();
@@ -1605,7 +1619,8 @@ handle_block_group(EbmlStream *&es,
 void
 handle_simple_block(EbmlStream *&es,
                     EbmlElement *&l2,
-                    KaxCluster *&cluster) {
+                    KaxCluster *&cluster,
+                    track_info_map_t &track_info) {
   std::vector<int> frame_sizes;
   std::vector<uint32_t> frame_adlers;
 
@@ -1614,7 +1629,7 @@ handle_simple_block(EbmlStream *&es,
 
   int64_t frame_pos   = block.GetElementPosition() + block.ElementSize();
   uint64_t timecode   = block.GlobalTimecode() / 1000000;
-  track_info_t &tinfo = s_track_info[block.TrackNum()];
+  track_info_t &tinfo = track_info[block.TrackNum()];
 
   std::string info;
   if (block.IsKeyframe())
@@ -1682,8 +1697,11 @@ handle_simple_block(EbmlStream *&es,
   tinfo.m_blocks                                                                    += block.NumberFrames();
   tinfo.m_blocks_by_ref_num[block.IsKeyframe() ? 0 : block.IsDiscardable() ? 2 : 1] += block.NumberFrames();
   tinfo.m_min_timecode                                                                = std::min(tinfo.m_min_timecode, static_cast<int64_t>(block.GlobalTimecode()));
-  tinfo.m_max_timecode                                                                = std::max(tinfo.m_min_timecode, static_cast<int64_t>(block.GlobalTimecode()));
-  tinfo.m_add_duration_for_n_packets                                                  = block.NumberFrames();
+
+  if (tinfo.max_timecode_unset() || (tinfo.m_max_timecode < static_cast<int64_t>(block.GlobalTimecode()))) {
+    tinfo.m_max_timecode               = block.GlobalTimecode();
+    tinfo.m_add_duration_for_n_packets = block.NumberFrames();
+  }
 
   size_t fidx;
   for (fidx = 0; fidx < frame_sizes.size(); fidx++)
@@ -1699,7 +1717,8 @@ handle_cluster(EbmlStream *&es,
                EbmlElement *&l4,
                EbmlElement *&l5,
                KaxCluster *&cluster,
-               int64_t file_size) {
+               int64_t file_size,
+               track_info_map_t &track_info) {
   cluster = (KaxCluster *)l1;
 
   if (g_options.m_use_gui)
@@ -1733,10 +1752,10 @@ handle_cluster(EbmlStream *&es,
       handle_silent_track(es, l2, l3);
 
     else if (is_id(l2, KaxBlockGroup))
-      handle_block_group(es, l2, l3, l4, l5, cluster);
+      handle_block_group(es, l2, l3, l4, l5, cluster, track_info);
 
     else if (is_id(l2, KaxSimpleBlock))
-      handle_simple_block(es, l2, cluster);
+      handle_simple_block(es, l2, cluster, track_info);
 
     else if (!is_global(es, l2, 2))
       show_unknown_element(l2, 2);
@@ -1895,6 +1914,343 @@ display_track_info() {
   }
 }
 
+typedef std::vector<std::pair<unsigned int, std::string> > buffered_messages_t;
+
+struct cluster_batch_t {
+  int64_t m_start, m_end;
+  buffered_messages_t m_messages;
+  track_info_map_t m_track_info;
+  std::exception_ptr m_error;
+  bool m_done;
+
+  cluster_batch_t(int64_t start, int64_t end)
+    : m_start(start)
+    , m_end(end)
+    , m_done(false)
+  {
+  }
+};
+
+struct cluster_batches_t {
+  std::string m_file_name;
+  int64_t m_file_size;
+  std::vector<cluster_batch_t> m_batches;
+  size_t m_next_batch, m_num_output, m_max_in_flight;
+  bool m_abort;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+
+  cluster_batches_t(std::string const &file_name, int64_t file_size)
+    : m_file_name(file_name)
+    , m_file_size(file_size)
+    , m_next_batch(0)
+    , m_num_output(0)
+    , m_max_in_flight(0)
+    , m_abort(false)
+  {
+  }
+};
+
+// State of the threads parsing clusters. The map is filled before the
+// threads start working and left alone until all of them have
+// finished. Each entry is only used by its own thread.
+struct cluster_thread_state_t {
+  buffered_messages_t *m_messages;
+  std::vector<boost::format> m_formats;
+
+  cluster_thread_state_t()
+    : m_messages(nullptr)
+    , m_formats(g_common_boost_formats)
+  {
+  }
+};
+
+static std::map<std::thread::id, cluster_thread_state_t> s_cluster_thread_states;
+
+static cluster_thread_state_t *
+find_cluster_thread_state() {
+  if (s_cluster_thread_states.empty())
+    return nullptr;
+
+  auto state = s_cluster_thread_states.find(std::this_thread::get_id());
+  return s_cluster_thread_states.end() == state ? nullptr : &state->second;
+}
+
+// Threads parsing clusters use their own copies of the formats.
+static boost::format &
+common_boost_format(size_t n) {
+  auto state = find_cluster_thread_state();
+  return state ? state->m_formats[n] : g_common_boost_formats[n];
+}
+
+// Collects the info messages and warnings of the threads parsing
+// clusters per batch so that the main thread can output them in file
+// order. Messages from other threads are passed on to the previous
+// handlers which are restored on destruction.
+class cluster_message_buffer_c {
+protected:
+  mxmsg_handler_t m_previous_info_handler, m_previous_warning_handler;
+
+public:
+  cluster_message_buffer_c()
+    : m_previous_info_handler(get_mxmsg_handler(MXMSG_INFO))
+    , m_previous_warning_handler(get_mxmsg_handler(MXMSG_WARNING))
+  {
+    set_mxmsg_handler(MXMSG_INFO,    [this](unsigned int level, std::string const &message) { handle(level, message, m_previous_info_handler);    });
+    set_mxmsg_handler(MXMSG_WARNING, [this](unsigned int level, std::string const &message) { handle(level, message, m_previous_warning_handler); });
+  }
+
+  ~cluster_message_buffer_c() {
+    set_mxmsg_handler(MXMSG_INFO,    m_previous_info_handler);
+    set_mxmsg_handler(MXMSG_WARNING, m_previous_warning_handler);
+  }
+
+protected:
+  void
+  handle(unsigned int level,
+         std::string const &message,
+         mxmsg_handler_t const &previous_handler) {
+    auto state = find_cluster_thread_state();
+    if (state && state->m_messages)
+      state->m_messages->push_back(std::make_pair(level, message));
+    else
+      previous_handler(level, message);
+  }
+};
+
+static void
+merge_track_info(track_info_map_t &dst,
+                 track_info_map_t const &src) {
+  for (auto &src_tinfo : src) {
+    track_info_t &tinfo        = dst[src_tinfo.first];
+    track_info_t const &other  = src_tinfo.second;
+
+    tinfo.m_size              += other.m_size;
+    tinfo.m_blocks            += other.m_blocks;
+    tinfo.m_min_timecode       = std::min(tinfo.m_min_timecode, other.m_min_timecode);
+
+    size_t idx;
+    for (idx = 0; 3 > idx; ++idx)
+      tinfo.m_blocks_by_ref_num[idx] += other.m_blocks_by_ref_num[idx];
+
+    if (tinfo.m_max_timecode < other.m_max_timecode) {
+      tinfo.m_max_timecode               = other.m_max_timecode;
+      tinfo.m_add_duration_for_n_packets = other.m_add_duration_for_n_packets;
+    }
+  }
+}
+
+// Returns the positions of the clusters following each other directly
+// starting at 'start' plus the end position of the last one. Clusters
+// with an unknown size cannot be split and result in an empty list.
+static std::vector<int64_t>
+find_cluster_positions(mm_io_cptr &in,
+                       int64_t start,
+                       int64_t end) {
+  std::vector<int64_t> positions;
+  int64_t position = start;
+
+  try {
+    while (position < end) {
+      in->setFilePointer(position);
+      vint_c id   = vint_c::read_ebml_id(in);
+      vint_c size = vint_c::read(in);
+
+      if (!id.is_valid() || (EBML_ID_VALUE(EBML_ID(KaxCluster)) != id.m_value) || !size.is_valid())
+        break;
+
+      if (size.is_unknown()) {
+        positions.clear();
+        break;
+      }
+
+      int64_t next_position = in->getFilePointer() + size.m_value;
+      if (next_position > end)
+        break;
+
+      positions.push_back(position);
+      position = next_position;
+    }
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  if (!positions.empty())
+    positions.push_back(position);
+
+  in->setFilePointer(start);
+
+  return positions;
+}
+
+static void
+parse_cluster_batch(mm_io_cptr &in,
+                    EbmlStream *es,
+                    kax_file_c &kax_file,
+                    cluster_batch_t &batch,
+                    int64_t file_size) {
+  int upper_lvl_el    = 0;
+  EbmlElement *l1     = nullptr, *l2 = nullptr, *l3 = nullptr, *l4 = nullptr, *l5 = nullptr;
+  KaxCluster *cluster = nullptr;
+
+  in->setFilePointer(batch.m_start);
+
+  while ((in->getFilePointer() < batch.m_end) && (l1 = kax_file.read_next_level1_element())) {
+    std::shared_ptr<EbmlElement> af_l1(l1);
+
+    show_element(l1, 1, Y("Cluster"));
+    handle_cluster(es, upper_lvl_el, l1, l2, l3, l4, l5, cluster, file_size, batch.m_track_info);
+
+    if (!in->setFilePointer2(l1->GetElementPosition() + kax_file.get_element_size(l1)))
+      break;
+  }
+}
+
+static void
+parse_cluster_batches(cluster_batches_t &batches) {
+  mm_io_cptr in;
+  std::shared_ptr<EbmlStream> es;
+  kax_file_cptr kax_file;
+  std::exception_ptr open_error;
+  cluster_thread_state_t *state;
+
+  {
+    // Wait until the main thread has set up the thread states.
+    std::lock_guard<std::mutex> lock(batches.m_mutex);
+    state = find_cluster_thread_state();
+    assert(state);
+  }
+
+  try {
+    in       = mm_file_io_c::open(batches.m_file_name);
+    es       = std::shared_ptr<EbmlStream>(new EbmlStream(*in));
+    kax_file = kax_file_cptr(new kax_file_c(in));
+  } catch (...) {
+    open_error = std::current_exception();
+  }
+
+  while (true) {
+    cluster_batch_t *batch;
+
+    {
+      std::unique_lock<std::mutex> lock(batches.m_mutex);
+      while (   !batches.m_abort
+             && (batches.m_next_batch <  batches.m_batches.size())
+             && (batches.m_next_batch >= (batches.m_num_output + batches.m_max_in_flight)))
+        batches.m_cond.wait(lock);
+
+      if (batches.m_abort || (batches.m_next_batch >= batches.m_batches.size()))
+        return;
+
+      batch = &batches.m_batches[batches.m_next_batch++];
+    }
+
+    state->m_messages = &batch->m_messages;
+
+    if (open_error)
+      batch->m_error = open_error;
+
+    else {
+      try {
+        EbmlStream *batch_es = es.get();
+        parse_cluster_batch(in, batch_es, *kax_file, *batch, batches.m_file_size);
+      } catch (...) {
+        batch->m_error = std::current_exception();
+      }
+    }
+
+    state->m_messages = nullptr;
+
+    std::lock_guard<std::mutex> lock(batches.m_mutex);
+    batch->m_done = true;
+    batches.m_cond.notify_all();
+  }
+}
+
+static bool
+use_concurrent_cluster_parsing() {
+  return !g_options.m_use_gui
+    && (g_options.m_show_summary || g_options.m_show_track_info)
+    && (1 < std::thread::hardware_concurrency())
+    && !debugging_requested("no_threaded_clusters");
+}
+
+// Parses the clusters following each other directly from 'start' on
+// in batches on several threads. The output and the track statistics
+// are merged in file order. Returns the position after the last
+// cluster handled, or 'start' if there weren't enough clusters to make
+// it worthwhile.
+static int64_t
+handle_clusters_concurrently(const std::string &file_name,
+                             mm_io_cptr &in,
+                             int64_t start,
+                             int64_t end,
+                             int64_t file_size) {
+  size_t const clusters_per_batch = 32;
+
+  std::vector<int64_t> positions = find_cluster_positions(in, start, end);
+  if (positions.size() <= (2 * clusters_per_batch))
+    return start;
+
+  cluster_batches_t batches(file_name, file_size);
+  size_t idx;
+  for (idx = 0; (idx + 1) < positions.size(); idx += clusters_per_batch)
+    batches.m_batches.push_back(cluster_batch_t(positions[idx], positions[std::min(idx + clusters_per_batch, positions.size() - 1)]));
+
+  size_t num_threads      = std::min<size_t>(std::thread::hardware_concurrency(), batches.m_batches.size());
+  batches.m_max_in_flight = 4 * num_threads;
+
+  cluster_message_buffer_c message_buffer;
+  std::vector<std::thread> threads;
+
+  {
+    std::lock_guard<std::mutex> lock(batches.m_mutex);
+    for (idx = 0; num_threads > idx; ++idx) {
+      threads.push_back(std::thread(parse_cluster_batches, std::ref(batches)));
+      s_cluster_thread_states[threads.back().get_id()];
+    }
+  }
+
+  std::exception_ptr error;
+  for (auto &batch : batches.m_batches) {
+    {
+      std::unique_lock<std::mutex> lock(batches.m_mutex);
+      while (!batch.m_done)
+        batches.m_cond.wait(lock);
+    }
+
+    for (auto &message : batch.m_messages)
+      if (MXMSG_WARNING == message.first)
+        mxwarn(message.second);
+      else
+        mxinfo(message.second);
+    buffered_messages_t().swap(batch.m_messages);
+
+    merge_track_info(s_track_info, batch.m_track_info);
+    batch.m_track_info.clear();
+
+    std::lock_guard<std::mutex> lock(batches.m_mutex);
+    if (batch.m_error) {
+      error           = batch.m_error;
+      batches.m_abort = true;
+      batches.m_cond.notify_all();
+      break;
+    }
+
+    ++batches.m_num_output;
+    batches.m_cond.notify_all();
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  s_cluster_thread_states.clear();
+
+  if (error)
+    rethrow_worker_exception(error);
+
+  return positions.back();
+}
+
 bool
 process_file(const std::string &file_name) {
   int upper_lvl_el;
@@ -1958,10 +2314,12 @@ process_file(const std::string &file_name) {
       delete l0;
     }
 
+    int64_t segment_end    = !l0->IsFiniteSize() ? file_size : std::min<int64_t>(l0->GetElementPosition() + l0->HeadSize() + l0->GetSize(), file_size);
     kax_file_cptr kax_file = kax_file_cptr(new kax_file_c(in));
 
     while ((l1 = kax_file->read_next_level1_element())) {
       std::shared_ptr<EbmlElement> af_l1(l1);
+      int64_t next_position = -1;
 
       if (is_id(l1, KaxInfo))
         handle_info(es, upper_lvl_el, l1, l2, l3);
@@ -1980,7 +2338,10 @@ process_file(const std::string &file_name) {
 
           return true;
         }
-        handle_cluster(es, upper_lvl_el, l1, l2, l3, l4, l5, cluster, file_size);
+        handle_cluster(es, upper_lvl_el, l1, l2, l3, l4, l5, cluster, file_size, s_track_info);
+
+        if (use_concurrent_cluster_parsing())
+          next_position = handle_clusters_concurrently(file_name, in, l1->GetElementPosition() + kax_file->get_element_size(l1), segment_end, file_size);
 
       } else if (is_id(l1, KaxCues))
         handle_cues(es, upper_lvl_el, l1, l2, l3, l4, l5);
@@ -1999,7 +2360,10 @@ process_file(const std::string &file_name) {
       else if (!is_global(es, l1, 1))
         show_unknown_element(l1, 1);
 
-      if (!in->setFilePointer2(l1->GetElementPosition() + kax_file->get_element_size(l1)))
+      if (-1 == next_position)
+        next_position = l1->GetElementPosition() + kax_file->get_element_size(l1);
+
+      if (!in->setFilePointer2(next_position))
         break;
       if (!in_parent(l0))
         break;
@@ -2018,6 +2382,260 @@ process_file(const std::string &file_name) {
   }
 }
 
+struct index_track_t {
+  kax_track_cptr m_track;
+  std::string m_codec_id;
+  int64_t m_cue_points, m_sampled_bytes, m_sampled_frames, m_sampled_key_frames;
+
+  index_track_t(kax_track_cptr const &track = kax_track_cptr{}, std::string const &codec_id = "")
+    : m_track(track)
+    , m_codec_id(codec_id)
+    , m_cue_points(0)
+    , m_sampled_bytes(0)
+    , m_sampled_frames(0)
+    , m_sampled_key_frames(0)
+  {
+  }
+};
+
+static void
+read_index_summary_tracks(KaxTracks &tracks,
+                          std::map<uint64_t, index_track_t> &index_tracks) {
+  for (auto tracks_child : tracks) {
+    KaxTrackEntry *entry = dynamic_cast<KaxTrackEntry *>(tracks_child);
+    if (!entry)
+      continue;
+
+    kax_track_cptr track(new kax_track_t);
+    track->tnum             = kt_get_number(*entry);
+    track->default_duration = kt_get_default_duration(*entry);
+
+    KaxTrackType *ttype = FindChild<KaxTrackType>(entry);
+    uint8 type          = ttype ? uint8(*ttype) : 0;
+    track->type         = track_audio    == type ? 'a'
+                        : track_video    == type ? 'v'
+                        : track_subtitle == type ? 's'
+                        : track_buttons  == type ? 'b'
+                        :                          '?';
+
+    add_track(track);
+    index_tracks[track->tnum] = index_track_t(track, kt_get_codec_id(*entry));
+  }
+}
+
+/** \brief Shows a summary based on the index instead of all clusters
+
+   The track list and duration are taken from the headers. The number
+   of cue points is shown for each track; for tracks without any the
+   number of key frames is estimated from the sampled clusters. The
+   bitrates are estimated by sampling up to \c s_num_sampled_clusters
+   clusters spread evenly over the cue points' clusters and
+   distributing the size of all clusters according to each track's
+   share of the sampled data. Without cues the first clusters are
+   sampled.
+*/
+static bool
+process_file_from_index(const std::string &file_name) {
+  static size_t const s_num_sampled_clusters = 16;
+
+  s_tc_scale = TIMECODE_SCALE;
+  s_tracks.clear();
+  s_tracks_by_number.clear();
+
+  mm_io_cptr in;
+  try {
+    in = mm_file_io_c::open(file_name);
+  } catch (...) {
+    show_error((boost::format(Y("Error: Couldn't open input file %1% (%2%).\n")) % file_name % strerror(errno)).str());
+    return false;
+  }
+
+  int64_t file_size = in->get_size();
+
+  try {
+    EbmlStream es(*in);
+
+    std::unique_ptr<EbmlElement> head(es.FindNextID(EBML_INFO(EbmlHead), 0xFFFFFFFFL));
+    if (!head) {
+      show_error(Y("No EBML head found."));
+      return false;
+    }
+    head->SkipData(es, EBML_CONTEXT(head.get()));
+
+    std::unique_ptr<EbmlElement> l0(es.FindNextID(EBML_INFO(KaxSegment), 0xFFFFFFFFFFFFFFFFLL));
+    if (!l0 || !is_id(l0.get(), KaxSegment)) {
+      show_error(Y("No segment/level 0 element found."));
+      return false;
+    }
+
+    KaxSegment &segment   = *static_cast<KaxSegment *>(l0.get());
+    int64_t segment_end   = l0->IsFiniteSize() ? std::min<int64_t>(segment.GetGlobalPosition(l0->GetSize()), file_size) : file_size;
+    int64_t first_cluster = -1;
+    int64_t data_end      = segment_end;
+    int64_t cues_position = -1;
+    double duration       = 0;
+
+    kax_file_cptr kax_file(new kax_file_c(in));
+    std::shared_ptr<EbmlElement> cues;
+    std::vector<int64_t> level1_positions;
+    std::map<uint64_t, index_track_t> index_tracks;
+
+    // Read the headers up to the first cluster.
+    EbmlElement *l1;
+    while ((l1 = kax_file->read_next_level1_element())) {
+      std::shared_ptr<EbmlElement> af_l1(l1);
+
+      if (is_id(l1, KaxInfo)) {
+        KaxTimecodeScale *ktc_scale = FindChild<KaxTimecodeScale>(l1);
+        KaxDuration *kduration      = FindChild<KaxDuration>(l1);
+        if (ktc_scale)
+          s_tc_scale = uint64(*ktc_scale);
+        if (kduration)
+          duration = double(*kduration);
+
+      } else if (is_id(l1, KaxTracks))
+        read_index_summary_tracks(*static_cast<KaxTracks *>(l1), index_tracks);
+
+      else if (is_id(l1, KaxCues))
+        cues = af_l1;
+
+      else if (is_id(l1, KaxSeekHead)) {
+        for (auto &entry : read_seek_entries(*static_cast<KaxSeekHead *>(l1), segment)) {
+          level1_positions.push_back(entry.position);
+
+          if (EBML_ID_VALUE(EBML_ID(KaxCues)) == entry.id)
+            cues_position = entry.position;
+        }
+
+      } else if (is_id(l1, KaxCluster)) {
+        first_cluster = l1->GetElementPosition();
+        break;
+      }
+
+      if (!in->setFilePointer2(l1->GetElementPosition() + kax_file->get_element_size(l1)))
+        break;
+    }
+
+    if (-1 == first_cluster) {
+      show_error(Y("No cluster found."));
+      return false;
+    }
+
+    std::vector<kax_cue_point_t> cue_points;
+    if (cues)
+      cue_points = read_cue_points(*static_cast<KaxCues *>(cues.get()), segment, s_tc_scale);
+    else if (-1 != cues_position)
+      cue_points = read_cue_points(*in, *kax_file, cues_position, segment, s_tc_scale);
+
+    // Clusters normally end where the first of the elements following
+    // them begins.
+    for (auto position : level1_positions)
+      if ((position > first_cluster) && (position < data_end))
+        data_end = position;
+
+    // Count the cue points and collect the clusters to sample.
+    std::vector<int64_t> cluster_positions;
+    int64_t max_cue_time = 0;
+
+    for (auto &cue_point : cue_points) {
+      max_cue_time = std::max(max_cue_time, cue_point.timecode);
+
+      auto index_track = index_tracks.find(cue_point.track_number);
+      if (index_tracks.end() != index_track)
+        ++index_track->second.m_cue_points;
+
+      cluster_positions.push_back(cue_point.position);
+    }
+
+    brng::sort(cluster_positions);
+    cluster_positions.erase(std::unique(cluster_positions.begin(), cluster_positions.end()), cluster_positions.end());
+
+    // Sample the clusters.
+    kax_cluster_scanner_c scanner;
+    scanner.set_timecode_scale(s_tc_scale);
+
+    int64_t sampled_bytes = 0, max_timecode = 0;
+    size_t num_samples    = std::min(cluster_positions.size(), s_num_sampled_clusters);
+
+    in->setFilePointer(first_cluster);
+
+    for (size_t idx = 0; s_num_sampled_clusters > idx; ++idx) {
+      if (num_samples) {
+        if (num_samples <= idx)
+          break;
+        in->setFilePointer(cluster_positions[idx * cluster_positions.size() / num_samples]);
+      }
+
+      if (!kax_file->scan_next_cluster(scanner)) {
+        std::unique_ptr<KaxCluster> cluster(kax_file->read_next_cluster());
+        if (!cluster)
+          break;
+        scanner.import(*cluster);
+      }
+
+      for (auto &block : scanner.get_blocks()) {
+        if (!block.block_found)
+          continue;
+
+        auto index_track = index_tracks.find(block.track_number);
+        if (index_tracks.end() == index_track)
+          continue;
+
+        auto &info     = index_track->second;
+        bool key_frame = block.is_simple ? block.keyframe : !block.bref_found && !block.fref_found;
+
+        for (size_t frame_idx = 0; block.num_frames > frame_idx; ++frame_idx) {
+          auto size                  = scanner.get_frame(block, frame_idx)->get_size();
+          info.m_sampled_bytes      += size;
+          info.m_sampled_frames     += 1;
+          info.m_sampled_key_frames += key_frame ? 1 : 0;
+          sampled_bytes             += size;
+        }
+
+        max_timecode = std::max(max_timecode, block.timecode);
+      }
+    }
+
+    int64_t duration_ns = 0 != duration  ? irnd(duration * s_tc_scale)
+                        : max_cue_time   ? max_cue_time
+                        :                  max_timecode;
+
+    mxinfo(boost::format(Y("Duration: %1%%2%\n")) % format_timecode(duration_ns, 3) % (0 != duration ? "" : Y(" (estimated)")));
+
+    for (auto &track : s_tracks) {
+      auto &info = index_tracks[track->tnum];
+
+      int64_t bitrate = (0 == sampled_bytes) || (0 == duration_ns) ? 0
+                      : static_cast<int64_t>((data_end - first_cluster) * 8000000000.0 * info.m_sampled_bytes / sampled_bytes / duration_ns);
+
+      std::string cue_points_info;
+      if (info.m_cue_points)
+        cue_points_info = (boost::format(Y("cue points: %1%")) % info.m_cue_points).str();
+      else if (info.m_sampled_frames && (0 < track->default_duration))
+        cue_points_info = (boost::format(Y("no cue points, approximately %1% key frames")) % (duration_ns / track->default_duration * info.m_sampled_key_frames / info.m_sampled_frames)).str();
+      else
+        cue_points_info = Y("no cue points");
+
+      mxinfo(boost::format(Y("Track %1%: %2%, codec ID: %3%, %4%, estimated bitrate in bits/second: %5%\n"))
+             % track->tnum
+             % (  'a' == track->type ? Y("audio")
+                : 'v' == track->type ? Y("video")
+                : 's' == track->type ? Y("subtitles")
+                : 'b' == track->type ? Y("buttons")
+                :                      Y("unknown"))
+             % info.m_codec_id
+             % cue_points_info
+             % bitrate);
+    }
+
+    return true;
+
+  } catch (...) {
+    show_error(Y("Caught exception"));
+    return false;
+  }
+}
+
 void
 setup(const std::string &locale) {
   mtx_common_init("mkvinfo");
@@ -2036,6 +2654,9 @@ console_main() {
   if (g_options.m_file_name.empty())
     mxerror(Y("No file name given.\n"));
 
+  if (g_options.m_index_summary)
+    return process_file_from_index(g_options.m_file_name) ? 0 : 1;
+
   return process_file(g_options.m_file_name.c_str()) ? 0 : 1;
 }
 
@@ -21,27 +21,15 @@
 
 #if defined(HAVE_FLAC_FORMAT_H)
 
-#include <FLAC/export.h>
-#include <FLAC/stream_decoder.h>
-
+#include "common/flac.h"
 #include "output/p_flac.h"
 
-#define FLAC_BLOCK_TYPE_HEADERS 0
-#define FLAC_BLOCK_TYPE_DATA    1
-
-typedef struct {
-  int64_t filepos;
-  unsigned int type, len;
-} flac_block_t;
-
 class flac_reader_c: public generic_reader_c {
 private:
-  memory_cptr m_header;
+  memory_cptr m_header, m_read_buffer;
   int sample_rate;
-  bool metadata_parsed;
   uint64_t samples;
-  std::vector<flac_block_t> blocks;
-  std::vector<flac_block_t>::iterator current_block;
+  flac_frame_parser_c m_parser;
   FLAC__StreamMetadata_StreamInfo stream_info;
 
 public:
@@ -59,21 +47,8 @@ public:
 
   static bool probe_file(mm_io_c *in, uint64_t size);
 
-  virtual FLAC__StreamDecoderReadStatus
-  read_cb(FLAC__byte buffer[], size_t *bytes);
-
-  virtual FLAC__StreamDecoderWriteStatus
-  write_cb(const FLAC__Frame *frame, const FLAC__int32 * const data[]);
-
-  virtual void metadata_cb(const FLAC__StreamMetadata *metadata);
-  virtual void error_cb(FLAC__StreamDecoderErrorStatus status);
-  virtual FLAC__StreamDecoderSeekStatus seek_cb(uint64_t new_pos);
-  virtual FLAC__StreamDecoderTellStatus tell_cb(uint64_t &absolute_byte_offset);
-  virtual FLAC__StreamDecoderLengthStatus length_cb(uint64_t &stream_length);
-  virtual FLAC__bool eof_cb();
-
 protected:
-  virtual bool parse_file();
+  virtual bool parse_metadata();
 };
 
 #else  // HAVE_FLAC_FORMAT_H
@@ -31,6 +31,8 @@
 #include <matroska/KaxCluster.h>
 #include <matroska/KaxClusterData.h>
 #include <matroska/KaxContexts.h>
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
 #include <matroska/KaxInfo.h>
 #include <matroska/KaxInfoData.h>
 #include <matroska/KaxSeekHead.h>
@@ -204,6 +206,10 @@ kax_reader_c::kax_reader_c(const track_info_c &ti,
   , m_writing_app_ver(-1)
   , m_attachment_id(0)
   , m_file_status(FILE_STATUS_MOREDATA)
+  , m_range_start_position(-1)
+  , m_range_offset(0)
+  , m_range_started(-1 == ti.m_range_start)
+  , m_range_has_video(false)
 {
   init_l1_position_storage(m_deferred_l1_positions);
   init_l1_position_storage(m_handled_l1_positions);
@@ -216,6 +222,7 @@ void
 kax_reader_c::init_l1_position_storage(deferred_positions_t &storage) {
   storage[dl1t_attachments] = std::vector<int64_t>();
   storage[dl1t_chapters]    = std::vector<int64_t>();
+  storage[dl1t_cues]        = std::vector<int64_t>();
   storage[dl1t_tags]        = std::vector<int64_t>();
   storage[dl1t_tracks]      = std::vector<int64_t>();
 }
@@ -639,45 +646,74 @@ kax_reader_c::handle_attachments(mm_io_c *io,
   if (!atts)
     return;
 
-  EbmlElement *l2 = nullptr;
-  upper_lvl_el    = 0;
+  // The attachments are read element by element so that their content
+  // doesn't have to be held in memory. It is streamed from the source
+  // file whenever it is rendered into an output file.
+  io->setFilePointer(atts->GetElementPosition() + atts->HeadSize());
 
-  atts->Read(*m_es, EBML_CLASS_CONTEXT(KaxAttachments), upper_lvl_el, l2, true);
+  while (in_parent(atts)) {
+    upper_lvl_el = 0;
+    std::shared_ptr<EbmlElement> l2(m_es->FindNextElement(EBML_CONTEXT(atts), upper_lvl_el, 0xFFFFFFFFL, true));
+    if (!l2 || (0 != upper_lvl_el))
+      break;
 
-  size_t i;
-  for (i = 0; i < atts->ListSize(); i++) {
-    KaxAttached *att = dynamic_cast<KaxAttached *>((*atts)[i]);
-    if (!att)
+    KaxAttached *att = dynamic_cast<KaxAttached *>(l2.get());
+    if (!att) {
+      l2->SkipData(*m_es, EBML_CONTEXT(l2));
       continue;
+    }
 
     attachment_t matt;
-    size_t k;
+    bool damaged = false;
 
-    for (k = 0; k < att->ListSize(); k++) {
-      l2 = (*att)[k];
+    while (in_parent(att)) {
+      upper_lvl_el = 0;
+      std::shared_ptr<EbmlElement> l3(m_es->FindNextElement(EBML_CONTEXT(att), upper_lvl_el, 0xFFFFFFFFL, true));
+      if (!l3 || (0 != upper_lvl_el)) {
+        damaged = true;
+        break;
+      }
+
+      if (EbmlId(*l3) == EBML_ID(KaxFileData)) {
+        matt.source          = m_in;
+        matt.source_position = l3->GetElementPosition() + l3->HeadSize();
+        matt.size            = l3->GetSize();
+        l3->SkipData(*m_es, EBML_CONTEXT(l3));
+        continue;
+      }
 
-      if (EbmlId(*l2) == EBML_ID(KaxFileName))
-        matt.name = UTFstring_to_cstrutf8(UTFstring(static_cast<KaxFileName &>(*l2)));
+      EbmlElement *found = nullptr;
+      l3->Read(*m_es, EBML_CONTEXT(l3), upper_lvl_el, found, true);
+      l3->SkipData(*m_es, EBML_CONTEXT(l3));
 
-      else if (EbmlId(*l2) == EBML_ID(KaxFileDescription))
-        matt.description = UTFstring_to_cstrutf8(UTFstring(static_cast<KaxFileDescription &>(*l2)));
+      if (EbmlId(*l3) == EBML_ID(KaxFileName))
+        matt.name = UTFstring_to_cstrutf8(UTFstring(static_cast<KaxFileName &>(*l3)));
 
-      else if (EbmlId(*l2) == EBML_ID(KaxMimeType))
-        matt.mime_type = std::string(static_cast<KaxMimeType &>(*l2));
+      else if (EbmlId(*l3) == EBML_ID(KaxFileDescription))
+        matt.description = UTFstring_to_cstrutf8(UTFstring(static_cast<KaxFileDescription &>(*l3)));
 
-      else if (EbmlId(*l2) == EBML_ID(KaxFileUID))
-        matt.id = uint64(static_cast<KaxFileUID &>(*l2));
+      else if (EbmlId(*l3) == EBML_ID(KaxMimeType))
+        matt.mime_type = std::string(static_cast<KaxMimeType &>(*l3));
 
-      else if (EbmlId(*l2) == EBML_ID(KaxFileData)) {
-        KaxFileData &fdata = static_cast<KaxFileData &>(*l2);
-        matt.data          = memory_c::clone(static_cast<unsigned char *>(fdata.GetBuffer()), fdata.GetSize());
-      }
+      else if (EbmlId(*l3) == EBML_ID(KaxFileUID))
+        matt.id = uint64(static_cast<KaxFileUID &>(*l3));
     }
 
     ++m_attachment_id;
+
+    // Only a damaged attachment itself is skipped. The following ones
+    // can still be read if its size is known.
+    if (damaged) {
+      mxwarn(boost::format(Y("matroska_reader: The attachment at position %1% is damaged and will be skipped.\n")) % att->GetElementPosition());
+
+      if (!att->IsFiniteSize() || !io->setFilePointer2(att->GetElementPosition() + att->HeadSize() + att->GetSize()))
+        break;
+      continue;
+    }
+
     attach_mode_e attach_mode;
     if (   !matt.id
-        || !matt.data->get_size()
+        || !matt.get_size()
         || matt.mime_type.empty()
         || matt.name.empty()
         || ((attach_mode = attachment_requested(m_attachment_id)) == ATTACH_MODE_SKIP))
@@ -795,6 +831,17 @@ kax_reader_c::handle_tags(mm_io_c *io,
   }
 }
 
+void
+kax_reader_c::handle_cues(mm_io_c *io,
+                          EbmlElement *l0,
+                          int64_t pos) {
+  if (has_deferred_element_been_processed(dl1t_cues, pos))
+    return;
+
+  auto cue_points = read_cue_points(*io, *m_in_file, pos, *static_cast<KaxSegment *>(l0), m_tc_scale);
+  m_cue_points.insert(m_cue_points.end(), cue_points.begin(), cue_points.end());
+}
+
 void
 kax_reader_c::read_headers_info(EbmlElement *&l1,
                                 EbmlElement *&l2,
@@ -1214,6 +1261,7 @@ kax_reader_c::read_headers_seek_head(EbmlElement *l0,
 
         type = id == EBML_ID(KaxAttachments) ? dl1t_attachments
           :    id == EBML_ID(KaxChapters)    ? dl1t_chapters
+          :    id == EBML_ID(KaxCues)        ? dl1t_cues
           :    id == EBML_ID(KaxTags)        ? dl1t_tags
           :    id == EBML_ID(KaxTracks)      ? dl1t_tracks
           :                                    dl1t_unknown;
@@ -1294,6 +1342,9 @@ kax_reader_c::read_headers_internal() {
       else if (EbmlId(*l1) == EBML_ID(KaxTags))
         m_deferred_l1_positions[dl1t_tags].push_back(l1->GetElementPosition());
 
+      else if (EbmlId(*l1) == EBML_ID(KaxCues))
+        m_deferred_l1_positions[dl1t_cues].push_back(l1->GetElementPosition());
+
       else if (EbmlId(*l1) == EBML_ID(KaxSeekHead))
         read_headers_seek_head(l0, l1);
 
@@ -1352,13 +1403,23 @@ kax_reader_c::read_headers_internal() {
     if (!m_ti.m_no_global_tags)
       process_global_tags();
 
+    if (-1 != m_ti.m_range_start) {
+      for (auto position : m_deferred_l1_positions[dl1t_cues])
+        handle_cues(m_in.get(), l0, position);
+    }
+
   } catch (...) {
     mxerror(Y("matroska_reader: caught exception\n"));
   }
 
   verify_tracks();
+  init_range();
+
+  if (-1 != m_range_start_position) {
+    m_in->setFilePointer(m_range_start_position, seek_beginning);
+    delete cluster;
 
-  if (cluster) {
+  } else if (cluster) {
     m_in->setFilePointer(cluster->GetElementPosition(), seek_beginning);
     delete cluster;
 
@@ -1368,6 +1429,159 @@ kax_reader_c::read_headers_internal() {
   return true;
 }
 
+/** \brief Determines where reading starts for \c --start/--stop
+
+   With video tracks the copied range has to start at a key frame, and
+   each video track's blocks are only copied from its own first key
+   frame in the range on. For each video track the latest cue point at
+   or before the start timecode is determined, and the earliest of
+   those is used for seeking to its cluster directly. Without cues the
+   whole file is read up to the range's start.
+*/
+void
+kax_reader_c::init_range() {
+  if ((-1 == m_ti.m_range_start) && (-1 == m_ti.m_range_stop))
+    return;
+
+  std::set<uint64_t> video_track_numbers;
+  for (auto &track : m_tracks)
+    if (track->ok && ('v' == track->type) && demuxing_requested('v', track->tnum))
+      video_track_numbers.insert(track->track_number);
+
+  m_range_has_video = !video_track_numbers.empty();
+
+  if (-1 != m_ti.m_range_start) {
+    m_range_offset               = m_ti.m_range_start;
+    m_range_pending_video_tracks = video_track_numbers;
+
+    if (m_range_has_video) {
+      auto start = find_range_start_cue_point(m_cue_points, m_ti.m_range_start, [&video_track_numbers](uint64_t track_number) { return map_has_key(video_track_numbers, track_number); });
+      if (start) {
+        m_range_offset         = start->timecode;
+        m_range_start_position = start->position;
+      }
+    }
+
+    mxverb(2, boost::format("matroska_reader: range starts at %1% from position %2%\n") % format_timecode(m_range_offset) % m_range_start_position);
+  }
+
+  m_cue_points.clear();
+}
+
+/** \brief Keeps only the chapters in the range given with \c --start/--stop
+
+   The chapters are shifted by the timecode of the first block that
+   will be copied just like the packets are. That block is located by
+   scanning the clusters from the range's start position on, so this
+   can only be done once the packetizers have been created.
+*/
+void
+kax_reader_c::select_range_chapters() {
+  if (!m_chapters || ((-1 == m_ti.m_range_start) && (-1 == m_ti.m_range_stop)))
+    return;
+
+  int64_t first_timecode = -1 == m_ti.m_range_start ? 0 : find_first_timecode_in_range();
+
+  mxverb(2, boost::format("matroska_reader: shifting the chapters by %1%\n") % format_timecode(first_timecode));
+
+  if (   (-1 == first_timecode)
+      || !select_chapters_in_timeframe(m_chapters.get(), first_timecode, -1 == m_ti.m_range_stop ? std::numeric_limits<int64_t>::max() : m_ti.m_range_stop, first_timecode))
+    m_chapters.reset();
+}
+
+/** \brief Returns the timecode of the first block that will be copied
+
+   The clusters are read from the current position on without handing
+   anything to the packetizers. The file position is restored
+   afterwards. Returns -1 if no block of the range is found.
+*/
+int64_t
+kax_reader_c::find_first_timecode_in_range() {
+  m_in->save_pos();
+  at_scope_exit_c restore([this]() { m_in->restore_pos(); });
+
+  kax_cluster_scanner_c scanner;
+  scanner.set_timecode_scale(m_tc_scale);
+
+  try {
+    while (true) {
+      if (!m_in_file->scan_next_cluster(scanner)) {
+        std::unique_ptr<KaxCluster> cluster(m_in_file->read_next_cluster());
+        if (!cluster)
+          return -1;
+
+        scanner.import(*cluster);
+      }
+
+      if ((-1 != m_ti.m_range_stop) && (static_cast<int64_t>(scanner.get_timecode() * m_tc_scale) >= m_ti.m_range_stop))
+        return -1;
+
+      for (auto &block : scanner.get_blocks())
+        if (   block.block_found
+            && ((-1 == m_ti.m_range_stop) || (block.timecode < m_ti.m_range_stop))
+            && can_start_range_with(block))
+          return block.timecode;
+    }
+
+  } catch (...) {
+  }
+
+  return -1;
+}
+
+// The first block copied must be a key frame of a video track if
+// there is one.
+bool
+kax_reader_c::can_start_range_with(kax_scanned_block_t const &block) {
+  if (block.timecode < m_range_offset)
+    return false;
+
+  kax_track_t *track = find_track_by_num(block.track_number);
+  if (!track || (-1 == track->ptzr))
+    return false;
+
+  return !m_range_has_video || (('v' == track->type) && is_key_frame(block));
+}
+
+bool
+kax_reader_c::is_key_frame(kax_scanned_block_t const &block) {
+  return block.is_simple ? block.keyframe : !block.bref_found;
+}
+
+bool
+kax_reader_c::is_block_in_range(kax_scanned_block_t const &block) {
+  if (!block.block_found)
+    return m_range_started;
+
+  if ((-1 != m_ti.m_range_stop) && (block.timecode >= m_ti.m_range_stop))
+    return false;
+
+  if (m_range_started) {
+    if ((-1 != m_ti.m_range_start) && (block.timecode < m_first_timecode))
+      return false;
+
+    // Other video tracks than the one the range started with are
+    // skipped until they reach a key frame themselves.
+    if (!map_has_key(m_range_pending_video_tracks, block.track_number))
+      return true;
+
+    if (!is_key_frame(block))
+      return false;
+
+    m_range_pending_video_tracks.erase(block.track_number);
+    return true;
+  }
+
+  if (!can_start_range_with(block))
+    return false;
+
+  m_range_started  = true;
+  m_first_timecode = block.timecode;
+  m_range_pending_video_tracks.erase(block.track_number);
+
+  return true;
+}
+
 void
 kax_reader_c::process_global_tags() {
   if (!m_tags || g_identifying)
@@ -1823,6 +2037,8 @@ kax_reader_c::create_packetizers() {
   for (auto &track : m_tracks)
     create_packetizer(track->tnum);
 
+  select_range_chapters();
+
   if (!g_segment_title_set) {
     g_segment_title     = m_title;
     g_segment_title_set = true;
@@ -1966,19 +2182,34 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
   }
 
   try {
-    KaxCluster *cluster = m_in_file->read_next_cluster();
-    if (!cluster) {
+    // Clusters are normally parsed by the scanner directly from the
+    // file's bytes. libebml is only used for the ones it cannot handle.
+    KaxCluster *cluster = nullptr;
+    m_cluster_scanner.set_timecode_scale(m_tc_scale);
+
+    if (!m_in_file->scan_next_cluster(m_cluster_scanner)) {
+      cluster = m_in_file->read_next_cluster();
+      if (!cluster) {
+        flush_packetizers();
+
+        m_file_status = FILE_STATUS_DONE;
+        return FILE_STATUS_DONE;
+      }
+
+      m_cluster_scanner.import(*cluster);
+    }
+
+    uint64_t cluster_tc = m_cluster_scanner.get_timecode();
+
+    if ((-1 != m_ti.m_range_stop) && (static_cast<int64_t>(cluster_tc * m_tc_scale) >= m_ti.m_range_stop)) {
+      delete cluster;
       flush_packetizers();
 
       m_file_status = FILE_STATUS_DONE;
       return FILE_STATUS_DONE;
     }
 
-    KaxClusterTimecode *ctc = static_cast<KaxClusterTimecode *>(cluster->FindFirstElt(EBML_INFO(KaxClusterTimecode), false));
-    uint64_t cluster_tc = ctc ? uint64(*ctc) : 0;
-    cluster->InitTimecode(cluster_tc, m_tc_scale);
-
-    if (-1 == m_first_timecode) {
+    if ((-1 == m_first_timecode) && (-1 == m_ti.m_range_start)) {
       m_first_timecode = cluster_tc * m_tc_scale;
 
       // If we're appending this file to another one then the core
@@ -1987,16 +2218,18 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
         adjust_chapter_timecodes(*m_chapters, -m_first_timecode);
     }
 
-    size_t bgidx;
-    for (bgidx = 0; bgidx < cluster->ListSize(); bgidx++) {
-      EbmlElement *element = (*cluster)[bgidx];
+    std::vector<kax_scanned_block_t const *> blocks;
+    for (auto &block : m_cluster_scanner.get_blocks())
+      if (is_block_in_range(block))
+        blocks.push_back(&block);
 
-      if (EbmlId(*element) == EBML_ID(KaxSimpleBlock))
-        process_simple_block(cluster, static_cast<KaxSimpleBlock *>(element));
+    decode_cluster_frames(blocks);
 
-      else if (EbmlId(*element) == EBML_ID(KaxBlockGroup))
-        process_block_group(cluster, static_cast<KaxBlockGroup *>(element));
-    }
+    for (auto block : blocks)
+      if (block->is_simple)
+        process_simple_block(*block);
+      else
+        process_block_group(*block);
 
     delete cluster;
 
@@ -2009,20 +2242,106 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
   return FILE_STATUS_MOREDATA;
 }
 
+/** \brief Decodes the compressed frames of a whole cluster at once
+
+   Frames of tracks whose content encodings are expensive to reverse
+   (zlib, bzlib) are collected for the whole cluster and decoded on the
+   thread pool. \c get_decoded_frame() and \c get_decoded_addition()
+   return the results; all other frames are still decoded one by one
+   when they're processed.
+*/
+void
+kax_reader_c::decode_cluster_frames(std::vector<kax_scanned_block_t const *> const &blocks) {
+  m_decoded_frames.clear();
+  m_decoded_additions.clear();
+
+  if (debugging_requested("no_threaded_decoding"))
+    return;
+
+  std::map<kax_track_t *, std::vector<kax_scanned_block_t const *> > blocks_by_track;
+
+  for (auto block : blocks) {
+    if (!block->block_found)
+      continue;
+
+    kax_track_t *track = find_track_by_num(block->track_number);
+    if (track && (-1 != track->ptzr) && track->content_decoder.has_expensive_encodings(CONTENT_ENCODING_SCOPE_BLOCK))
+      blocks_by_track[track].push_back(block);
+  }
+
+  for (auto &track_blocks : blocks_by_track) {
+    kax_track_t *track = track_blocks.first;
+    std::vector<memory_cptr> buffers;
+    std::vector<std::pair<bool, size_t> > targets;
+
+    for (auto block : track_blocks.second) {
+      size_t i;
+      for (i = 0; block->num_frames > i; ++i) {
+        buffers.push_back(m_cluster_scanner.get_frame(*block, i));
+        targets.push_back(std::make_pair(false, block->first_frame + i));
+      }
+
+      if (track->passthrough)
+        continue;
+
+      for (i = 0; block->num_additions > i; ++i) {
+        buffers.push_back(m_cluster_scanner.get_addition(*block, i));
+        targets.push_back(std::make_pair(true, block->first_addition + i));
+      }
+    }
+
+    track->content_decoder.reverse(buffers, CONTENT_ENCODING_SCOPE_BLOCK);
+
+    size_t idx;
+    for (idx = 0; buffers.size() > idx; ++idx) {
+      auto &decoded = targets[idx].first ? m_decoded_additions : m_decoded_frames;
+      if (decoded.size() <= targets[idx].second)
+        decoded.resize(targets[idx].second + 1);
+      decoded[targets[idx].second] = buffers[idx];
+    }
+  }
+}
+
+memory_cptr
+kax_reader_c::get_decoded_frame(kax_track_t *track,
+                                kax_scanned_block_t const &block,
+                                size_t idx) {
+  size_t frame_idx = block.first_frame + idx;
+  if ((m_decoded_frames.size() > frame_idx) && m_decoded_frames[frame_idx])
+    return m_decoded_frames[frame_idx];
+
+  memory_cptr data = m_cluster_scanner.get_frame(block, idx);
+  track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+
+  return data;
+}
+
+memory_cptr
+kax_reader_c::get_decoded_addition(kax_track_t *track,
+                                   kax_scanned_block_t const &block,
+                                   size_t idx) {
+  size_t addition_idx = block.first_addition + idx;
+  if ((m_decoded_additions.size() > addition_idx) && m_decoded_additions[addition_idx])
+    return m_decoded_additions[addition_idx];
+
+  memory_cptr data = m_cluster_scanner.get_addition(block, idx);
+  track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+
+  return data;
+}
+
 void
-kax_reader_c::process_simple_block(KaxCluster *cluster,
-                                   KaxSimpleBlock *block_simple) {
+kax_reader_c::process_simple_block(kax_scanned_block_t const &block_simple) {
   int64_t block_duration = -1;
   int64_t block_bref     = VFT_IFRAME;
   int64_t block_fref     = VFT_NOBFRAME;
 
-  block_simple->SetParent(*cluster);
-  kax_track_t *block_track = find_track_by_num(block_simple->TrackNum());
+  kax_track_t *block_track = find_track_by_num(block_simple.track_number);
 
   if (!block_track) {
     mxwarn_fn(m_ti.m_fname,
               boost::format(Y("A block was found at timestamp %1% for track number %2%. However, no headers where found for that track number. "
-                              "The block will be skipped.\n")) % format_timecode(block_simple->GlobalTimecode()) % block_simple->TrackNum());
+                              "The block will be skipped.\n")) % format_timecode(block_simple.timecode) % block_simple.track_number);
     return;
   }
 
@@ -2039,18 +2358,18 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
       block_duration = 0;
   }
 
-  if (!block_simple->IsKeyframe()) {
-    if (block_simple->IsDiscardable())
+  if (!block_simple.keyframe) {
+    if (block_simple.discardable)
       block_fref = block_track->previous_timecode;
     else
       block_bref = block_track->previous_timecode;
   }
 
-  m_last_timecode = block_simple->GlobalTimecode();
+  m_last_timecode = block_simple.timecode;
 
-  // If we're appending this file to another one then the core
-  // needs the timecodes shifted to zero.
-  if (m_appending)
+  // If we're appending this file to another one or only copying a
+  // range then the core needs the timecodes shifted to zero.
+  if (m_appending || (-1 != m_ti.m_range_start))
     m_last_timecode -= m_first_timecode;
 
   if ((-1 != block_track->ptzr) && block_track->passthrough) {
@@ -2058,10 +2377,8 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
     // any special cases, e.g. 0 terminating a string for the subs
     // and stuff. Just pass everything through as it is.
     size_t i;
-    for (i = 0; block_simple->NumberFrames() > i; ++i) {
-      DataBuffer &data_buffer = block_simple->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
-      block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+    for (i = 0; block_simple.num_frames > i; ++i) {
+      memory_cptr data = get_decoded_frame(block_track, block_simple, i);
       packet_cptr packet(new packet_t(data, m_last_timecode + i * frame_duration, block_duration, block_bref, block_fref));
 
       static_cast<passthrough_packetizer_c *>(PTZR(block_track->ptzr))->process(packet);
@@ -2069,10 +2386,8 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
 
   } else if (-1 != block_track->ptzr) {
     size_t i;
-    for (i = 0; i < block_simple->NumberFrames(); i++) {
-      DataBuffer &data_buffer = block_simple->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
-      block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+    for (i = 0; i < block_simple.num_frames; i++) {
+      memory_cptr data = get_decoded_frame(block_track, block_simple, i);
 
       if (('s' == block_track->type) && ('t' == block_track->sub_type)) {
         if ((2 < data->get_size()) || ((0 < data->get_size()) && (' ' != *data->get_buffer()) && (0 != *data->get_buffer()) && !iscr(*data->get_buffer()))) {
@@ -2091,54 +2406,37 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
   }
 
   block_track->previous_timecode  = m_last_timecode;
-  block_track->units_processed   += block_simple->NumberFrames();
+  block_track->units_processed   += block_simple.num_frames;
 }
 
 void
-kax_reader_c::process_block_group(KaxCluster *cluster,
-                                  KaxBlockGroup *block_group) {
-  int64_t block_duration       = -1;
-  int64_t block_bref           = VFT_IFRAME;
-  int64_t block_fref           = VFT_NOBFRAME;
-  bool bref_found              = false;
-  bool fref_found              = false;
-  KaxReferenceBlock *ref_block = static_cast<KaxReferenceBlock *>(block_group->FindFirstElt(EBML_INFO(KaxReferenceBlock), false));
-
-  while (ref_block) {
-    if (0 >= int64(*ref_block)) {
-      block_bref = int64(*ref_block) * m_tc_scale;
-      bref_found = true;
-    } else {
-      block_fref = int64(*ref_block) * m_tc_scale;
-      fref_found = true;
-    }
-
-    ref_block = static_cast<KaxReferenceBlock *>(block_group->FindNextElt(*ref_block, false));
-  }
+kax_reader_c::process_block_group(kax_scanned_block_t const &block_group) {
+  int64_t block_duration = -1;
+  int64_t block_bref     = block_group.bref_found ? block_group.bref * m_tc_scale : VFT_IFRAME;
+  int64_t block_fref     = block_group.fref_found ? block_group.fref * m_tc_scale : VFT_NOBFRAME;
+  bool bref_found        = block_group.bref_found;
+  bool fref_found        = block_group.fref_found;
 
-  KaxBlock *block = static_cast<KaxBlock *>(block_group->FindFirstElt(EBML_INFO(KaxBlock), false));
-  if (!block) {
+  if (!block_group.block_found) {
     mxwarn_fn(m_ti.m_fname,
               boost::format(Y("A block group was found at position %1%, but no block element was found inside it. This might make mkvmerge crash.\n"))
-              % block_group->GetElementPosition());
+              % block_group.position);
     return;
   }
 
-  block->SetParent(*cluster);
-  kax_track_t *block_track = find_track_by_num(block->TrackNum());
+  kax_track_t *block_track = find_track_by_num(block_group.track_number);
 
   if (!block_track) {
     mxwarn_fn(m_ti.m_fname,
               boost::format(Y("A block was found at timestamp %1% for track number %2%. However, no headers where found for that track number. "
-                              "The block will be skipped.\n")) % format_timecode(block->GlobalTimecode()) % block->TrackNum());
+                              "The block will be skipped.\n")) % format_timecode(block_group.timecode) % block_group.track_number);
     return;
   }
 
-  KaxBlockAdditions *blockadd = static_cast<KaxBlockAdditions *>(block_group->FindFirstElt(EBML_INFO(KaxBlockAdditions), false));
-  KaxBlockDuration *duration  = static_cast<KaxBlockDuration *>(block_group->FindFirstElt(EBML_INFO(KaxBlockDuration), false));
+  bool duration = block_group.duration_found;
 
   if (duration)
-    block_duration = uint64(*duration) * m_tc_scale / block->NumberFrames();
+    block_duration = block_group.duration * m_tc_scale / block_group.num_frames;
   else if (0 != block_track->v_frate)
     block_duration = 1000000000.0 / block_track->v_frate;
   int64_t frame_duration = (block_duration == -1) ? 0 : block_duration;
@@ -2152,13 +2450,13 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
       block_duration = 0;
   }
 
-  m_last_timecode = block->GlobalTimecode();
-  // If we're appending this file to another one then the core
-  // needs the timecodes shifted to zero.
-  if (m_appending)
+  m_last_timecode = block_group.timecode;
+  // If we're appending this file to another one or only copying a
+  // range then the core needs the timecodes shifted to zero.
+  if (m_appending || (-1 != m_ti.m_range_start))
     m_last_timecode -= m_first_timecode;
 
-  KaxCodecState *codec_state = static_cast<KaxCodecState *>(block_group->FindFirstElt(EBML_INFO(KaxCodecState)));
+  auto &codec_state = block_group.codec_state;
 
   if ((-1 != block_track->ptzr) && block_track->passthrough) {
     // The handling for passthrough is a bit different. We don't have
@@ -2170,16 +2468,14 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
       block_fref += m_last_timecode;
 
     size_t i;
-    for (i = 0; i < block->NumberFrames(); i++) {
-      DataBuffer &data_buffer = block->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
-      block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+    for (i = 0; i < block_group.num_frames; i++) {
+      memory_cptr data = get_decoded_frame(block_track, block_group, i);
 
       packet_cptr packet(new packet_t(data, m_last_timecode + i * frame_duration, block_duration, block_bref, block_fref));
       packet->duration_mandatory = duration;
 
-      if (codec_state)
-        packet->codec_state = memory_c::clone(codec_state->GetBuffer(), codec_state->GetSize());
+      if (codec_state.data)
+        packet->codec_state = memory_c::clone(codec_state.data, codec_state.size);
 
       static_cast<passthrough_packetizer_c *>(PTZR(block_track->ptzr))->process(packet);
     }
@@ -2195,10 +2491,8 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
       block_fref += m_last_timecode;
 
     size_t i;
-    for (i = 0; i < block->NumberFrames(); i++) {
-      DataBuffer &data_buffer = block->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
-      block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
+    for (i = 0; i < block_group.num_frames; i++) {
+      memory_cptr data = get_decoded_frame(block_track, block_group, i);
 
       if (('s' == block_track->type) && ('t' == block_track->sub_type)) {
         if ((2 < data->get_size()) || ((0 < data->get_size()) && (' ' != *data->get_buffer()) && (0 != *data->get_buffer()) && !iscr(*data->get_buffer()))) {
@@ -2207,8 +2501,8 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
           mem->get_buffer()[ mem->get_size() - 1 ] = 0;
 
           packet_cptr packet(new packet_t(mem, m_last_timecode, block_duration, block_bref, block_fref));
-          if (codec_state)
-            packet->codec_state = memory_c::clone(codec_state->GetBuffer(), codec_state->GetSize());
+          if (codec_state.data)
+            packet->codec_state = memory_c::clone(codec_state.data, codec_state.size);
 
           PTZR(block_track->ptzr)->process(packet);
         }
@@ -2216,26 +2510,17 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
       } else {
         packet_cptr packet(new packet_t(data, m_last_timecode + i * frame_duration, block_duration, block_bref, block_fref));
 
-        if ((duration) && (0 == uint64(*duration)))
+        if (duration && (0 == block_group.duration))
           packet->duration_mandatory = true;
 
-        if (codec_state)
-          packet->codec_state = memory_c::clone(codec_state->GetBuffer(), codec_state->GetSize());
-
-        if (blockadd) {
-          size_t k;
-          for (k = 0; k < blockadd->ListSize(); k++) {
-            if (!(is_id((*blockadd)[k], KaxBlockMore)))
-              continue;
+        if (codec_state.data)
+          packet->codec_state = memory_c::clone(codec_state.data, codec_state.size);
 
-            KaxBlockMore *blockmore           = static_cast<KaxBlockMore *>((*blockadd)[k]);
-            KaxBlockAdditional *blockadd_data = &GetChild<KaxBlockAdditional>(*blockmore);
+        size_t k;
+        for (k = 0; k < block_group.num_additions; k++) {
+          memory_cptr blockadded = get_decoded_addition(block_track, block_group, k);
 
-            memory_cptr blockadded(new memory_c(blockadd_data->GetBuffer(), blockadd_data->GetSize(), false));
-            block_track->content_decoder.reverse(blockadded, CONTENT_ENCODING_SCOPE_BLOCK);
-
-            packet->data_adds.push_back(blockadded);
-          }
+          packet->data_adds.push_back(blockadded);
         }
 
         PTZR(block_track->ptzr)->process(packet);
@@ -2243,12 +2528,18 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
     }
 
     block_track->previous_timecode  = m_last_timecode;
-    block_track->units_processed   += block->NumberFrames();
+    block_track->units_processed   += block_group.num_frames;
   }
 }
 
 int
 kax_reader_c::get_progress() {
+  if ((-1 != m_ti.m_range_start) || (-1 != m_ti.m_range_stop)) {
+    int64_t duration = (-1 != m_ti.m_range_stop ? m_ti.m_range_stop : m_segment_duration) - m_range_offset;
+    if (0 < duration)
+      return std::min<int64_t>(std::max<int64_t>(m_last_timecode - (-1 == m_ti.m_range_start ? std::max<int64_t>(m_first_timecode, 0) : 0), 0) * 100 / duration, 100);
+  }
+
   if (0 != m_segment_duration)
     return (m_last_timecode - std::max(m_first_timecode, static_cast<int64_t>(0))) * 100 / m_segment_duration;
 
@@ -2358,7 +2649,7 @@ kax_reader_c::identify() {
   }
 
   for (auto &attachment : g_attachments)
-    id_result_attachment(attachment.ui_id, attachment.mime_type, attachment.data->get_size(), attachment.name, attachment.description);
+    id_result_attachment(attachment.ui_id, attachment.mime_type, attachment.get_size(), attachment.name, attachment.description);
 
   if (m_chapters)
     id_result_chapters(count_chapter_atoms(*m_chapters));
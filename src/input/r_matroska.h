@@ -19,6 +19,7 @@
 
 #include "common/content_decoder.h"
 #include "common/error.h"
+#include "common/kax_cues.h"
 #include "common/kax_file.h"
 #include "common/mm_io.h"
 #include "common/mpeg4_p10.h"
@@ -160,6 +161,7 @@ private:
     dl1t_unknown,
     dl1t_attachments,
     dl1t_chapters,
+    dl1t_cues,
     dl1t_tags,
     dl1t_tracks,
   };
@@ -170,6 +172,8 @@ private:
   int64_t m_tc_scale;
 
   kax_file_cptr m_in_file;
+  kax_cluster_scanner_c m_cluster_scanner;
+  std::vector<memory_cptr> m_decoded_frames, m_decoded_additions;
 
   std::shared_ptr<EbmlStream> m_es;
 
@@ -190,6 +194,15 @@ private:
 
   file_status_e m_file_status;
 
+  // Support for --start/--stop: the cue points read from the file,
+  // the position of the cluster to start reading at, the timecode
+  // the copied range starts at and the video tracks that haven't
+  // reached their first key frame within the range yet.
+  std::vector<kax_cue_point_t> m_cue_points;
+  int64_t m_range_start_position, m_range_offset;
+  bool m_range_started, m_range_has_video;
+  std::set<uint64_t> m_range_pending_video_tracks;
+
 public:
   kax_reader_c(const track_info_c &ti, const mm_io_cptr &in);
   virtual ~kax_reader_c();
@@ -236,6 +249,7 @@ protected:
   virtual void handle_attachments(mm_io_c *io, EbmlElement *l0, int64_t pos);
   virtual void handle_chapters(mm_io_c *io, EbmlElement *l0, int64_t pos);
   virtual void handle_tags(mm_io_c *io, EbmlElement *l0, int64_t pos);
+  virtual void handle_cues(mm_io_c *io, EbmlElement *l0, int64_t pos);
   virtual void process_global_tags();
 
   virtual bool unlace_vorbis_private_data(kax_track_t *t, unsigned char *buffer, int size);
@@ -269,9 +283,19 @@ protected:
   virtual void read_headers_tracks(mm_io_c *io, EbmlElement *l0, int64_t position);
   virtual void read_headers_seek_head(EbmlElement *l0, EbmlElement *l1);
   virtual bool read_headers_internal();
-
-  virtual void process_simple_block(KaxCluster *cluster, KaxSimpleBlock *block_simple);
-  virtual void process_block_group(KaxCluster *cluster, KaxBlockGroup *block_group);
+  virtual void init_range();
+  virtual void select_range_chapters();
+  virtual int64_t find_first_timecode_in_range();
+  virtual bool can_start_range_with(kax_scanned_block_t const &block);
+  virtual bool is_key_frame(kax_scanned_block_t const &block);
+  virtual bool is_block_in_range(kax_scanned_block_t const &block);
+
+  virtual void process_simple_block(kax_scanned_block_t const &block_simple);
+  virtual void process_block_group(kax_scanned_block_t const &block_group);
+
+  virtual void decode_cluster_frames(std::vector<kax_scanned_block_t const *> const &blocks);
+  virtual memory_cptr get_decoded_frame(kax_track_t *track, kax_scanned_block_t const &block, size_t idx);
+  virtual memory_cptr get_decoded_addition(kax_track_t *track, kax_scanned_block_t const &block, size_t idx);
 
   void init_l1_position_storage(deferred_positions_t &storage);
   virtual bool has_deferred_element_been_processed(deferred_l1_type_e type, int64_t position);
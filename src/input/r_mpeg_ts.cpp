@@ -20,6 +20,7 @@
 #include "common/clpi.h"
 #include "common/endian.h"
 #include "common/math.h"
+#include "common/mm_mmap_io.h"
 #include "common/mp3.h"
 #include "common/ac3.h"
 #include "common/iso639.h"
@@ -43,6 +44,8 @@
 #define TS_PIDS_DETECT_SIZE    10 * 1024 * 1024
 #define TS_PACKET_SIZE         188
 #define TS_MAX_PACKET_SIZE     204
+#define TS_MAX_PID             0x1fff
+#define TS_PACKETS_PER_READ    1024
 
 int mpeg_ts_reader_c::potential_packet_sizes[] = { 188, 192, 204, 0 };
 
@@ -393,6 +396,10 @@ mpeg_ts_reader_c::mpeg_ts_reader_c(const track_info_c &ti,
   , m_debug_aac(debugging_requested("mpeg_aac") || debugging_requested("mpeg_ts"))
   , m_debug_timecode_wrapping{debugging_requested("mpeg_ts|mpeg_ts_timecode_wrapping")}
   , m_detected_packet_size(0)
+  , m_pid_to_track(TS_MAX_PID + 1, -1)
+  , m_read_buffer_pos(0)
+  , m_read_buffer_fill(0)
+  , m_read_buffer_start(0)
 {
 }
 
@@ -411,6 +418,7 @@ mpeg_ts_reader_c::read_headers() {
     mpeg_ts_track_ptr PAT(new mpeg_ts_track_c(*this));
     PAT->type = PAT_TYPE;
     tracks.push_back(PAT);
+    rebuild_pid_table();
 
     unsigned char buf[TS_MAX_PACKET_SIZE]; // maximum TS packet size + 1
 
@@ -443,6 +451,8 @@ mpeg_ts_reader_c::read_headers() {
     // track->timecode_offset = -1;
   }
 
+  rebuild_pid_table();
+
   parse_clip_info_file();
 
   show_demuxer_info();
@@ -799,12 +809,8 @@ mpeg_ts_reader_c::parse_packet(unsigned char *buf) {
   if (!(hdr->get_adaptation_field_control() & 0x01)) //no ts_payload
     return false;
 
-  size_t tidx;
-  for (tidx = 0; tracks.size() > tidx; ++tidx)
-    if ((tracks[tidx]->pid == table_pid) && !tracks[tidx]->processed)
-      break;
-
-  if (tidx >= tracks.size())
+  int tidx = m_pid_to_track[table_pid];
+  if (-1 == tidx)
     return false;
 
   unsigned char *ts_payload                 = (unsigned char *)hdr + sizeof(mpeg_ts_packet_header_t);
@@ -938,6 +944,10 @@ mpeg_ts_reader_c::probe_packet_complete(mpeg_ts_track_ptr &track,
     track->processed        = false;
     track->data_ready       = false;
   }
+
+  // Tracks may have been added or removed, and processed tracks no
+  // longer receive data.
+  rebuild_pid_table();
 }
 
 bool
@@ -1183,23 +1193,16 @@ mpeg_ts_reader_c::read(generic_packetizer_c *requested_ptzr,
       return FILE_STATUS_HOLDING;
   }
 
-  unsigned char buf[TS_MAX_PACKET_SIZE + 1];
-
   track_buffer_ready = -1;
 
   if (file_done)
     return flush_packetizers();
 
   while (true) {
-    if (m_in->read(buf, m_detected_packet_size) != static_cast<unsigned int>(m_detected_packet_size))
+    unsigned char *buf = read_next_packet();
+    if (!buf)
       return finish();
 
-    if (buf[0] != 0x47) {
-      if (resync(m_in->getFilePointer() - m_detected_packet_size))
-        continue;
-      return finish();
-    }
-
     parse_packet(buf);
 
     if (track_buffer_ready != -1) { // ES buffer ready
@@ -1279,6 +1282,66 @@ mpeg_ts_reader_c::parse_clip_info_file() {
   }
 }
 
+void
+mpeg_ts_reader_c::rebuild_pid_table() {
+  std::fill(m_pid_to_track.begin(), m_pid_to_track.end(), -1);
+
+  // Iterate backwards so that the first matching track wins.
+  for (int tidx = tracks.size() - 1; 0 <= tidx; --tidx)
+    if (!tracks[tidx]->processed && (TS_MAX_PID >= tracks[tidx]->pid))
+      m_pid_to_track[tracks[tidx]->pid] = tidx;
+}
+
+/** \brief Return the next TS packet from the read buffer
+
+   Refills the buffer with up to \c TS_PACKETS_PER_READ packets if it
+   is empty and resyncs if the next packet doesn't start with the sync
+   byte. Returns \c nullptr if no complete packet is left.
+
+   If the file is mapped into memory then the buffer is a view of the
+   mapping, and the packets are parsed without copying them first.
+*/
+unsigned char *
+mpeg_ts_reader_c::read_next_packet() {
+  auto mmap_in    = dynamic_cast<mm_mmap_io_c *>(m_in.get());
+  size_t max_size = TS_PACKETS_PER_READ * m_detected_packet_size;
+
+  if (!m_read_buffer && !mmap_in)
+    m_read_buffer = memory_c::alloc(max_size);
+
+  while (true) {
+    if (m_read_buffer_pos >= m_read_buffer_fill) {
+      m_read_buffer_start = m_in->getFilePointer();
+      m_read_buffer_pos   = 0;
+
+      if (mmap_in) {
+        m_read_buffer      = mmap_in->read_view(std::min<int64_t>(max_size, std::max<int64_t>(mmap_in->get_size() - m_read_buffer_start, 0)));
+        m_read_buffer_fill = m_read_buffer->get_size();
+      } else
+        m_read_buffer_fill = m_in->read(m_read_buffer->get_buffer(), m_read_buffer->get_size());
+
+      m_read_buffer_fill -= m_read_buffer_fill % m_detected_packet_size;
+
+      if (!m_read_buffer_fill)
+        return nullptr;
+    }
+
+    unsigned char *packet = m_read_buffer->get_buffer() + m_read_buffer_pos;
+
+    if (0x47 == packet[0]) {
+      m_read_buffer_pos += m_detected_packet_size;
+      return packet;
+    }
+
+    int64_t packet_pos = m_read_buffer_start + m_read_buffer_pos;
+    m_read_buffer_pos  = 0;
+    m_read_buffer_fill = 0;
+
+    if (!resync(packet_pos))
+      return nullptr;
+  }
+}
+
 bool
 mpeg_ts_reader_c::resync(int64_t start_at) {
   try {
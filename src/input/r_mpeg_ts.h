@@ -376,6 +376,15 @@ protected:
 
   int m_detected_packet_size;
 
+  // Index into tracks of the first unprocessed track for each of the
+  // 8192 possible PIDs or -1 if there's none.
+  std::vector<int> m_pid_to_track;
+
+  // Many TS packets are read at once during muxing.
+  memory_cptr m_read_buffer;
+  size_t m_read_buffer_pos, m_read_buffer_fill;
+  int64_t m_read_buffer_start;
+
 protected:
   static int potential_packet_sizes[];
 
@@ -418,6 +427,8 @@ private:
   void parse_clip_info_file();
 
   bool resync(int64_t start_at);
+  void rebuild_pid_table();
+  unsigned char *read_next_packet();
 
   friend class mpeg_ts_track_c;
 };
@@ -29,6 +29,7 @@
 #include "common/hacks.h"
 #include "common/iso639.h"
 #include "common/matroska.h"
+#include "common/mm_mmap_io.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "input/r_qtmp4.h"
@@ -47,6 +48,8 @@
 using namespace libmatroska;
 
 #define MAX_INTERLEAVING_BADNESS 0.4
+#define READ_AHEAD_SIZE          (4 * 1024 * 1024)
+#define MAX_COPIED_SAMPLE_SIZE   (64 * 1024)
 
 #if defined(ARCH_BIGENDIAN)
 #define BE2STR(a) ((char *)&a)[0] % ((char *)&a)[1] % ((char *)&a)[2] % ((char *)&a)[3]
@@ -142,6 +145,7 @@ qtmp4_reader_c::qtmp4_reader_c(const track_info_c &ti,
   , m_debug_headers(     debugging_requested("qtmp4") || debugging_requested("qtmp4_full") || debugging_requested("qtmp4_headers"))
   , m_debug_tables(                                      debugging_requested("qtmp4_full") || debugging_requested("qtmp4_tables"))
   , m_debug_interleaving(debugging_requested("qtmp4") || debugging_requested("qtmp4_full") || debugging_requested("qtmp4_interleaving"))
+  , m_debug_reads(                                       debugging_requested("qtmp4_full") || debugging_requested("qtmp4_reads"))
 {
 }
 
@@ -698,7 +702,7 @@ qtmp4_reader_c::read_chapter_track() {
 
   m_chapter_dmx->update_tables(m_time_scale);
 
-  if (m_chapter_dmx->sample_table.empty())
+  if (!m_chapter_dmx->num_samples)
     return;
 
   std::vector<qtmp4_chapter_entry_t> entries;
@@ -706,21 +710,23 @@ qtmp4_reader_c::read_chapter_track() {
   uint64_t pts_scale_num = 1000000000ull                                    / pts_scale_gcd;
   uint64_t pts_scale_den = static_cast<uint64_t>(m_chapter_dmx->time_scale) / pts_scale_gcd;
 
-  for (auto &sample : m_chapter_dmx->sample_table) {
-    if (2 >= sample.size)
+  uint64_t sample;
+  for (sample = 0; m_chapter_dmx->num_samples > sample; ++sample) {
+    uint32_t sample_size = m_chapter_dmx->get_sample_size(sample);
+    if (2 >= sample_size)
       continue;
 
-    m_in->setFilePointer(sample.pos, seek_beginning);
-    memory_cptr chunk(memory_c::alloc(sample.size));
-    if (m_in->read(chunk->get_buffer(), sample.size) != sample.size)
+    m_in->setFilePointer(m_chapter_dmx->get_sample_pos(sample), seek_beginning);
+    memory_cptr chunk(memory_c::alloc(sample_size));
+    if (m_in->read(chunk->get_buffer(), sample_size) != sample_size)
       continue;
 
     unsigned int name_len = get_uint16_be(chunk->get_buffer());
-    if ((name_len + 2) > sample.size)
+    if ((name_len + 2) > sample_size)
       continue;
 
     entries.push_back(qtmp4_chapter_entry_t(std::string(reinterpret_cast<char *>(chunk->get_buffer()) + 2, name_len),
-                                            sample.pts * pts_scale_num / pts_scale_den));
+                                            m_chapter_dmx->get_sample_pts(sample) * pts_scale_num / pts_scale_den));
   }
 
   recode_chapter_entries(entries);
@@ -915,13 +921,13 @@ qtmp4_reader_c::handle_stsz_atom(qtmp4_demuxer_cptr &new_dmx,
   uint32_t count       = m_in->read_uint32_be();
 
   if (0 == sample_size) {
+    new_dmx->sample_size_table.resize(count);
+
     size_t i;
-    for (i = 0; i < count; ++i) {
-      qt_sample_t sample;
+    for (i = 0; i < count; ++i)
+      new_dmx->sample_size_table[i] = m_in->read_uint32_be();
 
-      sample.size = m_in->read_uint32_be();
-      new_dmx->sample_table.push_back(sample);
-    }
+    new_dmx->num_samples = count;
 
     mxdebug_if(m_debug_headers, boost::format("%1%Sample size table: %2% entries\n") % space(level * 2 + 1) % count);
 
@@ -1060,7 +1066,7 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     if ((-1 == dmx->ptzr) || (PTZR(dmx->ptzr) != ptzr))
       continue;
 
-    if (dmx->pos < dmx->m_index.size())
+    if (dmx->pos < dmx->get_num_index_entries())
       break;
   }
 
@@ -1068,44 +1074,110 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     return flush_packetizers();
 
   qtmp4_demuxer_cptr &dmx = m_demuxers[dmx_idx];
-  qt_index_t &index       = dmx->m_index[dmx->pos];
+  qt_index_t const &index = dmx->get_index_entry(dmx->pos);
+
+  // Read the requested sample together with all samples the other
+  // demuxers need next as long as they lie within the read-ahead
+  // window. This way runs of adjacent samples are read with a single
+  // I/O operation, and badly interleaved files (e.g. with all audio
+  // samples located at the end) don't cause a seek for each sample.
+  int64_t window_start = index.file_pos;
+  int64_t window_limit = window_start + std::max<int64_t>(index.size, READ_AHEAD_SIZE);
+  int64_t window_end   = window_start + index.size;
+  std::vector<size_t> num_samples(m_demuxers.size(), 0);
 
-  m_in->setFilePointer(index.file_pos);
+  for (dmx_idx = 0; dmx_idx < m_demuxers.size(); ++dmx_idx) {
+    qtmp4_demuxer_cptr &cur_dmx = m_demuxers[dmx_idx];
+    if (-1 == cur_dmx->ptzr)
+      continue;
 
-  int buffer_offset = 0;
-  unsigned char *buffer;
+    size_t sample_idx;
+    for (sample_idx = cur_dmx->pos; sample_idx < cur_dmx->get_num_index_entries(); ++sample_idx) {
+      qt_index_t const &sample = cur_dmx->get_index_entry(sample_idx);
+      if ((sample.file_pos < window_start) || ((sample.file_pos + sample.size) > window_limit))
+        break;
 
-  if (   ('v' == dmx->type)
-      && (0 == dmx->pos)
-      && (!strncasecmp(dmx->fourcc, "mp4v", 4) || !strncasecmp(dmx->fourcc, "xvid", 4))
-      && dmx->esds_parsed
-      && (dmx->esds.decoder_config)) {
-    buffer        = (unsigned char *)safemalloc(index.size + dmx->esds.decoder_config->get_size());
-    buffer_offset = dmx->esds.decoder_config->get_size();
+      window_end = std::max(window_end, sample.file_pos + sample.size);
+      ++num_samples[dmx_idx];
+    }
+  }
 
-    memcpy(buffer, dmx->esds.decoder_config->get_buffer(), dmx->esds.decoder_config->get_size());
+  memory_cptr buffer;
+  int64_t num_read;
+  auto mmap_in = dynamic_cast<mm_mmap_io_c *>(m_in.get());
+
+  m_in->setFilePointer(window_start);
+
+  if (mmap_in) {
+    // Use the mapped file directly; the packets refer to the mapping.
+    num_read = std::min(window_end, mmap_in->get_size()) - window_start;
+    buffer   = mmap_in->read_view(std::max<int64_t>(num_read, 0));
 
   } else {
-    buffer = (unsigned char *)safemalloc(index.size);
+    buffer   = memory_c::alloc(window_end - window_start);
+    num_read = m_in->read(buffer->get_buffer(), buffer->get_size());
   }
 
-  if (m_in->read(buffer + buffer_offset, index.size) != index.size) {
+  mxdebug_if(m_debug_reads, boost::format("Reads: track ID %1% sample %2%: read %3% of %4% bytes from %5%\n") % dmx->id % dmx->pos % num_read % buffer->get_size() % window_start);
+
+  if (num_read < index.size) {
     mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
-           % dmx->pos % dmx->m_index.size() % index.size % index.file_pos);
-    safefree(buffer);
+           % dmx->pos % dmx->get_num_index_entries() % index.size % index.file_pos);
     return flush_packetizers();
   }
 
-  PTZR(dmx->ptzr)->process(new packet_t(new memory_c(buffer, index.size + buffer_offset, true), index.timecode, index.duration,
-                                        index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
-  ++dmx->pos;
+  for (dmx_idx = 0; dmx_idx < m_demuxers.size(); ++dmx_idx) {
+    qtmp4_demuxer_cptr &cur_dmx = m_demuxers[dmx_idx];
+
+    for (; 0 < num_samples[dmx_idx]; --num_samples[dmx_idx]) {
+      qt_index_t const &sample = cur_dmx->get_index_entry(cur_dmx->pos);
+
+      // Samples cut off by a short read will be read again (and
+      // reported) once their packetizer requests them.
+      if ((sample.file_pos + sample.size - window_start) > num_read)
+        break;
 
-  if (dmx->pos < dmx->m_index.size())
+      process_sample(cur_dmx, buffer, sample.file_pos - window_start, !mmap_in);
+    }
+  }
+
+  if (dmx->pos < dmx->get_num_index_entries())
     return FILE_STATUS_MOREDATA;
 
   return flush_packetizers();
 }
 
+void
+qtmp4_reader_c::process_sample(qtmp4_demuxer_cptr &dmx,
+                               memory_cptr const &buffer,
+                               size_t offset,
+                               bool copy_small_samples) {
+  qt_index_t const &index = dmx->get_index_entry(dmx->pos);
+  memory_cptr frame;
+
+  if (   ('v' == dmx->type)
+      && (0 == dmx->pos)
+      && (!strncasecmp(dmx->fourcc, "mp4v", 4) || !strncasecmp(dmx->fourcc, "xvid", 4))
+      && dmx->esds_parsed
+      && (dmx->esds.decoder_config)) {
+    frame = dmx->esds.decoder_config->clone();
+    frame->add(buffer->get_buffer() + offset, index.size);
+
+  } else if (copy_small_samples && (MAX_COPIED_SAMPLE_SIZE > index.size))
+    // A view would keep the whole read buffer alive for as long as the
+    // packetizer holds on to this packet, e.g. an audio sample queued
+    // while the other tracks catch up. Small samples are cheap to copy.
+    frame = memory_c::clone(buffer->get_buffer() + offset, index.size);
+
+  else
+    // The packet refers to the read buffer which is freed once all
+    // packets cut from it have been processed.
+    frame = memory_c::view(buffer, offset, index.size);
+
+  PTZR(dmx->ptzr)->process(new packet_t(frame, index.timecode, index.duration, index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+  ++dmx->pos;
+}
+
 memory_cptr
 qtmp4_reader_c::create_bitmap_info_header(qtmp4_demuxer_cptr &dmx,
                                           const char *fourcc,
@@ -1191,7 +1263,7 @@ qtmp4_reader_c::create_video_packetizer_mpeg1_2(qtmp4_demuxer_cptr &dmx) {
 
 void
 qtmp4_reader_c::create_video_packetizer_mpeg4_p10(qtmp4_demuxer_cptr &dmx) {
-  if (dmx->frame_offset_table.empty())
+  if (!dmx->num_frame_offsets)
     mxwarn_tid(m_ti.m_fname, dmx->id,
                Y("The AVC video track is missing the 'CTTS' atom for frame timecode offsets. "
                  "However, AVC/h.264 allows frames to have more than the traditional one (for P frames) or two (for B frames) references to other frames. "
@@ -1341,9 +1413,8 @@ qtmp4_reader_c::get_progress() {
     return 100;
 
   qtmp4_demuxer_cptr &dmx = m_demuxers[m_main_dmx];
-  unsigned int max_chunks = (0 == dmx->sample_size) ? dmx->sample_table.size() : dmx->chunk_table.size();
 
-  return 100 * dmx->pos / max_chunks;
+  return 100 * dmx->pos / dmx->get_num_index_entries();
 }
 
 void
@@ -1427,7 +1498,7 @@ void
 qtmp4_reader_c::detect_interleaving() {
   std::list<qtmp4_demuxer_cptr> demuxers_to_read;
   boost::remove_copy_if(m_demuxers, std::back_inserter(demuxers_to_read), [&](const qtmp4_demuxer_cptr &dmx) {
-      return !(dmx->ok && (dmx->is_audio() || dmx->is_video()) && demuxing_requested(dmx->type, dmx->id) && (dmx->sample_table.size() > 1));
+      return !(dmx->ok && (dmx->is_audio() || dmx->is_video()) && demuxing_requested(dmx->type, dmx->id) && (dmx->num_samples > 1));
     });
 
   if (demuxers_to_read.size() < 2) {
@@ -1435,12 +1506,14 @@ qtmp4_reader_c::detect_interleaving() {
     return;
   }
 
-  auto cmp = [](const qt_sample_t &s1, const qt_sample_t &s2) -> uint64_t { return s1.pos < s2.pos; };
-
   std::list<float> gradients;
   for (auto &dmx : demuxers_to_read) {
-    uint64_t min = boost::min_element(dmx->sample_table, cmp)->pos;
-    uint64_t max = boost::max_element(dmx->sample_table, cmp)->pos;
+    uint64_t min = dmx->get_sample_pos(0), max = min, sample;
+    for (sample = 1; dmx->num_samples > sample; ++sample) {
+      uint64_t pos = dmx->get_sample_pos(sample);
+      min          = std::min(min, pos);
+      max          = std::max(max, pos);
+    }
     gradients.push_back(static_cast<float>(max - min) / m_in->get_size());
 
     mxdebug_if(m_debug_interleaving, boost::format("Interleaving: Track id %1% min %2% max %3% gradient %4%\n") % dmx->id % min % max % gradients.back());
@@ -1459,18 +1532,29 @@ void
 qtmp4_demuxer_c::calculate_fps() {
   fps = 0.0;
 
-  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == frame_offset_table.size()))) {
+  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == num_frame_offsets))) {
     // Constant FPS. Let's set the default duration.
     fps = (double)time_scale / (double)durmap_table[0].duration;
     mxdebug_if(m_debug_fps, boost::format("calculate_fps: case 1: %1%\n") % fps);
 
-  } else if (!sample_table.empty()) {
+  } else if (1 < num_samples) {
     std::map<int64_t, int> duration_map;
 
-    std::accumulate(sample_table.begin() + 1, sample_table.end(), sample_table[0], [&](qt_sample_t &previous_sample, qt_sample_t &current_sample) -> qt_sample_t {
-      duration_map[current_sample.pts - previous_sample.pts]++;
-      return current_sample;
-    });
+    // The difference between two consecutive samples' PTS is the
+    // duration of the first one as long as both are covered by the
+    // duration table. Samples not covered by it have a PTS of 0.
+    uint64_t covered = durmap_table.empty() ? 0 : durmap_table.back().first_sample + durmap_table.back().number;
+    uint64_t limit   = std::max<uint64_t>(std::min(covered, num_samples), 1) - 1;
+
+    for (auto &durmap : durmap_table) {
+      uint64_t end = std::min<uint64_t>(durmap.first_sample + durmap.number, limit);
+      if (end > durmap.first_sample)
+        duration_map[durmap.duration] += end - durmap.first_sample;
+    }
+
+    uint64_t sample;
+    for (sample = limit + 1; num_samples > sample; ++sample)
+      duration_map[get_sample_pts(sample) - get_sample_pts(sample - 1)]++;
 
     auto most_common = std::accumulate(duration_map.begin(), duration_map.end(), std::pair<int64_t, int>(*duration_map.begin()),
                                        [](std::pair<int64_t, int> &a, std::pair<int64_t, int> e) { return e.second > a.second ? e : a; });
@@ -1496,111 +1580,78 @@ qtmp4_demuxer_c::to_nsecs(int64_t value) {
   return value / (time_scale / 1000000000ll);
 }
 
-void
-qtmp4_demuxer_c::calculate_timecodes() {
-  unsigned int frame;
-
-  if (0 != sample_size) {
-    for (frame = 0; chunk_table.size() > frame; ++frame) {
-      timecodes.push_back(to_nsecs((uint64_t)chunk_table[frame].samples * (uint64_t)duration));
-      durations.push_back(to_nsecs((uint64_t)chunk_table[frame].size    * (uint64_t)duration));
-      frame_indices.push_back(frame);
-    }
-
-    if (!timecodes.empty())
-      min_timecode = max_timecode = timecodes[0];
-
-    return;
-  }
-
-  int64_t v_dts_offset = 0;
-  std::vector<int64_t> timecodes_before_offsets;
-
-  if (('v' == type) && v_is_avc && !frame_offset_table.empty())
-    v_dts_offset = to_nsecs(frame_offset_table[0]);
-
-  for (frame = 0; sample_table.size() > frame; ++frame) {
-    int64_t timecode;
-
-    if (!editlist_table.empty()) {
-      unsigned int editlist_pos = 0;
-      unsigned int real_frame   = frame;
+int64_t
+qtmp4_demuxer_c::get_frame_timecode(uint64_t frame,
+                                    uint64_t *real_frame_out,
+                                    int64_t *timecode_before_offset) {
+  uint64_t real_frame = frame;
+  int64_t timecode;
 
-      while (((editlist_table.size() - 1) > editlist_pos) && (frame >= editlist_table[editlist_pos + 1].start_frame))
-        ++editlist_pos;
+  if (!editlist_table.empty()) {
+    unsigned int editlist_pos = 0;
 
-      if ((editlist_table[editlist_pos].start_frame + editlist_table[editlist_pos].frames) <= frame) {
-        // EOF
-        // calc pts:
-        timecode = to_nsecs(sample_table[real_frame].pts);
+    while (((editlist_table.size() - 1) > editlist_pos) && (frame >= editlist_table[editlist_pos + 1].start_frame))
+      ++editlist_pos;
 
-      } else {
-        // calc real frame index:
-        real_frame -= editlist_table[editlist_pos].start_frame;
-        real_frame += editlist_table[editlist_pos].start_sample;
+    if ((editlist_table[editlist_pos].start_frame + editlist_table[editlist_pos].frames) <= frame) {
+      // EOF
+      // calc pts:
+      timecode = to_nsecs(get_sample_pts(real_frame));
 
-        // calc pts:
-        timecode = to_nsecs(sample_table[real_frame].pts + editlist_table[editlist_pos].pts_offset);
-      }
+    } else {
+      // calc real frame index:
+      real_frame -= editlist_table[editlist_pos].start_frame;
+      real_frame += editlist_table[editlist_pos].start_sample;
 
-      frame_indices.push_back(real_frame);
+      // calc pts:
+      timecode = to_nsecs(get_sample_pts(real_frame) + editlist_table[editlist_pos].pts_offset);
+    }
 
-      timecodes_before_offsets.push_back(timecode);
+  } else
+    timecode = to_nsecs(get_sample_pts(frame));
 
-      if (('v' == type) && (frame_offset_table.size() > real_frame) && v_is_avc)
-         timecode += to_nsecs(frame_offset_table[real_frame]) - v_dts_offset;
+  if (real_frame_out)
+    *real_frame_out = real_frame;
+  if (timecode_before_offset)
+    *timecode_before_offset = timecode;
 
-    } else {
-      timecode = to_nsecs(sample_table[frame].pts);
-      frame_indices.push_back(frame);
+  if (('v' == type) && (num_frame_offsets > real_frame) && v_is_avc)
+    timecode += to_nsecs(get_frame_offset(real_frame)) - to_nsecs(get_frame_offset(0));
 
-      timecodes_before_offsets.push_back(timecode);
+  return timecode + timecode_offset;
+}
 
-      if (('v' == type) && (frame_offset_table.size() > frame) && v_is_avc)
-         timecode += to_nsecs(frame_offset_table[frame]) - v_dts_offset;
-    }
+void
+qtmp4_demuxer_c::calculate_timecodes() {
+  int64_t previous_timecode = 0, total_duration = 0, num_good_frames = 0;
+  uint64_t frame;
 
-    timecodes.push_back(timecode);
+  for (frame = 0; num_samples > frame; ++frame) {
+    int64_t timecode_before_offset;
+    int64_t timecode = get_frame_timecode(frame, nullptr, &timecode_before_offset);
 
     if (timecode > max_timecode)
       max_timecode = timecode;
     if (timecode < min_timecode)
       min_timecode = timecode;
-  }
-
-  int64_t avg_duration = 0, num_good_frames = 0;
 
-  for (frame = 0; timecodes_before_offsets.size() > (frame + 1); ++frame) {
-    int64_t diff = timecodes_before_offsets[frame + 1] - timecodes_before_offsets[frame];
-
-    if (0 >= diff)
-      durations.push_back(0);
-    else {
+    int64_t diff = timecode_before_offset - previous_timecode;
+    if (frame && (0 < diff)) {
       ++num_good_frames;
-      avg_duration += diff;
-      durations.push_back(diff);
+      total_duration += diff;
     }
-  }
 
-  durations.push_back(0);
-
-  if (num_good_frames) {
-    avg_duration /= num_good_frames;
-    for (frame = 0; durations.size() > frame; ++frame)
-      if (!durations[frame])
-        durations[frame] = avg_duration;
+    previous_timecode = timecode_before_offset;
   }
+
+  avg_duration = num_good_frames ? total_duration / num_good_frames : 0;
 }
 
 void
 qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
-  size_t i;
-
-  for (i = 0; timecodes.size() > i; ++i)
-    timecodes[i] += delta;
-
-  min_timecode += delta;
-  max_timecode += delta;
+  timecode_offset += delta;
+  min_timecode    += delta;
+  max_timecode    += delta;
 }
 
 bool
@@ -1634,18 +1685,13 @@ qtmp4_demuxer_c::update_tables(int64_t global_m_time_scale) {
 
   // workaround for fixed-size video frames (dv and uncompressed), but
   // also for audio with constant sample size
-  if (sample_table.empty() && sample_size) {
-    for (i = 0; i < s; ++i) {
-      qt_sample_t sample;
-
-      sample.size = sample_size;
-      sample_table.push_back(sample);
-    }
-
-    sample_size = 0;
+  if (sample_size_table.empty() && sample_size) {
+    num_samples       = s;
+    fixed_sample_size = sample_size;
+    sample_size       = 0;
   }
 
-  if (sample_table.empty()) {
+  if (!num_samples) {
     // constant samplesize
     if ((1 == durmap_table.size()) || ((2 == durmap_table.size()) && (1 == durmap_table[1].number)))
       duration = durmap_table[0].duration;
@@ -1655,48 +1701,109 @@ qtmp4_demuxer_c::update_tables(int64_t global_m_time_scale) {
     return true;
   }
 
-  // calc pts:
+  // calc pts: only the first sample and its PTS are stored for each
+  // run of samples with the same duration.
   s            = 0;
   uint64_t pts = 0;
 
-  for (j = 0; j < durmap_table.size(); ++j) {
-    for (i = 0; i < durmap_table[j].number; ++i) {
-      sample_table[s].pts  = pts;
-      pts                 += durmap_table[j].duration;
-      ++s;
-    }
+  for (auto &durmap : durmap_table) {
+    durmap.first_sample  = s;
+    durmap.first_pts     = pts;
+    s                   += durmap.number;
+    pts                 += static_cast<uint64_t>(durmap.number) * durmap.duration;
   }
 
-  // calc sample offsets
-  s = 0;
-  for (j = 0; j < chunk_table.size(); ++j) {
-    uint64_t chunk_pos = chunk_table[j].pos;
-
-    for (i = 0; i < chunk_table[j].size; ++i) {
-      sample_table[s].pos  = chunk_pos;
-      chunk_pos           += sample_table[s].size;
-      ++s;
-    }
+  // calc pts/dts offsets
+  num_frame_offsets = 0;
+  for (auto &frame_offset : raw_frame_offset_table) {
+    frame_offset.first_sample  = num_frame_offsets;
+    num_frame_offsets         += frame_offset.count;
   }
 
-  // calc pts/dts offsets
-  for (j = 0; j < raw_frame_offset_table.size(); ++j) {
-    size_t k;
+  mxdebug_if(m_debug_tables, boost::format(" Frame offset table: %1% entries\n")    % num_frame_offsets);
+  mxdebug_if(m_debug_tables, boost::format(" Sample table contents: %1% entries\n") % num_samples);
+  if (m_debug_tables)
+    for (s = 0; s < num_samples; ++s)
+      mxdebug(boost::format("   %1%: pts %2% size %3% pos %4%\n") % s % get_sample_pts(s) % get_sample_size(s) % get_sample_pos(s));
 
-    for (k = 0; k < raw_frame_offset_table[j].count; ++k)
-      frame_offset_table.push_back(raw_frame_offset_table[j].offset);
+  update_editlist_table(global_m_time_scale);
+
+  return true;
+}
+
+uint32_t
+qtmp4_demuxer_c::get_sample_size(uint64_t sample)
+  const {
+  if (sample_size_table.empty())
+    return sample < num_samples ? fixed_sample_size : 0;
+
+  return sample < sample_size_table.size() ? sample_size_table[sample] : 0;
+}
+
+uint64_t
+qtmp4_demuxer_c::get_sample_pos(uint64_t sample) {
+  // Samples are usually requested in order. Avoid looking up the chunk
+  // and summing up the sizes of the preceding samples in that case.
+  if (   (sample == (m_pos_cache_sample + 1))
+      && (m_pos_cache_chunk < chunk_table.size())
+      && (sample < (static_cast<uint64_t>(chunk_table[m_pos_cache_chunk].samples) + chunk_table[m_pos_cache_chunk].size))) {
+    m_pos_cache_pos    += get_sample_size(m_pos_cache_sample);
+    m_pos_cache_sample  = sample;
+
+    return m_pos_cache_pos;
   }
 
-  mxdebug_if(m_debug_tables, boost::format(" Frame offset table: %1% entries\n")    % frame_offset_table.size());
-  mxdebug_if(m_debug_tables, boost::format(" Sample table contents: %1% entries\n") % sample_table.size());
-  for (i = 0; i < sample_table.size(); ++i) {
-    qt_sample_t &sample = sample_table[i];
-    mxdebug_if(m_debug_tables, boost::format("   %1%: pts %2% size %3% pos %4%\n") % i % sample.pts % sample.size % sample.pos);
+  auto chunk = std::upper_bound(chunk_table.begin(), chunk_table.end(), sample, [](uint64_t wanted, qt_chunk_t const &c) { return wanted < c.samples; });
+  if (chunk_table.begin() == chunk)
+    return 0;
+
+  --chunk;
+  if (sample >= (static_cast<uint64_t>(chunk->samples) + chunk->size))
+    return 0;
+
+  uint64_t pos = chunk->pos;
+  if (sample_size_table.empty())
+    pos += (sample - chunk->samples) * fixed_sample_size;
+
+  else {
+    uint64_t idx;
+    for (idx = chunk->samples; idx < sample; ++idx)
+      pos += get_sample_size(idx);
   }
 
-  update_editlist_table(global_m_time_scale);
+  m_pos_cache_sample = sample;
+  m_pos_cache_pos    = pos;
+  m_pos_cache_chunk  = std::distance(chunk_table.begin(), chunk);
 
-  return true;
+  return pos;
+}
+
+uint64_t
+qtmp4_demuxer_c::get_sample_pts(uint64_t sample)
+  const {
+  auto durmap = std::upper_bound(durmap_table.begin(), durmap_table.end(), sample, [](uint64_t wanted, qt_durmap_t const &d) { return wanted < d.first_sample; });
+  if (durmap_table.begin() == durmap)
+    return 0;
+
+  --durmap;
+  if (sample >= (durmap->first_sample + durmap->number))
+    return 0;
+
+  return durmap->first_pts + (sample - durmap->first_sample) * durmap->duration;
+}
+
+int32_t
+qtmp4_demuxer_c::get_frame_offset(uint64_t sample)
+  const {
+  auto frame_offset = std::upper_bound(raw_frame_offset_table.begin(), raw_frame_offset_table.end(), sample, [](uint64_t wanted, qt_frame_offset_t const &o) { return wanted < o.first_sample; });
+  if (raw_frame_offset_table.begin() == frame_offset)
+    return 0;
+
+  --frame_offset;
+  if (sample >= (frame_offset->first_sample + frame_offset->count))
+    return 0;
+
+  return static_cast<int32_t>(frame_offset->offset);
 }
 
 // Also taken from mplayer's demux_mov.c file.
@@ -1712,8 +1819,8 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
     min_editlist_pts = std::min(static_cast<int64_t>(editlist_table[i].pos), min_editlist_pts);
 
   uint64_t pts_offset = 0;
-  if (('v' == type) && v_is_avc && !frame_offset_table.empty() && (frame_offset_table[0] <= min_editlist_pts))
-    pts_offset = frame_offset_table[0];
+  if (('v' == type) && v_is_avc && num_frame_offsets && (get_frame_offset(0) <= min_editlist_pts))
+    pts_offset = get_frame_offset(0);
 
   mxdebug_if(m_debug_tables, boost::format("Updating edit list table for track %1%; pts_offset = %2%\n") % id % pts_offset);
 
@@ -1728,24 +1835,24 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
       continue;
     }
 
-    unsigned int sample = 0;
+    uint64_t sample = 0;
 
     pts                -= pts_offset;
     el.start_frame      = frame;
 
     // find start sample
-    for (; sample_table.size() > sample; ++sample)
-      if (pts <= sample_table[sample].pts)
+    for (; num_samples > sample; ++sample)
+      if (pts <= get_sample_pts(sample))
         break;
 
     el.start_sample  = sample;
-    el.pts_offset    = ((int64_t)e_pts       * (int64_t)time_scale) / (int64_t)global_time_scale - (int64_t)sample_table[sample].pts;
+    el.pts_offset    = ((int64_t)e_pts       * (int64_t)time_scale) / (int64_t)global_time_scale - (int64_t)get_sample_pts(sample);
     pts             += ((int64_t)el.duration * (int64_t)time_scale) / (int64_t)global_time_scale;
     e_pts           += el.duration;
 
     // find end sample
-    for (; sample_table.size() > sample; ++sample)
-      if (pts <= sample_table[sample].pts)
+    for (; num_samples > sample; ++sample)
+      if (pts <= get_sample_pts(sample))
         break;
 
     el.frames  = sample - el.start_sample;
@@ -1757,68 +1864,61 @@ qtmp4_demuxer_c::update_editlist_table(int64_t global_time_scale) {
 
 void
 qtmp4_demuxer_c::build_index() {
-  if (sample_size != 0)
-    build_index_constant_sample_size_mode();
-  else
-    build_index_chunk_mode();
+  m_index.clear();
+  m_index_start       = 0;
+  m_num_index_entries = num_samples;
 }
 
-void
-qtmp4_demuxer_c::build_index_constant_sample_size_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
+uint64_t
+qtmp4_demuxer_c::get_num_index_entries()
+  const {
+  return m_num_index_entries;
+}
 
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < chunk_table.size(); ++frame_idx) {
-    uint64_t frame_size;
+/** \brief Returns the index entry for sample \c idx
 
-    if (1 != sample_size) {
-      frame_size = chunk_table[frame_idx].size * sample_size;
+   Entries before the current position are dropped. They're created
+   again from the tables if they're requested later on.
+*/
+qt_index_t const &
+qtmp4_demuxer_c::get_index_entry(uint64_t idx) {
+  assert(idx < m_num_index_entries);
 
-    } else {
-      frame_size = chunk_table[frame_idx].size;
-
-      if ('a' == type) {
-        auto sound_stsd_atom = reinterpret_cast<sound_v1_stsd_atom_t *>(stsd->get_buffer());
-        if (get_uint16_be(&sound_stsd_atom->v0.version) == 1) {
-          frame_size *= get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame);
-          frame_size /= get_uint32_be(&sound_stsd_atom->v1.samples_per_packet);
-        } else
-          frame_size  = frame_size * a_channels * get_uint16_be(&sound_stsd_atom->v0.sample_size) / 8;
-      }
-    }
+  uint64_t first_needed = std::min<uint64_t>(pos, idx);
 
-    bool is_keyframe = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
-    }
+  if ((idx < m_index_start) || ((m_index_start + m_index.size()) <= first_needed)) {
+    m_index.clear();
+    m_index_start = first_needed;
+  }
 
-    m_index.push_back(qt_index_t(chunk_table[frame_idx].pos, frame_size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
+  while (!m_index.empty() && (m_index_start < first_needed)) {
+    m_index.pop_front();
+    ++m_index_start;
   }
+
+  while ((m_index_start + m_index.size()) <= idx)
+    m_index.push_back(create_index_entry(m_index_start + m_index.size()));
+
+  return m_index[idx - m_index_start];
 }
 
-void
-qtmp4_demuxer_c::build_index_chunk_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
-
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < frame_indices.size(); ++frame_idx) {
-    int act_frame_idx = frame_indices[frame_idx];
-
-    bool is_keyframe  = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
-    }
+qt_index_t
+qtmp4_demuxer_c::create_index_entry(uint64_t frame) {
+  // The key frame table is sorted and contains 1-based sample numbers.
+  bool is_keyframe = keyframe_table.empty() || std::binary_search(keyframe_table.begin(), keyframe_table.end(), frame + 1);
+
+  uint64_t real_frame;
+  int64_t timecode_before_offset, next_timecode_before_offset;
+  int64_t timecode       = get_frame_timecode(frame, &real_frame, &timecode_before_offset);
+  int64_t frame_duration = avg_duration;
 
-    m_index.push_back(qt_index_t(sample_table[act_frame_idx].pos, sample_table[act_frame_idx].size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
+  if ((frame + 1) < m_num_index_entries) {
+    get_frame_timecode(frame + 1, nullptr, &next_timecode_before_offset);
+    if (next_timecode_before_offset > timecode_before_offset)
+      frame_duration = next_timecode_before_offset - timecode_before_offset;
   }
+
+  return qt_index_t(get_sample_pos(real_frame), get_sample_size(real_frame), timecode, frame_duration, is_keyframe);
 }
 
 bool
@@ -1828,8 +1928,8 @@ qtmp4_demuxer_c::read_first_bytes(memory_cptr &buf,
   size_t buf_pos = 0;
   size_t idx_pos = 0;
 
-  while ((0 < num_bytes) && (idx_pos < m_index.size())) {
-    qt_index_t &index          = m_index[idx_pos];
+  while ((0 < num_bytes) && (idx_pos < get_num_index_entries())) {
+    qt_index_t const &index    = get_index_entry(idx_pos);
     uint64_t num_bytes_to_read = std::min((int64_t)num_bytes, index.size);
 
     in->setFilePointer(index.file_pos);
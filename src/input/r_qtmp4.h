@@ -26,10 +26,14 @@
 struct qt_durmap_t {
   uint32_t number;
   uint32_t duration;
+  uint64_t first_sample;
+  uint64_t first_pts;
 
   qt_durmap_t():
     number(0),
-    duration(0) {
+    duration(0),
+    first_sample(0),
+    first_pts(0) {
   }
 };
 
@@ -79,25 +83,15 @@ struct qt_editlist_t {
   }
 };
 
-struct qt_sample_t {
-  uint64_t pts;
-  uint32_t size;
-  uint64_t pos;
-
-  qt_sample_t():
-    pts(0),
-    size(0),
-    pos(0) {
-  }
-};
-
 struct qt_frame_offset_t {
   uint32_t count;
   uint32_t offset;
+  uint64_t first_sample;
 
   qt_frame_offset_t():
     count(0),
-    offset(0) {
+    offset(0),
+    first_sample(0) {
   }
 };
 
@@ -129,20 +123,27 @@ struct qtmp4_demuxer_c {
 
   uint64_t duration;
 
-  std::vector<qt_sample_t> sample_table;
+  std::vector<uint32_t> sample_size_table;
+  uint64_t num_samples;
+  uint32_t fixed_sample_size;
   std::vector<qt_chunk_t> chunk_table;
   std::vector<qt_chunkmap_t> chunkmap_table;
   std::vector<qt_durmap_t> durmap_table;
   std::vector<uint32_t> keyframe_table;
   std::vector<qt_editlist_t> editlist_table;
   std::vector<qt_frame_offset_t> raw_frame_offset_table;
-  std::vector<int32_t> frame_offset_table;
+  uint64_t num_frame_offsets;
 
-  std::vector<int64_t> timecodes, durations, frame_indices;
+  // The index entries are created from the tables above while reading
+  // and only kept from the current position 'pos' onwards.
+  std::deque<qt_index_t> m_index;
+  uint64_t m_index_start, m_num_index_entries;
 
-  std::vector<qt_index_t> m_index;
+  int64_t min_timecode, max_timecode, avg_duration, timecode_offset;
+
+  uint64_t m_pos_cache_sample, m_pos_cache_pos;
+  size_t m_pos_cache_chunk;
 
-  int64_t min_timecode, max_timecode;
   double fps;
 
   esds_t esds;
@@ -178,8 +179,18 @@ struct qtmp4_demuxer_c {
     global_duration(0), //avg_duration(0),
     sample_size(0),
     duration(0),
+    num_samples(0),
+    fixed_sample_size(0),
+    num_frame_offsets(0),
+    m_index_start(0),
+    m_num_index_entries(0),
     min_timecode(0),
     max_timecode(0),
+    avg_duration(0),
+    timecode_offset(0),
+    m_pos_cache_sample(0),
+    m_pos_cache_pos(0),
+    m_pos_cache_chunk(std::numeric_limits<size_t>::max()),
     fps(0.0),
     esds_parsed(false),
     stsd_non_priv_struct_size{},
@@ -217,6 +228,13 @@ struct qtmp4_demuxer_c {
   void update_editlist_table(int64_t global_time_scale);
 
   void build_index();
+  uint64_t get_num_index_entries() const;
+  qt_index_t const &get_index_entry(uint64_t idx);
+
+  uint32_t get_sample_size(uint64_t sample) const;
+  uint64_t get_sample_pos(uint64_t sample);
+  uint64_t get_sample_pts(uint64_t sample) const;
+  int32_t get_frame_offset(uint64_t sample) const;
 
   bool read_first_bytes(memory_cptr &buf, int num_bytes, mm_io_cptr in);
 
@@ -239,8 +257,8 @@ struct qtmp4_demuxer_c {
   bool verify_mp4v_video_parameters();
 
 private:
-  void build_index_chunk_mode();
-  void build_index_constant_sample_size_mode();
+  qt_index_t create_index_entry(uint64_t frame);
+  int64_t get_frame_timecode(uint64_t frame, uint64_t *real_frame = nullptr, int64_t *timecode_before_offset = nullptr);
 
   bool parse_esds_atom(mm_mem_io_c &memio, int level);
   uint32_t read_esds_descr_len(mm_mem_io_c &memio);
@@ -295,7 +313,7 @@ private:
 
   unsigned int m_audio_encoder_delay_samples;
 
-  bool m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_interleaving;
+  bool m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_interleaving, m_debug_reads;
 
 public:
   qtmp4_reader_c(const track_info_c &ti, const mm_io_cptr &in);
@@ -350,6 +368,8 @@ protected:
   virtual void handle_edts_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
   virtual void handle_elst_atom(qtmp4_demuxer_cptr &new_dmx, qt_atom_t parent, int level);
 
+  virtual void process_sample(qtmp4_demuxer_cptr &dmx, memory_cptr const &buffer, size_t offset, bool copy_small_samples);
+
   virtual memory_cptr create_bitmap_info_header(qtmp4_demuxer_cptr &dmx, const char *fourcc, size_t extra_size = 0, const void *extra_data = nullptr);
 
   virtual void create_audio_packetizer_aac(qtmp4_demuxer_cptr &dmx);
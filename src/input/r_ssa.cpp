@@ -97,5 +97,5 @@ ssa_reader_c::identify() {
 
   size_t i;
   for (i = 0; i < g_attachments.size(); i++)
-    id_result_attachment(g_attachments[i].ui_id, g_attachments[i].mime_type, g_attachments[i].data->get_size(), g_attachments[i].name, g_attachments[i].description);
+    id_result_attachment(g_attachments[i].ui_id, g_attachments[i].mime_type, g_attachments[i].get_size(), g_attachments[i].name, g_attachments[i].description);
 }
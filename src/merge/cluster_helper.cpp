@@ -68,10 +68,23 @@ cluster_helper_c::cluster_helper_c()
   , m_debug_packets{  debugging_requested("cluster_helper|cluster_helper_packets")}
   , m_debug_duration{ debugging_requested("cluster_helper|cluster_helper_duration")}
   , m_debug_rendering{debugging_requested("cluster_helper|cluster_helper_rendering")}
+  , m_render_asynchronously{!debugging_requested("no_threaded_rendering")}
+  , m_renderer_busy{false}
+  , m_renderer_stop{false}
 {
 }
 
 cluster_helper_c::~cluster_helper_c() {
+  stop_renderer();
+  delete m_cluster;
+}
+
+cluster_rendering_job_t::~cluster_rendering_job_t() {
+  if (!m_cluster)
+    return;
+
+  // The blocks are owned by the render groups.
+  m_cluster->delete_non_blocks();
   delete m_cluster;
 }
 
@@ -325,7 +338,8 @@ cluster_helper_c::must_duration_be_set(render_groups_c *rg,
 
 int
 cluster_helper_c::render() {
-  std::vector<render_groups_cptr> render_groups;
+  cluster_rendering_job_cptr job(new cluster_rendering_job_t);
+  auto &render_groups     = job->m_render_groups;
 
   bool use_simpleblock    = !hack_engaged(ENGAGE_NO_SIMPLE_BLOCKS);
 
@@ -474,7 +488,7 @@ cluster_helper_c::render() {
               && (   (0 > source->get_last_cue_timecode())
                   || ((pack->assigned_timecode - source->get_last_cue_timecode()) >= 2000000000)))) {
 
-        g_kax_cues->AddBlockBlob(*new_block_group);
+        job->m_cue_blobs.push_back(new_block_group);
         source->set_last_cue_timecode(pack->assigned_timecode);
 
         m_num_cue_elements++;
@@ -495,13 +509,21 @@ cluster_helper_c::render() {
       m_cluster->set_min_timecode(min_cl_timecode - timecode_offset);
       m_cluster->set_max_timecode(max_cl_timecode - timecode_offset);
 
-      m_cluster->Render(*m_out, *g_kax_cues);
-      m_bytes_in_file += m_cluster->ElementSize();
+      m_previous_cluster_tc = m_cluster->GlobalTimecode();
 
-      if (g_kax_sh_cues)
-        g_kax_sh_cues->IndexThis(*m_cluster, *g_kax_segment);
+      // The job takes over the cluster and the packets. A new cluster
+      // is created by prepare_new_cluster().
+      job->m_cluster = m_cluster;
+      job->m_packets.swap(m_packets);
+      m_cluster      = nullptr;
+
+      // Splitting needs the number of bytes written so far for its
+      // decisions. Render synchronously in that case.
+      if (m_render_asynchronously && !splitting())
+        queue_rendering_job(job);
+      else
+        render_cluster(*job);
 
-      m_previous_cluster_tc = m_cluster->GlobalTimecode();
     } else
       m_previous_cluster_tc = -1;
   }
@@ -509,11 +531,113 @@ cluster_helper_c::render() {
   m_min_timecode_in_cluster = -1;
   m_max_timecode_in_cluster = -1;
 
-  m_cluster->delete_non_blocks();
+  if (m_cluster)
+    m_cluster->delete_non_blocks();
 
   return 1;
 }
 
+void
+cluster_helper_c::render_cluster(cluster_rendering_job_t &job) {
+  for (auto blob : job.m_cue_blobs)
+    g_kax_cues->AddBlockBlob(*blob);
+
+  job.m_cluster->Render(*m_out, *g_kax_cues);
+  m_bytes_in_file += job.m_cluster->ElementSize();
+
+  if (g_kax_sh_cues)
+    g_kax_sh_cues->IndexThis(*job.m_cluster, *g_kax_segment);
+}
+
+void
+cluster_helper_c::queue_rendering_job(cluster_rendering_job_cptr const &job) {
+  std::unique_lock<std::mutex> lock(m_renderer_mutex);
+
+  if (!m_renderer.joinable())
+    m_renderer = std::thread(&cluster_helper_c::run_renderer, this);
+
+  // Limit the number of finished clusters kept in memory.
+  m_renderer_cond.wait(lock, [this]() { return (m_rendering_jobs.size() < 2) || m_renderer_exception; });
+
+  if (m_renderer_exception) {
+    lock.unlock();
+    rethrow_worker_exception(m_renderer_exception);
+  }
+
+  m_rendering_jobs.push_back(job);
+  m_renderer_cond.notify_all();
+}
+
+/** \brief Wait until all queued clusters have been written
+
+   Must be called before anything else is written to the output file
+   or before the cues or the seek head are accessed.
+*/
+void
+cluster_helper_c::wait_for_rendered_clusters() {
+  std::unique_lock<std::mutex> lock(m_renderer_mutex);
+
+  m_renderer_cond.wait(lock, [this]() { return m_rendering_jobs.empty() && !m_renderer_busy; });
+
+  if (m_renderer_exception) {
+    lock.unlock();
+    rethrow_worker_exception(m_renderer_exception);
+  }
+}
+
+void
+cluster_helper_c::stop_renderer() {
+  if (!m_renderer.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_renderer_mutex);
+    m_renderer_stop = true;
+    m_renderer_cond.notify_all();
+  }
+
+  m_renderer.join();
+}
+
+void
+cluster_helper_c::run_renderer() {
+  std::unique_lock<std::mutex> lock(m_renderer_mutex);
+
+  while (true) {
+    m_renderer_cond.wait(lock, [this]() { return !m_rendering_jobs.empty() || m_renderer_stop; });
+
+    if (m_rendering_jobs.empty())
+      return;
+
+    auto job        = m_rendering_jobs.front();
+    bool failed     = !!m_renderer_exception;
+    m_renderer_busy = true;
+    m_rendering_jobs.pop_front();
+
+    lock.unlock();
+
+    // After an error the remaining jobs are only discarded. The
+    // exception is re-thrown in the main thread.
+    std::exception_ptr exception;
+    if (!failed) {
+      try {
+        render_cluster(*job);
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    }
+
+    job.reset();
+
+    lock.lock();
+
+    if (exception)
+      m_renderer_exception = exception;
+    m_renderer_busy = false;
+    m_renderer_cond.notify_all();
+  }
+}
+
 int64_t
 cluster_helper_c::get_duration() {
   mxdebug_if(m_debug_duration,
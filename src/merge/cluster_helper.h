@@ -16,6 +16,12 @@
 
 #include "common/common_pch.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include <matroska/KaxBlock.h>
 #include <matroska/KaxCluster.h>
 
@@ -41,6 +47,24 @@ public:
 };
 typedef std::shared_ptr<render_groups_c> render_groups_cptr;
 
+// Everything that has to stay alive until a cluster has been written:
+// the cluster itself, the block groups/blobs it refers to and the
+// packets whose memory the blocks point to.
+struct cluster_rendering_job_t {
+  kax_cluster_c *m_cluster;
+  std::vector<packet_cptr> m_packets;
+  std::vector<render_groups_cptr> m_render_groups;
+  std::vector<kax_block_blob_c *> m_cue_blobs;
+
+  cluster_rendering_job_t()
+    : m_cluster(nullptr)
+  {
+  }
+
+  ~cluster_rendering_job_t();
+};
+typedef std::shared_ptr<cluster_rendering_job_t> cluster_rendering_job_cptr;
+
 struct split_point_t {
   enum split_point_type_e {
     SPT_DURATION,
@@ -96,6 +120,17 @@ private:
   bool m_discarding, m_splitting_and_processed_fully;
   bool m_debug_splitting, m_debug_packets, m_debug_duration, m_debug_rendering;
 
+  // Asynchronous rendering: finished clusters are serialized and
+  // written by a separate thread while the main loop fills the next
+  // one. Not used when splitting.
+  bool m_render_asynchronously;
+  std::thread m_renderer;
+  std::mutex m_renderer_mutex;
+  std::condition_variable m_renderer_cond;
+  std::deque<cluster_rendering_job_cptr> m_rendering_jobs;
+  bool m_renderer_busy, m_renderer_stop;
+  std::exception_ptr m_renderer_exception;
+
 public:
   cluster_helper_c();
   virtual ~cluster_helper_c();
@@ -135,6 +170,7 @@ public:
   }
 
   void discard_queued_packets();
+  void wait_for_rendered_clusters();
   bool is_splitting_and_processed_fully() const {
     return m_splitting_and_processed_fully;
   }
@@ -147,6 +183,11 @@ private:
   void render_after_adding_if_necessary(packet_cptr &packet);
   void split_if_necessary(packet_cptr &packet);
   void split(packet_cptr &packet);
+
+  void render_cluster(cluster_rendering_job_t &job);
+  void queue_rendering_job(cluster_rendering_job_cptr const &job);
+  void stop_renderer();
+  void run_renderer();
 };
 
 extern cluster_helper_c *g_cluster_helper;
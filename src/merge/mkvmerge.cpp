@@ -182,6 +182,10 @@ set_usage() {
   usage_text += Y("  -T, --no-track-tags      Don't copy tags for tracks from the source file.\n");
   usage_text += Y("  --no-global-tags         Don't keep global tags from the source file.\n");
   usage_text += Y("  --no-chapters            Don't keep chapters from the source file.\n");
+  usage_text += Y("  --start <timecode>       Only copy the content starting at the key frame\n"
+                  "                           at or before this timecode (Matroska only).\n");
+  usage_text += Y("  --stop <timecode>        Stop copying content at this timecode\n"
+                  "                           (Matroska only).\n");
   usage_text += Y("  -y, --sync <TID:d[,o[/p]]>\n"
                   "                           Synchronize, adjust the track's timecodes with\n"
                   "                           the id TID by 'd' ms.\n"
@@ -615,6 +619,28 @@ parse_arg_sync(std::string s,
   ti.m_timecode_syncs[id] = tcsync;
 }
 
+/** \brief Parse the \c --start and \c --stop arguments
+
+   Both take a timecode in the source file's time base. Only the
+   Matroska reader honors them.
+*/
+static void
+parse_arg_range(const std::string &opt,
+                const std::string &arg,
+                track_info_c &ti) {
+  int64_t timecode;
+  if (!parse_timecode(arg, timecode))
+    mxerror(boost::format(Y("Invalid time in '%1% %2%'. Additional error message: %3%.\n")) % opt % arg % timecode_parser_error);
+
+  if (opt == "--start")
+    ti.m_range_start = timecode;
+  else
+    ti.m_range_stop  = timecode;
+
+  if ((-1 != ti.m_range_start) && (-1 != ti.m_range_stop) && (ti.m_range_stop <= ti.m_range_start))
+    mxerror(boost::format(Y("Invalid time in '%1% %2%'. The stop time must be bigger than the start time.\n")) % opt % arg);
+}
+
 /** \brief Parse the \c --aspect-ratio argument
 
    The argument must have the form \c TID:w/h or \c TID:float, e.g. \c 0:16/9
@@ -1490,8 +1516,8 @@ parse_arg_attach_file(attachment_t &attachment,
     if (0 == io->get_size())
       mxerror(boost::format(Y("The size of attachment '%1%' is 0.\n")) % attachment.name);
 
-    attachment.data = memory_c::alloc(io->get_size());
-    io->read(attachment.data->get_buffer(), attachment.data->get_size());
+    // The content is read when the attachments are rendered.
+    attachment.size = io->get_size();
 
   } catch (...) {
     mxerror(boost::format(Y("The attachment '%1%' could not be read.\n")) % attachment.name);
@@ -1695,6 +1721,9 @@ handle_file_name_arg(const std::string &this_arg,
 
   get_file_type(file);
 
+  if (((-1 != ti->m_range_start) || (-1 != ti->m_range_stop)) && (FILE_TYPE_MATROSKA != file.type))
+    mxerror(boost::format(Y("The options '--start' and '--stop' are only supported for Matroska files, but '%1%' is not one.\n")) % file.name);
+
   if (FILE_TYPE_IS_UNKNOWN == file.type)
     mxerror(boost::format(Y("The file '%1%' has unknown type. Please have a look at the supported file types ('mkvmerge --list-types') and "
                             "contact the author Moritz Bunkus <moritz@bunkus.org> if your file type is supported but not recognized properly.\n")) % file.name);
@@ -2012,6 +2041,14 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-chapters")
       ti->m_no_chapters = true;
 
+    else if ((this_arg == "--start") || (this_arg == "--stop")) {
+      if (no_next_arg)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      parse_arg_range(this_arg, next_arg, *ti);
+      sit++;
+    }
+
     else if ((this_arg == "-M") || (this_arg == "--no-attachments"))
       ti->m_attach_mode_list.set_none();
 
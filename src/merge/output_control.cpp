@@ -30,7 +30,12 @@
 #include <windows.h>
 #endif
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <typeinfo>
 
 #include <ebml/EbmlHead.h>
@@ -58,11 +63,15 @@
 #include <matroska/KaxTrackVideo.h>
 #include <matroska/KaxVersion.h>
 
+#include "common/at_scope_exit.h"
+#include "common/bounded_queue.h"
 #include "common/chapters/chapters.h"
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
 #include "common/math.h"
+#include "common/mm_mmap_io.h"
+#include "common/mm_probe_buffer_io.h"
 #include "common/mm_read_buffer_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/formatting.h"
@@ -220,6 +229,74 @@ static generic_reader_c *s_display_reader = nullptr;
 
 static EbmlHead *s_head                   = nullptr;
 
+// Threaded reading: each source file is read by its own thread. The
+// packets are handed over to the main thread through one bounded
+// lock-free queue per packetizer.
+//
+// A reader thread holds its m_state_mutex while it calls into its
+// file's reader and packetizers. The main thread holds all of them
+// while it uses the packetizers' state, e.g. their track entries when
+// adding packets to clusters. Packetizers running on a reader thread
+// don't re-render headers themselves; the main thread does it for
+// them.
+struct threaded_packet_queue_t {
+  bounded_queue_c<packet_cptr> m_packets;
+  std::atomic<int64_t> m_num_bytes;
+  std::atomic<file_status_e> m_status;
+
+  threaded_packet_queue_t()
+    : m_packets(64)
+    , m_num_bytes(0)
+    , m_status(FILE_STATUS_MOREDATA)
+  {
+  }
+
+  bool is_full() const {
+    return m_packets.full() || (m_num_bytes >= 16 * 1024 * 1024);
+  }
+};
+typedef std::shared_ptr<threaded_packet_queue_t> threaded_packet_queue_cptr;
+
+struct reader_thread_t {
+  std::vector<size_t> m_packetizers;
+  std::mutex m_state_mutex;
+  std::thread m_thread;
+
+  ~reader_thread_t() {
+    // Only reached with a running thread if an error on the main
+    // thread exits the program while reading. The thread may be
+    // waiting for m_state_mutex, so it cannot be joined.
+    if (m_thread.joinable())
+      m_thread.detach();
+  }
+};
+typedef std::shared_ptr<reader_thread_t> reader_thread_cptr;
+
+static bool s_threaded_reading                  = false;
+static std::thread::id s_main_thread_id;
+static std::vector<threaded_packet_queue_cptr> s_packet_queues;
+static std::vector<reader_thread_cptr> s_reader_threads;
+static std::atomic<uint64_t> s_num_packets_consumed(0);
+static std::atomic<bool> s_stop_reader_threads(false), s_reader_failed(false);
+static std::atomic<bool> s_track_headers_changed(false), s_ebml_head_changed(false);
+
+// Only used for letting threads sleep until another thread has made
+// progress and for passing errors on to the main thread.
+static std::mutex s_wake_up_mutex;
+static std::condition_variable s_wake_up_cond;
+static std::atomic<unsigned int> s_num_sleeping_threads(0);
+static std::exception_ptr s_reader_exception;
+
+// Winner selection: packetizers holding a packet are kept in a
+// min-heap keyed on (assigned timecode, packetizer index). Only the
+// packetizers listed in s_packetizers_to_pull are asked for new
+// packets during the next iteration of the main loop.
+typedef std::pair<int64_t, size_t> winner_candidate_t;
+static std::priority_queue<winner_candidate_t, std::vector<winner_candidate_t>, std::greater<winner_candidate_t> > s_winner_candidates;
+static std::vector<size_t> s_packetizers_to_pull;
+static size_t s_num_known_packetizers       = 0;
+static bool s_pull_all_packetizers          = true;
+
 /** \brief Add a segment family UID to the list if it doesn't exist already.
 
   \param family This segment family element is converted to a 128 bit
@@ -315,14 +392,31 @@ file_names_to_paths(const std::vector<std::string> &file_names) {
 }
 
 static mm_io_cptr
-open_input_file(filelist_t &file) {
+open_input_file(filelist_t &file,
+                bool probing = false) {
+  size_t buffer_size = probing ? 1 << 17 : 1 << 22;
+
   try {
-    if (file.all_names.size() == 1)
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), 1 << 17));
+    if (file.all_names.size() == 1) {
+      // Readers that take their data from the file without copying it
+      // first (see mm_mmap_io_c::read_view()) get the whole file mapped
+      // if possible: the MP4 reader cuts its packets out of the mapping,
+      // and the MPEG TS reader parses the TS packets straight from it.
+      // All other readers copy the data anyway and profit more from the
+      // read-ahead buffer. Probing only reads a few small pieces, often
+      // all over the file, so reading ahead would only be wasted.
+      if ((FILE_TYPE_QTMP4 == file.type) || (FILE_TYPE_MPEG_TS == file.type)) {
+        try {
+          return mm_io_cptr(new mm_mmap_io_c(file.name));
+        } catch (mtx::mm_io::exception &) {
+        }
+      }
+
+      return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), buffer_size, true, !probing));
 
-    else {
+    } else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_multi_file_io_c(paths, file.name), 1 << 17));
+      return mm_io_cptr(new mm_read_buffer_io_c(new mm_multi_file_io_c(paths, file.name), buffer_size, true, !probing));
     }
 
   } catch (...) {
@@ -335,12 +429,17 @@ open_input_file(filelist_t &file) {
 
    Opens the input file and calls the \c probe_file function for each known
    file reader class. Uses \c mm_text_io_c for subtitle probing.
+
+   All probes share a \c mm_probe_buffer_io_c so that the beginning of the
+   file is only read once no matter how often the probes seek back to it.
 */
 void
 get_file_type(filelist_t &file) {
-  mm_io_cptr af_io = open_input_file(file);
-  mm_io_c *io      = af_io.get();
-  int64_t size     = std::min(io->get_size(), static_cast<int64_t>(1 << 25));
+  mm_io_cptr af_io = open_input_file(file, true);
+  int64_t size     = std::min(af_io->get_size(), static_cast<int64_t>(1 << 25));
+
+  mm_probe_buffer_io_c probe_io(af_io.get(), size);
+  mm_io_c *io = &probe_io;
 
   file_type_e type = FILE_TYPE_IS_UNKNOWN;
   // File types that can be detected unambiguously but are not supported
@@ -452,7 +551,7 @@ get_file_type(filelist_t &file) {
     // All text file types (subtitles).
     mm_text_io_c *text_io = nullptr;
     try {
-      text_io = new mm_text_io_c(new mm_file_io_c(file.name));
+      text_io = new mm_text_io_c(io, false);
       size    = text_io->get_size();
     } catch (...) {
       mxerror(boost::format(Y("The source file '%1%' could not be opened successfully, or retrieving its size by seeking to the end did not work.\n")) % file.name);
@@ -566,7 +665,7 @@ add_attachment(attachment_t attachment) {
           ||
           (   (ex_attachment.name             == attachment.name)
            && (ex_attachment.description      == attachment.description)
-           && (ex_attachment.data->get_size() == attachment.data->get_size())))
+           && (ex_attachment.get_size()       == attachment.get_size())))
         return attachment.id;
 
     add_unique_number(attachment.id, UNIQUE_ATTACHMENT_IDS);
@@ -660,8 +759,27 @@ render_ebml_head(mm_io_c *out) {
   s_head->Render(*out, true);
 }
 
+/** \brief Defers re-rendering a header if called on a reader thread
+
+   The main thread re-renders the header once the reader threads
+   cannot modify their packetizers' state.
+*/
+static bool
+defer_rerendering(std::atomic<bool> &header_changed) {
+  if (!s_threaded_reading || (std::this_thread::get_id() == s_main_thread_id))
+    return false;
+
+  header_changed = true;
+  return true;
+}
+
 void
 rerender_ebml_head() {
+  if (defer_rerendering(s_ebml_head_changed))
+    return;
+
+  g_cluster_helper->wait_for_rendered_clusters();
+
   mm_io_c *out = g_cluster_helper->get_output();
   out->save_pos(s_head->GetElementPosition());
   render_ebml_head(out);
@@ -849,6 +967,11 @@ render_headers(mm_io_c *out) {
 */
 void
 rerender_track_headers() {
+  if (defer_rerendering(s_track_headers_changed))
+    return;
+
+  g_cluster_helper->wait_for_rendered_clusters();
+
   g_kax_tracks->UpdateSize(false);
 
   int64_t new_void_size = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->GetSize()
@@ -865,6 +988,75 @@ rerender_track_headers() {
   s_out->restore_pos();
 }
 
+/** \brief An attachment's file data element that streams its content
+
+   The content isn't copied into the element. It's read in chunks
+   from the attachment's source while the element is rendered. The
+   element keeps its own copy of the attachment's description as it
+   lives as long as \c s_kax_as, not as long as \c g_attachments.
+
+   Files attached with \c --attach-file are opened again each time the
+   element is rendered. Their size must not have changed since the
+   space for the attachments was calculated.
+*/
+class attachment_file_data_c: public KaxFileData {
+protected:
+  attachment_t m_attachment;
+
+public:
+  attachment_file_data_c(attachment_t const &attachment)
+    : m_attachment(attachment)
+  {
+    SetSize_(attachment.get_size());
+    SetValueIsSet();
+  }
+
+  virtual filepos_t RenderData(IOCallback &output, bool, bool) {
+    if (m_attachment.data) {
+      output.writeFully(m_attachment.data->get_buffer(), m_attachment.data->get_size());
+      return GetSize();
+    }
+
+    mm_io_cptr in;
+    bool restore = !!m_attachment.source;
+
+    try {
+      if (restore) {
+        in = m_attachment.source;
+        in->save_pos(m_attachment.source_position);
+      } else {
+        in = mm_file_io_c::open(m_attachment.name);
+
+        uint64_t current_size = in->get_size();
+        if (current_size != GetSize())
+          mxerror(boost::format(Y("The size of the attachment '%1%' has changed from %2% to %3% bytes while mkvmerge was running.\n")) % m_attachment.name % GetSize() % current_size);
+      }
+
+      at_scope_exit_c restore_pos([&]() {
+          if (restore)
+            in->restore_pos();
+        });
+
+      memory_cptr buffer = memory_c::alloc(std::min<uint64_t>(GetSize(), 1024 * 1024));
+      uint64_t remaining = GetSize();
+
+      while (0 < remaining) {
+        size_t chunk_size = std::min<uint64_t>(remaining, buffer->get_size());
+        if (in->read(buffer->get_buffer(), chunk_size) != chunk_size)
+          throw mtx::mm_io::end_of_file_x();
+
+        output.writeFully(buffer->get_buffer(), chunk_size);
+        remaining -= chunk_size;
+      }
+
+    } catch (mtx::mm_io::exception &) {
+      mxerror(boost::format(Y("The attachment '%1%' could not be read.\n")) % m_attachment.name);
+    }
+
+    return GetSize();
+  }
+};
+
 /** \brief Render all attachments into the output file at the current position
 
    This function also makes sure that no duplicates are output. This might
@@ -902,7 +1094,16 @@ render_attachments(IOCallback *out) {
       GetChildAs<KaxFileName, EbmlUnicodeString>(kax_a) = cstrutf8_to_UTFstring(name);
       GetChildAs<KaxFileUID, EbmlUInteger>(kax_a)       = attch.id;
 
-      GetChild<KaxFileData>(*kax_a).CopyBuffer(attch.data->get_buffer(), attch.data->get_size());
+      // Replace the empty file data element created for the mandatory
+      // elements with one streaming the attachment's content.
+      size_t idx;
+      for (idx = 0; kax_a->ListSize() > idx; ++idx)
+        if (dynamic_cast<KaxFileData *>((*kax_a)[idx])) {
+          delete (*kax_a)[idx];
+          kax_a->Remove(idx);
+          kax_a->InsertElement(*new attachment_file_data_c(attch), idx);
+          break;
+        }
     }
   }
 
@@ -1302,9 +1503,9 @@ create_readers() {
 
     // Calculate the size of all attachments for split control.
     for (auto &att : g_attachments) {
-      g_attachment_sizes_first += att.data->get_size();
+      g_attachment_sizes_first += att.get_size();
       if (att.to_all_files)
-        g_attachment_sizes_others += att.data->get_size();
+        g_attachment_sizes_others += att.get_size();
     }
 
     calc_max_chapter_size();
@@ -1483,7 +1684,7 @@ create_next_output_file() {
 
   // Open the output file.
   try {
-    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
+    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024, 2) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
   } catch (...) {
     mxerror(boost::format(Y("The output file '%1%' could not be opened for writing (%2%).\n")) % this_outfile % strerror(errno));
   }
@@ -1512,6 +1713,8 @@ create_next_output_file() {
 */
 int64_t
 finish_file(bool last_file) {
+  g_cluster_helper->wait_for_rendered_clusters();
+
   bool do_output = verbose && !dynamic_cast<mm_null_io_c *>(s_out.get());
   if (do_output)
     mxinfo("\n");
@@ -1687,6 +1890,14 @@ finish_file(bool last_file) {
   if (g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
     g_kax_segment->OverwriteHead(*s_out);
 
+  // Close explicitly so that errors writing the last buffered data are
+  // reported instead of being lost in the destructor.
+  try {
+    s_out->close();
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("Writing to the output file failed: %1%\n")) % ex.error());
+  }
+
   s_out.reset();
 
   // The tracks element must not be deleted.
@@ -1879,6 +2090,9 @@ append_track(packetizer_t &ptzr,
   }
 
   ptzr.deferred = false;
+
+  // The packetizer has been replaced; rescan all of them.
+  s_pull_all_packetizers = true;
 }
 
 /** \brief Decide if packetizers have to be appended
@@ -1945,14 +2159,76 @@ establish_deferred_connections(filelist_t &file) {
   // \todo Select a new file that the subs will defer to.
 }
 
+static void
+check_packetizer_finished(packetizer_t &ptzr) {
+  // Has this packetizer changed its status from "data available" to
+  // "file done" during this loop? If so then decrease the number of
+  // unfinished packetizers in the corresponding file structure.
+  if (   (FILE_STATUS_DONE_AND_DRY != ptzr.status)
+      || (ptzr.old_status == ptzr.status))
+    return;
+
+  filelist_t &file = g_files[ptzr.file];
+  file.num_unfinished_packetizers--;
+
+  // If all packetizers for a file have finished then establish the
+  // deferred connections.
+  if ((0 >= file.num_unfinished_packetizers) && (0 < file.old_num_unfinished_packetizers)) {
+    establish_deferred_connections(file);
+    file.done = true;
+  }
+  file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
+}
+
+/** \brief Determine which packetizers have to be asked for packets
+
+   Normally only the packetizer whose packet has just been muxed and
+   packetizers that had no packet to offer during the last iteration
+   are pulled. After appending or if new packetizers have been added
+   all of them are pulled again and the winner heap is rebuilt.
+*/
+static void
+prepare_packetizers_to_pull() {
+  if (!s_pull_all_packetizers && (g_packetizers.size() == s_num_known_packetizers))
+    return;
+
+  s_pull_all_packetizers  = false;
+  s_num_known_packetizers = g_packetizers.size();
+  s_winner_candidates     = decltype(s_winner_candidates)();
+
+  s_packetizers_to_pull.resize(g_packetizers.size());
+  for (size_t idx = 0; g_packetizers.size() > idx; ++idx)
+    s_packetizers_to_pull[idx] = idx;
+}
+
+static void
+remember_pulled_packetizer(size_t idx) {
+  auto &ptzr = g_packetizers[idx];
+
+  if (ptzr.pack)
+    s_winner_candidates.push(winner_candidate_t{ ptzr.pack->assigned_timecode, idx });
+
+  else if (FILE_STATUS_DONE_AND_DRY != ptzr.status)
+    s_packetizers_to_pull.push_back(idx);
+}
+
 static void
 pull_packetizers_for_packets() {
-  for (auto &ptzr : g_packetizers) {
+  prepare_packetizers_to_pull();
+
+  std::vector<size_t> to_pull;
+  to_pull.swap(s_packetizers_to_pull);
+
+  for (auto idx : to_pull) {
+    auto &ptzr = g_packetizers[idx];
+
     if (FILE_STATUS_HOLDING == ptzr.status)
       ptzr.status = FILE_STATUS_MOREDATA;
 
     ptzr.old_status = ptzr.status;
 
+    ptzr.packetizer->add_compressed_packets(false);
+
     while (   !ptzr.pack
            && (FILE_STATUS_MOREDATA == ptzr.status)
            && !ptzr.packetizer->packet_available())
@@ -1968,41 +2244,313 @@ pull_packetizers_for_packets() {
     if (!ptzr.pack && (FILE_STATUS_DONE == ptzr.status))
       ptzr.status = FILE_STATUS_DONE_AND_DRY;
 
-    // Has this packetizer changed its status from "data available" to
-    // "file done" during this loop? If so then decrease the number of
-    // unfinished packetizers in the corresponding file structure.
-    if (   (FILE_STATUS_DONE_AND_DRY == ptzr.status)
-        && (ptzr.old_status != ptzr.status)) {
-      filelist_t &file = g_files[ptzr.file];
-      file.num_unfinished_packetizers--;
-
-      // If all packetizers for a file have finished then establish the
-      // deferred connections.
-      if ((0 >= file.num_unfinished_packetizers) && (0 < file.old_num_unfinished_packetizers)) {
-        establish_deferred_connections(file);
-        file.done = true;
+    check_packetizer_finished(ptzr);
+    remember_pulled_packetizer(idx);
+  }
+}
+
+/** \brief Wakes up threads sleeping in \c sleep_until()
+
+   Must be called after changing anything a sleeping thread may be
+   waiting for.
+*/
+static void
+wake_up_sleeping_threads() {
+  // Pairs with the fence in sleep_until(): either the sleeping thread
+  // sees the change or this thread sees the sleeping thread.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!s_num_sleeping_threads)
+    return;
+
+  std::lock_guard<std::mutex> lock(s_wake_up_mutex);
+  s_wake_up_cond.notify_all();
+}
+
+/** \brief Lets the current thread sleep until \c condition is met
+
+   \c condition is evaluated with \c s_wake_up_mutex being held.
+*/
+static void
+sleep_until(std::function<bool()> const &condition) {
+  std::unique_lock<std::mutex> lock(s_wake_up_mutex);
+
+  ++s_num_sleeping_threads;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  s_wake_up_cond.wait(lock, condition);
+
+  --s_num_sleeping_threads;
+}
+
+/** \brief Body of a reader thread
+
+   Does the same as \c pull_packetizers_for_packets() for all
+   packetizers of one source file but moves the packets into the
+   packetizers' queues instead of handing them to the main thread
+   directly. Sleeps if no queue can take another packet or if the
+   reader refuses to read more data for now.
+*/
+static void
+read_in_reader_thread(reader_thread_t &thread) {
+  while (!s_stop_reader_threads) {
+    uint64_t num_packets_consumed = s_num_packets_consumed;
+    bool active = false, progress = false;
+
+    for (auto idx : thread.m_packetizers) {
+      auto &queue              = *s_packet_queues[idx];
+      auto ptzr                = g_packetizers[idx].packetizer;
+      file_status_e old_status = queue.m_status;
+
+      if (FILE_STATUS_DONE_AND_DRY == old_status)
+        continue;
+
+      active = true;
+      if (queue.is_full())
+        continue;
+
+      file_status_e status = FILE_STATUS_HOLDING == old_status ? FILE_STATUS_MOREDATA : old_status;
+      packet_cptr pack;
+
+      {
+        std::lock_guard<std::mutex> lock(thread.m_state_mutex);
+
+        bool was_reading = FILE_STATUS_MOREDATA == status;
+
+        ptzr->add_compressed_packets(false);
+
+        while (   (FILE_STATUS_MOREDATA == status)
+               && !ptzr->packet_available())
+          status = ptzr->read();
+
+        if ((FILE_STATUS_MOREDATA != status) && was_reading)
+          ptzr->force_duration_on_last_packet();
+
+        pack = ptzr->get_packet();
       }
-      file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
+
+      if (!pack && (FILE_STATUS_DONE == status))
+        status = FILE_STATUS_DONE_AND_DRY;
+
+      // The queue cannot have become full meanwhile as only the main
+      // thread removes packets from it. The status must be updated
+      // after the packet has been queued; see take_queued_packet().
+      if (pack) {
+        queue.m_num_bytes += pack->data->get_size();
+        queue.m_packets.push(pack);
+      }
+
+      progress       = progress || pack || (old_status != status);
+      queue.m_status = status;
+
+      wake_up_sleeping_threads();
     }
+
+    if (!active)
+      return;
+
+    // All queues are full or the reader is holding: wait for the main
+    // thread to consume packets.
+    if (!progress)
+      sleep_until([num_packets_consumed]() { return (s_num_packets_consumed != num_packets_consumed) || s_stop_reader_threads; });
   }
 }
 
-static packetizer_t *
-select_winning_packetizer() {
-  packetizer_t *winner = nullptr;
+/** \brief Runs a reader thread
 
-  for (auto &ptzr : g_packetizers) {
-    if (!ptzr.pack)
+   Errors, including those reported with mxerror(), end the thread.
+   They are passed on to the main thread which stops all other reader
+   threads before reporting them.
+*/
+static void
+run_reader_thread(reader_thread_t &thread) {
+  try {
+    read_in_reader_thread(thread);
+
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(s_wake_up_mutex);
+      if (!s_reader_exception)
+        s_reader_exception = std::current_exception();
+    }
+
+    s_reader_failed = true;
+    wake_up_sleeping_threads();
+  }
+}
+
+static bool
+can_read_threaded() {
+  // Threaded reading is experimental and must be enabled explicitly.
+  // Appending and splitting modify the packetizers and the output
+  // file from the main thread while muxing.
+  return hack_engaged(ENGAGE_THREADED_READING)
+      && !s_appending_files
+      && !g_cluster_helper->splitting();
+}
+
+static void
+start_reader_threads() {
+  s_packet_queues.clear();
+  s_reader_threads.clear();
+
+  for (size_t idx = 0; g_packetizers.size() > idx; ++idx)
+    s_packet_queues.push_back(threaded_packet_queue_cptr(new threaded_packet_queue_t));
+
+  for (size_t idx = 0; g_files.size() > idx; ++idx)
+    s_reader_threads.push_back(reader_thread_cptr(new reader_thread_t));
+
+  for (size_t idx = 0; g_packetizers.size() > idx; ++idx)
+    s_reader_threads[g_packetizers[idx].file]->m_packetizers.push_back(idx);
+
+  s_threaded_reading      = true;
+  s_main_thread_id        = std::this_thread::get_id();
+  s_stop_reader_threads   = false;
+  s_reader_failed         = false;
+  s_reader_exception      = nullptr;
+  s_track_headers_changed = false;
+  s_ebml_head_changed     = false;
+
+  for (auto &thread : s_reader_threads)
+    if (!thread->m_packetizers.empty())
+      thread->m_thread = std::thread(run_reader_thread, std::ref(*thread));
+}
+
+/** \brief Re-renders the headers packetizers on reader threads changed
+
+   The reader threads must not be able to modify their packetizers'
+   state at the same time.
+*/
+static void
+rerender_changed_headers() {
+  if (s_track_headers_changed.exchange(false))
+    rerender_track_headers();
+
+  if (s_ebml_head_changed.exchange(false))
+    rerender_ebml_head();
+}
+
+/** \brief Keeps the reader threads from modifying their packetizers
+
+   Locks all reader threads' state mutexes, always in the same order.
+   Does nothing if threaded reading isn't active.
+*/
+class reader_threads_state_lock_c {
+public:
+  reader_threads_state_lock_c() {
+    if (s_threaded_reading)
+      for (auto &thread : s_reader_threads)
+        thread->m_state_mutex.lock();
+  }
+
+  ~reader_threads_state_lock_c() {
+    if (s_threaded_reading)
+      for (auto thread = s_reader_threads.rbegin(); s_reader_threads.rend() != thread; ++thread)
+        (*thread)->m_state_mutex.unlock();
+  }
+};
+
+/** \brief Stops all reader threads and joins them
+
+   Reports the error a reader thread may have run into afterwards so
+   that no reader thread is still running if reporting the error exits
+   the program.
+*/
+static void
+stop_reader_threads() {
+  s_stop_reader_threads = true;
+  wake_up_sleeping_threads();
+
+  for (auto &thread : s_reader_threads)
+    if (thread->m_thread.joinable())
+      thread->m_thread.join();
+
+  s_threaded_reading = false;
+
+  if (s_reader_exception)
+    rethrow_worker_exception(s_reader_exception);
+
+  rerender_changed_headers();
+}
+
+/** \brief Takes the next packet from a packetizer's queue
+
+   Returns \c false if the reader thread has neither produced a packet
+   nor determined that it cannot do so right now. A reader that's done
+   may still have packets to queue; it is only finished once it has
+   reported \c FILE_STATUS_DONE_AND_DRY.
+*/
+static bool
+take_queued_packet(threaded_packet_queue_t &queue,
+                   packetizer_t &ptzr) {
+  // The status must be read before trying to take a packet. A reader
+  // thread updates it only after queueing its last packet.
+  file_status_e status = queue.m_status;
+
+  if (queue.m_packets.pop(ptzr.pack)) {
+    queue.m_num_bytes -= ptzr.pack->data->get_size();
+    ++s_num_packets_consumed;
+    ptzr.status = FILE_STATUS_MOREDATA;
+
+    return true;
+  }
+
+  if ((FILE_STATUS_MOREDATA == status) || (FILE_STATUS_DONE == status))
+    return false;
+
+  ptzr.status = status;
+
+  return true;
+}
+
+static void
+pull_packetizers_for_packets_threaded() {
+  prepare_packetizers_to_pull();
+
+  std::vector<size_t> to_pull;
+  to_pull.swap(s_packetizers_to_pull);
+
+  for (auto idx : to_pull) {
+    auto &ptzr  = g_packetizers[idx];
+    auto &queue = *s_packet_queues[idx];
+
+    ptzr.old_status = ptzr.status;
+
+    if (ptzr.pack || (FILE_STATUS_DONE_AND_DRY == ptzr.status)) {
+      remember_pulled_packetizer(idx);
       continue;
+    }
+
+    if (!take_queued_packet(queue, ptzr))
+      sleep_until([&queue, &ptzr]() { return s_reader_failed || take_queued_packet(queue, ptzr); });
 
-    if (!winner || !winner->pack)
-      winner = &ptzr;
+    if (s_reader_failed)
+      stop_reader_threads();
 
-    else if (ptzr.pack && (ptzr.pack->assigned_timecode < winner->pack->assigned_timecode))
-      winner = &ptzr;
+    // Lets the reader thread continue if it waits for free space.
+    wake_up_sleeping_threads();
+
+    check_packetizer_finished(ptzr);
+    remember_pulled_packetizer(idx);
   }
+}
+
+/** \brief Take the packetizer with the lowest timecode off the heap
 
-  return winner;
+   Ties are resolved in favor of the packetizer with the lower index.
+   The winner is scheduled to be pulled again in the next iteration.
+*/
+static packetizer_t *
+select_winning_packetizer() {
+  if (s_winner_candidates.empty())
+    return nullptr;
+
+  auto idx = s_winner_candidates.top().second;
+  s_winner_candidates.pop();
+
+  // Keep the pull order identical to the order of g_packetizers.
+  s_packetizers_to_pull.insert(std::lower_bound(s_packetizers_to_pull.begin(), s_packetizers_to_pull.end(), idx), idx);
+
+  return &g_packetizers[idx];
 }
 
 static void
@@ -2021,13 +2569,19 @@ discard_queued_packets() {
 */
 void
 main_loop() {
+  if (can_read_threaded())
+    start_reader_threads();
+
   // Let's go!
   while (1) {
     debug_run_main_loop_hooks();
 
     // Step 1: Make sure a packet is available for each output
     // as long we haven't already processed the last one.
-    pull_packetizers_for_packets();
+    if (s_threaded_reading)
+      pull_packetizers_for_packets_threaded();
+    else
+      pull_packetizers_for_packets();
 
     // Step 2: Pick the packet with the lowest timecode and
     // stuff it into the Matroska file.
@@ -2041,7 +2595,11 @@ main_loop() {
 
       // Step 3: Add the winning packet to a cluster. Full clusters will be
       // rendered automatically.
-      g_cluster_helper->add_packet(pack);
+      {
+        reader_threads_state_lock_c lock;
+        rerender_changed_headers();
+        g_cluster_helper->add_packet(pack);
+      }
 
       winner->pack.reset();
 
@@ -2053,13 +2611,18 @@ main_loop() {
       }
 
       // display some progress information
-      if (1 <= verbose)
+      if (1 <= verbose) {
+        reader_threads_state_lock_c lock;
         display_progress();
+      }
 
     } else if (!appended_a_track) // exit if there are no more packets
       break;
   }
 
+  if (s_threaded_reading)
+    stop_reader_threads();
+
   // Render all remaining packets (if there are any).
   if (g_cluster_helper && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
@@ -115,21 +115,35 @@ struct attachment_t {
   std::string name, stored_name, mime_type, description;
   uint64_t id;
   bool to_all_files;
-  memory_cptr data;
   int64_t ui_id;
 
+  // The content is kept in memory only if it has been created in
+  // memory. Otherwise it is streamed from 'source' (e.g. the source
+  // Matroska file) starting at 'source_position', or from the file
+  // 'name' if there's no source, each time it is rendered.
+  memory_cptr data;
+  mm_io_cptr source;
+  uint64_t source_position, size;
+
   attachment_t() {
     clear();
   }
   void clear() {
-    name         = "";
-    stored_name  = "";
-    mime_type    = "";
-    description  = "";
-    id           = 0;
-    ui_id        = 0;
-    to_all_files = false;
+    name            = "";
+    stored_name     = "";
+    mime_type       = "";
+    description     = "";
+    id              = 0;
+    ui_id           = 0;
+    to_all_files    = false;
+    source_position = 0;
+    size            = 0;
     data.reset();
+    source.reset();
+  }
+
+  uint64_t get_size() const {
+    return data ? data->get_size() : size;
   }
 };
 
@@ -140,6 +140,16 @@ struct packet_t {
   ~packet_t() {
   }
 
+  // Packets are created and destroyed for each frame. Recycle them.
+  static void *operator new(size_t size) {
+    return mtx::mem::pool_alloc(mtx::mem::get_pool_block_size(size));
+  }
+
+  static void operator delete(void *p,
+                              size_t size) {
+    mtx::mem::pool_free(p, mtx::mem::get_pool_block_size(size));
+  }
+
   bool
   has_timecode()
     const {
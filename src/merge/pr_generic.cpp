@@ -15,6 +15,7 @@
 #include "common/common_pch.h"
 
 #include <algorithm>
+#include <thread>
 #include <typeinfo>
 
 #include <matroska/KaxContentEncoding.h>
@@ -31,6 +32,7 @@
 #include "common/math.h"
 #include "common/mm_multi_file_io.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 #include "common/unique_numbers.h"
 #include "common/xml/ebml_tags_converter.h"
 #include "merge/mkvmerge.h"
@@ -743,6 +745,11 @@ generic_packetizer_c::set_headers() {
 
     m_compressor = compressor_c::create(m_hcompression);
     m_compressor->set_track_headers(c_encoding);
+
+    if (   async_compressor_c::is_supported(m_hcompression)
+        && (1 < std::thread::hardware_concurrency())
+        && !debugging_requested("no_threaded_compression"))
+      m_async_compressor = async_compressor_cptr(new async_compressor_c(m_hcompression));
   }
 
   if (g_no_lacing)
@@ -780,6 +787,11 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
       && (pack->data_adds.size()  > static_cast<size_t>(m_htrack_max_add_block_ids)))
     pack->data_adds.resize(m_htrack_max_add_block_ids);
 
+  if (m_async_compressor) {
+    compress_packet_async(pack);
+    return;
+  }
+
   if (m_compressor) {
     try {
       pack->data = m_compressor->compress(pack->data);
@@ -792,6 +804,78 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
     }
   }
 
+  add_compressed_packet(pack);
+}
+
+/** \brief Hands a packet's data over to the compression threads
+
+   The packet is kept in \c m_pending_compressions until its data has
+   been compressed. Packets leave that queue in the order they've been
+   added in. If too many packets are waiting then the oldest one is
+   waited for so that a fast reader cannot queue unlimited amounts of
+   data.
+*/
+void
+generic_packetizer_c::compress_packet_async(packet_cptr &pack) {
+  pending_compression_t pending;
+
+  // The reader may re-use its buffers once add_packet() has returned.
+  pack->data->grab();
+  for (auto &data_add : pack->data_adds)
+    data_add->grab();
+
+  pending.m_packet = pack;
+  pending.m_data   = m_async_compressor->compress(pack->data);
+  for (auto &data_add : pack->data_adds)
+    pending.m_data_adds.push_back(m_async_compressor->compress(data_add));
+
+  m_pending_compressions.push_back(std::move(pending));
+
+  add_compressed_packets(m_pending_compressions.size() > (4 * thread_pool_c::global().get_num_threads()));
+}
+
+/** \brief Moves packets whose compression has finished on
+
+   Only packets at the front of \c m_pending_compressions are
+   considered in order to keep the packet order. With \c wait set the
+   oldest packet is waited for and all finished ones after it are
+   moved on as well.
+*/
+void
+generic_packetizer_c::add_compressed_packets(bool wait) {
+  while (!m_pending_compressions.empty()) {
+    pending_compression_t &pending = m_pending_compressions.front();
+
+    if (!wait && (std::future_status::ready != pending.m_data.wait_for(std::chrono::seconds(0))))
+      return;
+
+    wait             = false;
+    packet_cptr pack = pending.m_packet;
+
+    try {
+      pack->data = get_job_result(pending.m_data);
+      size_t i;
+      for (i = 0; pending.m_data_adds.size() > i; ++i)
+        pack->data_adds[i] = get_job_result(pending.m_data_adds[i]);
+
+    } catch (mtx::compression_x &e) {
+      mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+    }
+
+    m_pending_compressions.pop_front();
+
+    add_compressed_packet(pack);
+  }
+}
+
+void
+generic_packetizer_c::flush_compressed_packets() {
+  while (!m_pending_compressions.empty())
+    add_compressed_packets(true);
+}
+
+void
+generic_packetizer_c::add_compressed_packet(packet_cptr &pack) {
   pack->data->grab();
   for (auto &data_add : pack->data_adds)
     data_add->grab();
@@ -968,26 +1052,8 @@ generic_packetizer_c::apply_factory_short_queueing(packet_cptr_di &p_start) {
   }
 }
 
-struct packet_sorter_t {
-  int m_index;
-  static std::deque<packet_cptr> *m_packet_queue;
-
-  packet_sorter_t(int index)
-    : m_index(index)
-  {
-  }
-
-  bool operator <(const packet_sorter_t &cmp) const {
-    return (*m_packet_queue)[m_index]->timecode < (*m_packet_queue)[cmp.m_index]->timecode;
-  }
-};
-
-std::deque<packet_cptr> *packet_sorter_t::m_packet_queue = nullptr;
-
 void
 generic_packetizer_c::apply_factory_full_queueing(packet_cptr_di &p_start) {
-  packet_sorter_t::m_packet_queue = &m_packet_queue;
-
   while (m_packet_queue.end() != p_start) {
     // Find the next I frame packet.
     packet_cptr_di p_end = p_start + 1;
@@ -1001,25 +1067,29 @@ generic_packetizer_c::apply_factory_full_queueing(packet_cptr_di &p_start) {
 
     // Now sort the frames by their timecode as the factory has to be
     // applied to the packets in the same order as they're timestamped.
-    std::vector<packet_sorter_t> sorter;
+    std::vector<size_t> sorter;
     bool needs_sorting        = false;
     int64_t previous_timecode = 0;
     size_t i                  = distance(m_packet_queue.begin(), p_start);
 
     packet_cptr_di p_current;
     for (p_current = p_start; p_current != p_end; ++i, ++p_current) {
-      sorter.push_back(packet_sorter_t(i));
+      sorter.push_back(i);
       if (m_packet_queue[i]->timecode < previous_timecode)
         needs_sorting = true;
       previous_timecode = m_packet_queue[i]->timecode;
     }
 
+    // The comparator refers to this packetizer's own queue as the
+    // reader threads apply the factories of several packetizers at the
+    // same time.
+    auto &queue = m_packet_queue;
     if (needs_sorting)
-      std::sort(sorter.begin(), sorter.end());
+      std::sort(sorter.begin(), sorter.end(), [&queue](size_t a, size_t b) { return queue[a]->timecode < queue[b]->timecode; });
 
     // Finally apply the factory.
     for (i = 0; sorter.size() > i; ++i)
-      apply_factory_once(m_packet_queue[sorter[i].m_index]);
+      apply_factory_once(m_packet_queue[sorter[i]]);
 
     p_start = p_end;
   }
@@ -1027,6 +1097,8 @@ generic_packetizer_c::apply_factory_full_queueing(packet_cptr_di &p_start) {
 
 void
 generic_packetizer_c::force_duration_on_last_packet() {
+  flush_compressed_packets();
+
   if (m_packet_queue.empty()) {
     mxverb_tid(3, m_ti.m_fname, m_ti.m_id, "force_duration_on_last_packet: packet queue is empty\n");
     return;
@@ -1106,6 +1178,7 @@ generic_packetizer_c::contains_gap() {
 void
 generic_packetizer_c::flush() {
   flush_impl();
+  flush_compressed_packets();
 
   m_has_been_flushed = true;
   apply_factory();
@@ -1123,6 +1196,7 @@ generic_packetizer_c::is_compatible_with(output_compatibility_e compatibility) {
 
 void
 generic_packetizer_c::discard_queued_packets() {
+  m_pending_compressions.clear();
   m_packet_queue.clear();
 }
 
@@ -1520,6 +1594,8 @@ track_info_c::track_info_c()
   , m_nalu_size_length(0)
   , m_no_chapters(false)
   , m_no_global_tags(false)
+  , m_range_start(-1)
+  , m_range_stop(-1)
   , m_avi_block_align(0)
   , m_avi_samples_per_sec(0)
   , m_avi_avg_bytes_per_sec(0)
@@ -1620,6 +1696,9 @@ track_info_c::operator =(const track_info_c &src) {
   m_no_chapters                = src.m_no_chapters;
   m_no_global_tags             = src.m_no_global_tags;
 
+  m_range_start                = src.m_range_start;
+  m_range_stop                 = src.m_range_stop;
+
   m_chapter_charset            = src.m_chapter_charset;
   m_chapter_language           = src.m_chapter_language;
 
@@ -299,6 +299,9 @@ public:
 
   bool m_no_chapters, m_no_global_tags;
 
+  // Time range to copy from a Matroska file (--start/--stop), -1 if unset
+  int64_t m_range_start, m_range_stop;
+
   // Some file formats can contain chapters, but for some the charset
   // cannot be identified unambiguously (*cough* OGM *cough*).
   std::string m_chapter_charset, m_chapter_language;
@@ -477,6 +480,13 @@ enum connection_result_e {
 
 typedef std::deque<packet_cptr>::iterator packet_cptr_di;
 
+// A packet whose data is being compressed on the thread pool.
+struct pending_compression_t {
+  packet_cptr m_packet;
+  std::future<memory_cptr> m_data;
+  std::vector<std::future<memory_cptr> > m_data_adds;
+};
+
 class generic_packetizer_c {
 protected:
   int m_num_packets;
@@ -508,6 +518,8 @@ protected:
 
   compression_method_e m_hcompression;
   compressor_ptr m_compressor;
+  async_compressor_cptr m_async_compressor;
+  std::deque<pending_compression_t> m_pending_compressions;
 
   timecode_factory_cptr m_timecode_factory;
   timecode_factory_application_e m_timecode_factory_application_mode;
@@ -540,6 +552,10 @@ public:
   virtual void add_packet(packet_cptr packet);
   virtual void add_packet2(packet_cptr pack);
   virtual void process_deferred_packets();
+  // Moves packets whose compression has finished on to the packet
+  // queue. Must be called before packet_available() is asked whether
+  // or not more data has to be read.
+  void add_compressed_packets(bool wait);
 
   virtual packet_cptr get_packet();
   inline bool packet_available() {
@@ -673,6 +689,10 @@ public:
 protected:
   virtual void flush_impl() {
   };
+
+  void compress_packet_async(packet_cptr &pack);
+  void add_compressed_packet(packet_cptr &pack);
+  void flush_compressed_packets();
 };
 
 extern std::vector<generic_packetizer_c *> ptzrs_in_header_order;
@@ -144,6 +144,8 @@ cli_options_dlg::init_cli_option_list() {
                                              "and all following non-sync frames into a single Matroska block. Without it each non-sync frame is put into its own Matroska block.")));
   all_cli_options.push_back(cli_option_t(wxU("--engage vobsub_subpic_stop_cmds"),
                                            Z("Causes mkvmerge to add 'stop display' commands to VobSub subtitle packets that do not contain a duration field.")));
+  all_cli_options.push_back(cli_option_t(wxU("--engage threaded_reading"),
+                                           Z("Causes mkvmerge to read each source file on its own thread. This is experimental and not used when appending or splitting.")));
   all_cli_options.push_back(cli_option_t(wxU("--engage cow"),
                                            Z("No help available.")));
 }
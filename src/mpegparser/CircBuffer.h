@@ -90,6 +90,18 @@ public:
     return read_ptr;
   }
 
+  //Returns a pointer to the byte at offset i and the number of bytes
+  //that follow it without wrapping around.
+  const binary* GetContiguous(uint32_t i, uint32_t& length){
+    uint32_t bbw = std::min(bytes_before_wrap_read(), bytes_in_buf);
+    if(i < bbw){
+      length = bbw - i;
+      return read_ptr + i;
+    }
+    length = bytes_in_buf - i;
+    return m_buf + (i - bbw);
+  }
+
   binary& operator[](unsigned int i){
     if(i > bytes_in_buf){
       return read_ptr[0];
@@ -22,6 +22,7 @@
 
 #include "common/common_pch.h"
 
+#include "common/start_code.h"
 #include "MPEGVideoBuffer.h"
 #include <cstring>
 #include <stddef.h>
@@ -45,21 +46,40 @@ int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
   if(window < 4) //Make sure we have enough bytes to search.
     return -1;
 
-  for(unsigned int i = startPos; i < (window - 3); i++){
-    CircBuffer& buf = *myBuffer;
-    binary a,b,c,d;
-    a = buf[i];
-    b = buf[i+1];
-    c = buf[i+2];
-    d = buf[i+3];
-    if((a == 0x00) && (b == 0x00) && (c == 0x01)){
-      switch(d){
+  CircBuffer& buf = *myBuffer;
+  uint32_t end = window - 3;
+  uint32_t i = startPos;
+
+  while(i < end){
+    //Search the part of the buffer that doesn't wrap around first.
+    uint32_t length;
+    const binary* segment = buf.GetContiguous(i, length);
+    uint32_t segmentEnd = i + length;
+    uint32_t searchLength = std::min<uint32_t>(length, end - i + 2);
+    const binary* found = mtx::start_code::find(segment, segment + searchLength);
+
+    if(found != (segment + searchLength)){
+      i += found - segment;
+      switch(buf[i+3]){
         case MPEG_VIDEO_SEQUENCE_START_CODE:
         case MPEG_VIDEO_GOP_START_CODE:
         case MPEG_VIDEO_PICTURE_START_CODE:
           return i;  //Return our position if we found
           //one of the codes we want
+      }
+      i++;
+      continue;
+    }
 
+    //Start codes spanning the wrap-around point
+    for(i = std::max(i, segmentEnd < 2 ? 0 : segmentEnd - 2); (i < segmentEnd) && (i < end); i++){
+      if((buf[i] == 0x00) && (buf[i+1] == 0x00) && (buf[i+2] == 0x01)){
+        switch(buf[i+3]){
+          case MPEG_VIDEO_SEQUENCE_START_CODE:
+          case MPEG_VIDEO_GOP_START_CODE:
+          case MPEG_VIDEO_PICTURE_START_CODE:
+            return i;
+        }
       }
     }
   }
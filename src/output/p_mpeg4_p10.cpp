@@ -161,11 +161,14 @@ mpeg4_p10_video_packetizer_c::change_nalu_size_len(packet_cptr packet) {
   }
 
   // Allocate memory if the new NALU size length is greater
-  // than the previous one. Otherwise reuse the existing memory.
+  // than the previous one. Otherwise reuse the existing memory unless
+  // it isn't owned by the packet (e.g. a view of a read-only file
+  // mapping).
   if (m_nalu_size_len_dst > m_nalu_size_len_src) {
     int new_size = size + nalu_sizes.size() * (m_nalu_size_len_dst - m_nalu_size_len_src);
     packet->data = memory_cptr(new memory_c((unsigned char *)safemalloc(new_size), new_size, true));
-  }
+  } else
+    packet->data->grab();
 
   // Copy the NALUs and write the new sized length field.
   unsigned char *dst = packet->data->get_buffer();
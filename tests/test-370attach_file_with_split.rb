@@ -0,0 +1,11 @@
+#!/usr/bin/ruby -w
+
+# T_370attach_file_with_split
+describe "mkvmerge / --attach-file / --split"
+
+test "data/avi/v-h264-aac.avi with attachments in the first and in all files" do
+  merge "--split 20s --attachment-mime-type text/plain --attach-file data/srt/vde.srt --attach-file-once data/text/cuewithtags2.cue data/avi/v-h264-aac.avi", :output => "#{tmp}-%02d"
+  result = [ hash_file("#{tmp}-01"), hash_file("#{tmp}-02") ].join('+')
+  unlink_tmp_files
+  result
+end
@@ -0,0 +1,25 @@
+#include "common/common_pch.h"
+
+#include "common/aac.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Aac, AdifHeader) {
+  // "ADIF", variable bit rate, one program config element (AAC LC,
+  // 48 kHz, one front channel pair element), byte alignment after 102
+  // bits, then an empty comment field.
+  unsigned char const data[] = { 0x41, 0x44, 0x49, 0x46, 0x10, 0x00, 0x00, 0x00, 0x09, 0x88, 0x00, 0x00, 0x40, 0x00, 0xff, 0xff };
+  aac_header_t header;
+
+  ASSERT_TRUE(parse_aac_adif_header(data, sizeof(data), &header));
+
+  EXPECT_EQ(48000, header.sample_rate);
+  EXPECT_EQ(2,     header.channels);
+  EXPECT_EQ(1,     header.profile);
+  EXPECT_EQ(112,   header.header_bit_size);
+  EXPECT_EQ(14,    header.header_byte_size);
+}
+
+}
@@ -0,0 +1,45 @@
+#include "common/common_pch.h"
+
+#include "common/compression.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(AsyncCompressor, SameResultsAsCompressor) {
+  auto sync_compressor  = compressor_c::create(COMPRESSION_ZLIB);
+  auto async_compressor = async_compressor_cptr(new async_compressor_c(COMPRESSION_ZLIB));
+
+  std::vector<memory_cptr> buffers;
+  std::vector<std::future<memory_cptr> > results;
+  unsigned int seed = 42;
+
+  for (size_t idx = 0; 100 > idx; ++idx) {
+    auto buffer = memory_c::alloc(1000 + idx * 37);
+    for (size_t pos = 0; buffer->get_size() > pos; ++pos) {
+      seed                       = seed * 1103515245 + 12345;
+      buffer->get_buffer()[pos] = (seed >> 16) % (idx % 10 + 2);
+    }
+
+    buffers.push_back(buffer);
+    results.push_back(async_compressor->compress(buffer));
+  }
+
+  // The jobs have to keep the compressor alive on their own.
+  async_compressor.reset();
+
+  for (size_t idx = 0; buffers.size() > idx; ++idx) {
+    auto compressed = results[idx].get();
+
+    EXPECT_TRUE(*sync_compressor->compress(buffers[idx]) == *compressed);
+    EXPECT_TRUE(*sync_compressor->decompress(compressed) == *buffers[idx]);
+  }
+}
+
+TEST(AsyncCompressor, IsSupported) {
+  EXPECT_TRUE(async_compressor_c::is_supported(COMPRESSION_ZLIB));
+  EXPECT_FALSE(async_compressor_c::is_supported(COMPRESSION_HEADER_REMOVAL));
+  EXPECT_FALSE(async_compressor_c::is_supported(COMPRESSION_NONE));
+}
+
+}
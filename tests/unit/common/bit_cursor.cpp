@@ -0,0 +1,122 @@
+#include "common/common_pch.h"
+
+#include "common/bit_cursor.h"
+#include "common/mpeg4_p10.h"
+
+#include <chrono>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(BitCursor, GetBits) {
+  unsigned char const data[] = { 0xa5, 0x0f, 0x81, 0xff };
+  bit_cursor_c bc(data, sizeof(data));
+
+  EXPECT_EQ(0x5u,    bc.get_bits(3));
+  EXPECT_EQ(0x0u,    bc.get_bits(2));
+  EXPECT_EQ(0x2u,    bc.peek_bits(2));
+  EXPECT_EQ(0xa1u,   bc.get_bits(8));
+  EXPECT_EQ(13,      bc.get_bit_position());
+  EXPECT_EQ(0xf03fu, bc.get_bits(16));
+
+  bc.skip_bits(2);
+  EXPECT_EQ(0x1u,    bc.get_bit());
+  EXPECT_FALSE(bc.eof());
+  EXPECT_THROW(bc.get_bits(2), mtx::mm_io::end_of_file_x);
+  EXPECT_TRUE(bc.eof());
+}
+
+TEST(BitCursor, SkipEmulationPrevention) {
+  std::vector<unsigned char> nalu;
+  unsigned int seed = 42;
+  while (nalu.size() < 1000) {
+    seed = seed * 1103515245 + 12345;
+    auto r = (seed >> 16) % 8;
+    nalu.push_back(r < 4 ? 0x00 : r < 6 ? 0x03 : (seed >> 8) & 0xff);
+  }
+
+  auto rbsp = memory_c::clone(&nalu[0], nalu.size());
+  mpeg4::p10::nalu_to_rbsp(rbsp);
+  ASSERT_LT(rbsp->get_size(), nalu.size());
+
+  bit_cursor_c expected(rbsp->get_buffer(), rbsp->get_size()), actual(&nalu[0], nalu.size(), true);
+
+  for (unsigned int n = 1; (expected.get_bit_position() + 32) < static_cast<int>(rbsp->get_size() * 8); n = n % 32 + 1) {
+    EXPECT_EQ(expected.get_bits(n), actual.get_bits(n));
+    EXPECT_EQ(expected.get_bit_position(), actual.get_bit_position());
+  }
+
+  actual.set_bit_position(100);
+  expected.set_bit_position(100);
+  EXPECT_EQ(expected.get_bits(32), actual.get_bits(32));
+
+  actual.skip_bits(3000);
+  expected.skip_bits(3000);
+  EXPECT_EQ(expected.get_bits(32), actual.get_bits(32));
+  EXPECT_EQ(expected.get_bit_position(), actual.get_bit_position());
+}
+
+TEST(BitCursor, ByteAlign) {
+  unsigned char const data[] = { 0xff, 0x5a, 0x00 };
+  bit_cursor_c bc(data, sizeof(data));
+
+  bc.byte_align();
+  EXPECT_EQ(0, bc.get_bit_position());
+
+  bc.skip_bits(3);
+  bc.byte_align();
+  EXPECT_EQ(8,     bc.get_bit_position());
+  EXPECT_EQ(0x5au, bc.get_bits(8));
+}
+
+TEST(BitCursor, Golomb) {
+  // ue(v) 0, 1, 2, 7, 254, then se(v) 1, -1, 2, then a value with
+  // more leading zeros than the fast path handles.
+  unsigned char const data[] = { 0xa6, 0x20, 0x07, 0xfa, 0x64, 0xc0, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00 };
+  bit_cursor_c bc(data, sizeof(data));
+
+  EXPECT_EQ(0u,   bc.get_unsigned_golomb());
+  EXPECT_EQ(1u,   bc.get_unsigned_golomb());
+  EXPECT_EQ(2u,   bc.get_unsigned_golomb());
+  EXPECT_EQ(7u,   bc.get_unsigned_golomb());
+  EXPECT_EQ(254u, bc.get_unsigned_golomb());
+  EXPECT_EQ(1,    bc.get_signed_golomb());
+  EXPECT_EQ(-1,   bc.get_signed_golomb());
+  EXPECT_EQ(2,    bc.get_signed_golomb());
+  EXPECT_EQ(40,   bc.get_bit_position());
+
+  bc.skip_bits(2);
+  EXPECT_EQ(0x1ffffffffull, bc.get_unsigned_golomb());
+  EXPECT_EQ(109,            bc.get_bit_position());
+  EXPECT_THROW(bc.get_unsigned_golomb(), mtx::mm_io::end_of_file_x);
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(BitCursor, DISABLED_Benchmark) {
+  std::vector<unsigned char> data(16 * 1024 * 1024);
+  unsigned int seed = 42;
+  for (auto &c : data) {
+    seed = seed * 1103515245 + 12345;
+    c    = seed >> 16;
+  }
+
+  uint64_t sum = 0;
+  auto start   = std::chrono::steady_clock::now();
+
+  bit_cursor_c bc(&data[0], data.size());
+  try {
+    for (unsigned int n = 1; ; n = n % 24 + 1) {
+      sum += bc.get_bits(n);
+      sum += bc.get_unsigned_golomb();
+      sum += bc.get_signed_golomb();
+    }
+  } catch (mtx::mm_io::end_of_file_x &) {
+  }
+
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  std::cout << (boost::format("bit_cursor_c: %1% MB in %2% ms (%3% MB/s, checksum %4%)\n")
+                % (data.size() >> 20) % (duration / 1000) % (data.size() / std::max<int64_t>(duration, 1)) % sum);
+}
+
+}
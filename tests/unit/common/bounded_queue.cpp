@@ -0,0 +1,76 @@
+#include "common/common_pch.h"
+
+#include <thread>
+
+#include "common/bounded_queue.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(BoundedQueue, PushAndPop) {
+  bounded_queue_c<int> queue(3);
+  int value = 0;
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop(value));
+
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  EXPECT_TRUE(queue.push(3));
+  EXPECT_TRUE(queue.full());
+  EXPECT_FALSE(queue.push(4));
+  EXPECT_EQ(3u, queue.size());
+
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(queue.push(4));
+
+  for (auto expected : std::vector<int>{ 2, 3, 4 }) {
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(expected, value);
+  }
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(BoundedQueue, ReleasesPoppedValues) {
+  bounded_queue_c<std::shared_ptr<int> > queue(2);
+  auto value = std::make_shared<int>(42);
+
+  EXPECT_TRUE(queue.push(value));
+  EXPECT_EQ(2, value.use_count());
+
+  std::shared_ptr<int> popped;
+  EXPECT_TRUE(queue.pop(popped));
+  popped.reset();
+  EXPECT_EQ(1, value.use_count());
+}
+
+TEST(BoundedQueue, OneProducerOneConsumer) {
+  bounded_queue_c<size_t> queue(16);
+  size_t const num_values = 100000;
+
+  std::thread producer([&queue, num_values]() {
+    for (size_t value = 0; num_values > value; ++value)
+      while (!queue.push(value))
+        std::this_thread::yield();
+  });
+
+  size_t expected = 0, value = 0;
+  while (num_values > expected) {
+    if (!queue.pop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    EXPECT_EQ(expected, value);
+    ++expected;
+  }
+
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}
@@ -0,0 +1,57 @@
+#include "common/common_pch.h"
+
+#include <deque>
+
+#include "common/byte_buffer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(ByteBuffer, KeepsDataInOrder) {
+  byte_buffer_c buffer(64);
+  std::deque<unsigned char> expected;
+  unsigned char value = 0;
+  unsigned int seed   = 42;
+
+  unsigned int round;
+  for (round = 0; 10000 > round; ++round) {
+    seed = seed * 1103515245 + 12345;
+
+    unsigned char chunk[100];
+    size_t to_add = (seed >> 16) % sizeof(chunk);
+    size_t idx;
+    for (idx = 0; to_add > idx; ++idx) {
+      chunk[idx] = value++;
+      expected.push_back(chunk[idx]);
+    }
+    buffer.add(chunk, to_add);
+
+    ASSERT_EQ(expected.size(), buffer.get_size());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), buffer.get_buffer()));
+
+    size_t to_remove = std::min<size_t>((seed >> 8) % (sizeof(chunk) + 10), buffer.get_size());
+    buffer.remove(to_remove);
+    expected.erase(expected.begin(), expected.begin() + to_remove);
+  }
+}
+
+TEST(ByteBuffer, MovesLessThanItConsumes) {
+  byte_buffer_c buffer(1024);
+  unsigned char chunk[100];
+  memset(chunk, 0, sizeof(chunk));
+
+  buffer.add(chunk, sizeof(chunk));
+
+  unsigned int round;
+  for (round = 0; 10000 > round; ++round) {
+    buffer.add(chunk, sizeof(chunk));
+    buffer.remove(sizeof(chunk));
+  }
+
+  EXPECT_EQ(10000u * sizeof(chunk), buffer.get_num_removed_bytes());
+  EXPECT_GE(buffer.get_num_removed_bytes(), buffer.get_num_moved_bytes());
+  EXPECT_EQ(sizeof(chunk) * buffer.get_num_moves(), buffer.get_num_moved_bytes());
+}
+
+}
@@ -0,0 +1,76 @@
+#include "common/common_pch.h"
+
+#include "common/content_decoder.h"
+#include "common/ebml.h"
+
+#include "tests/unit/init.h"
+
+namespace {
+
+void
+add_zlib_encoding(KaxTrackEntry &track_entry) {
+  GetChildAs<KaxTrackNumber, EbmlUInteger>(track_entry) = 1;
+
+  auto &encoding    = GetChild<KaxContentEncoding>(GetChild<KaxContentEncodings>(track_entry));
+  auto &compression = GetChild<KaxContentCompression>(encoding);
+
+  GetChildAs<KaxContentEncodingOrder, EbmlUInteger>(encoding)    = 0;
+  GetChildAs<KaxContentEncodingScope, EbmlUInteger>(encoding)    = CONTENT_ENCODING_SCOPE_BLOCK;
+  GetChildAs<KaxContentEncodingType,  EbmlUInteger>(encoding)    = 0;
+  GetChildAs<KaxContentCompAlgo,      EbmlUInteger>(compression) = 0;
+}
+
+std::vector<memory_cptr>
+create_buffers(size_t num_buffers) {
+  std::vector<memory_cptr> buffers;
+  unsigned int seed = 42;
+
+  for (size_t idx = 0; num_buffers > idx; ++idx) {
+    auto buffer = memory_c::alloc(1000 + idx * 37);
+    for (size_t pos = 0; buffer->get_size() > pos; ++pos) {
+      seed                       = seed * 1103515245 + 12345;
+      buffer->get_buffer()[pos] = (seed >> 16) % (idx % 10 + 2);
+    }
+
+    buffers.push_back(buffer);
+  }
+
+  return buffers;
+}
+
+TEST(ContentDecoder, ReverseMany) {
+  KaxTrackEntry track_entry;
+  add_zlib_encoding(track_entry);
+
+  content_decoder_c decoder(track_entry);
+  ASSERT_TRUE(decoder.is_ok());
+
+  auto compressor = compressor_c::create(COMPRESSION_ZLIB);
+  auto expected   = create_buffers(50);
+  std::vector<memory_cptr> buffers;
+  for (auto &buffer : expected)
+    buffers.push_back(compressor->compress(buffer));
+
+  decoder.reverse(buffers, CONTENT_ENCODING_SCOPE_BLOCK);
+
+  ASSERT_EQ(expected.size(), buffers.size());
+  for (size_t idx = 0; expected.size() > idx; ++idx)
+    EXPECT_TRUE(*expected[idx] == *buffers[idx]);
+}
+
+TEST(ContentDecoder, ReverseManyPassesErrorsOn) {
+  KaxTrackEntry track_entry;
+  add_zlib_encoding(track_entry);
+
+  content_decoder_c decoder(track_entry);
+  auto compressor = compressor_c::create(COMPRESSION_ZLIB);
+  std::vector<memory_cptr> buffers;
+  for (auto &buffer : create_buffers(10))
+    buffers.push_back(compressor->compress(buffer));
+
+  buffers[7] = memory_c::clone("not compressed", 14);
+
+  EXPECT_THROW(decoder.reverse(buffers, CONTENT_ENCODING_SCOPE_BLOCK), mtx::compression_x);
+}
+
+}
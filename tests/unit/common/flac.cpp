@@ -0,0 +1,88 @@
+#include "common/common_pch.h"
+
+#include "common/checksums.h"
+#include "common/flac.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+memory_cptr
+create_frame(unsigned int frame_number,
+             size_t payload_size,
+             unsigned int &seed) {
+  // Fixed block size of 4096 samples, 44.1 kHz, stereo, 16 bits
+  std::vector<unsigned char> frame{ 0xff, 0xf8, 0xc9, 0x18, static_cast<unsigned char>(frame_number) };
+  frame.push_back(crc_calc(crc_get_table(CRC_8_ATM), 0, &frame[0], frame.size()));
+
+  size_t idx;
+  for (idx = 0; payload_size > idx; ++idx) {
+    seed = seed * 1103515245 + 12345;
+    frame.push_back(seed >> 16);
+  }
+
+  // Something that looks like the start of a frame header.
+  frame[payload_size / 2]     = 0xff;
+  frame[payload_size / 2 + 1] = 0xf8;
+
+  uint32_t crc = crc_calc(crc_get_table(CRC_16_ANSI), 0, &frame[0], frame.size());
+  frame.push_back(crc & 0xff);
+  frame.push_back((crc >> 8) & 0xff);
+
+  return memory_c::clone(&frame[0], frame.size());
+}
+
+std::vector<memory_cptr>
+parse(std::vector<memory_cptr> const &frames,
+      std::string const &trailer,
+      size_t chunk_size) {
+  memory_cptr stream = memory_c::alloc(0);
+  for (auto &frame : frames)
+    stream->add(frame);
+  stream->add(reinterpret_cast<unsigned char const *>(trailer.c_str()), trailer.length());
+
+  flac_frame_parser_c parser;
+  size_t pos;
+  for (pos = 0; stream->get_size() > pos; pos += chunk_size)
+    parser.add_data(stream->get_buffer() + pos, std::min(chunk_size, stream->get_size() - pos));
+  parser.flush();
+
+  std::vector<memory_cptr> result;
+  while (parser.frame_available())
+    result.push_back(parser.get_next_frame());
+
+  return result;
+}
+
+TEST(FlacFrameParser, SplitsFrames) {
+  unsigned int seed = 42;
+  std::vector<memory_cptr> frames;
+  unsigned int idx;
+  for (idx = 0; 50 > idx; ++idx)
+    frames.push_back(create_frame(idx, 100 + idx * 97, seed));
+
+  for (auto chunk_size : std::vector<size_t>{ 1, 7, 4096, 1000000 }) {
+    auto result = parse(frames, "", chunk_size);
+    ASSERT_EQ(frames.size(), result.size());
+    for (idx = 0; frames.size() > idx; ++idx)
+      EXPECT_TRUE(*frames[idx] == *result[idx]);
+  }
+}
+
+TEST(FlacFrameParser, ToleratesBrokenFramesAndTrailingData) {
+  unsigned int seed = 23;
+  std::vector<memory_cptr> frames;
+  unsigned int idx;
+  for (idx = 0; 10 > idx; ++idx)
+    frames.push_back(create_frame(idx, 1000, seed));
+
+  // A wrong CRC-16 mustn't merge the frame with the following ones.
+  frames[4]->get_buffer()[500] ^= 0x55;
+
+  auto result = parse(frames, "TAG and some more bytes", 512);
+  ASSERT_EQ(frames.size(), result.size());
+  for (idx = 0; frames.size() > idx; ++idx)
+    EXPECT_TRUE(*frames[idx] == *result[idx]);
+}
+
+}
@@ -0,0 +1,165 @@
+#include "common/common_pch.h"
+
+#include "common/kax_cluster_scanner.h"
+#include "common/kax_file.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef std::vector<unsigned char> bytes_t;
+
+bytes_t
+element(uint32_t id,
+        bytes_t const &content) {
+  bytes_t result;
+  for (int shift = 24; 0 <= shift; shift -= 8)
+    if ((id >> shift) || !result.empty())
+      result.push_back((id >> shift) & 0xff);
+
+  auto size = content.size();
+  if (0x7f > size)
+    result.push_back(0x80 | size);
+  else {
+    result.push_back(0x40 | (size >> 8));
+    result.push_back(size & 0xff);
+  }
+
+  result.insert(result.end(), content.begin(), content.end());
+  return result;
+}
+
+bytes_t
+operator +(bytes_t a,
+           bytes_t const &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+bytes_t
+frame(size_t size,
+      unsigned char value) {
+  return bytes_t(size, value);
+}
+
+bytes_t
+block_header(unsigned int track_number,
+             int16_t timecode,
+             unsigned char flags) {
+  return bytes_t{ static_cast<unsigned char>(0x80 | track_number), static_cast<unsigned char>(timecode >> 8), static_cast<unsigned char>(timecode & 0xff), flags };
+}
+
+bytes_t
+create_cluster() {
+  auto content =
+      element(0xa3, block_header(1, 0, 0x80) + frame(20, 1))
+    // Xiph lacing: 3 frames of 300, 2 and 7 bytes
+    + element(0xa3, block_header(2, -5, 0x02) + bytes_t{ 2, 0xff, 45, 2 } + frame(300, 2) + frame(2, 3) + frame(7, 4))
+    // EBML lacing: 4 frames of 10, 12, 9 and 5 bytes
+    + element(0xa3, block_header(1, 12, 0x06 | 0x01) + bytes_t{ 3, 0x8a, 0xc1, 0xbc } + frame(10, 5) + frame(12, 6) + frame(9, 7) + frame(5, 8))
+    // fixed-size lacing: 3 frames of 4 bytes
+    + element(0xa3, block_header(3, 40, 0x04) + bytes_t{ 2 } + frame(12, 9))
+    + element(0xec, frame(5, 0))
+    + element(0xa0,
+                element(0xa1, block_header(2, 100, 0x00) + frame(30, 10))
+              + element(0x9b, bytes_t{ 0x01, 0x00 })
+              + element(0xfb, bytes_t{ 0xfe })
+              + element(0xfb, bytes_t{ 0x05 })
+              + element(0xa4, frame(3, 11))
+              + element(0x75a1,
+                          element(0xa6, element(0xee, bytes_t{ 1 }) + element(0xa5, frame(6, 12)))
+                        + element(0xa6, element(0xee, bytes_t{ 2 }))))
+    + element(0xa0, element(0x9b, bytes_t{ 0x05 }))
+    // The cluster timecode doesn't have to come first.
+    + element(0xe7, bytes_t{ 0x03, 0xe8 });
+
+  return element(0x1f43b675, content);
+}
+
+void
+expect_same_frames(kax_cluster_scanner_c const &expected,
+                   kax_cluster_scanner_c const &actual,
+                   kax_scanned_block_t const &expected_block,
+                   kax_scanned_block_t const &actual_block) {
+  ASSERT_EQ(expected_block.num_frames, actual_block.num_frames);
+  for (size_t idx = 0; expected_block.num_frames > idx; ++idx)
+    EXPECT_TRUE(*expected.get_frame(expected_block, idx) == *actual.get_frame(actual_block, idx));
+
+  ASSERT_EQ(expected_block.num_additions, actual_block.num_additions);
+  for (size_t idx = 0; expected_block.num_additions > idx; ++idx)
+    EXPECT_TRUE(*expected.get_addition(expected_block, idx) == *actual.get_addition(actual_block, idx));
+}
+
+TEST(KaxClusterScanner, SameResultsAsLibEbml) {
+  auto data = create_cluster();
+
+  mm_io_cptr in(new mm_mem_io_c(&data[0], data.size()));
+  kax_file_c file(in);
+  std::unique_ptr<KaxCluster> cluster(file.read_next_cluster());
+  ASSERT_TRUE(!!cluster);
+
+  kax_cluster_scanner_c expected, actual;
+  expected.set_timecode_scale(100000);
+  actual.set_timecode_scale(100000);
+
+  expected.import(*cluster);
+
+  in->setFilePointer(0);
+  ASSERT_TRUE(file.scan_next_cluster(actual));
+  EXPECT_EQ(data.size(), in->getFilePointer());
+
+  EXPECT_EQ(1000u, actual.get_timecode());
+  EXPECT_EQ(expected.get_timecode(), actual.get_timecode());
+
+  auto &expected_blocks = expected.get_blocks();
+  auto &actual_blocks   = actual.get_blocks();
+  ASSERT_EQ(6u, actual_blocks.size());
+  ASSERT_EQ(expected_blocks.size(), actual_blocks.size());
+
+  for (size_t idx = 0; expected_blocks.size() > idx; ++idx) {
+    auto &e = expected_blocks[idx], &a = actual_blocks[idx];
+
+    EXPECT_EQ(e.is_simple,      a.is_simple);
+    EXPECT_EQ(e.block_found,    a.block_found);
+    EXPECT_EQ(e.position,       a.position);
+
+    if (!e.block_found)
+      continue;
+
+    EXPECT_EQ(e.track_number,   a.track_number);
+    EXPECT_EQ(e.timecode,       a.timecode);
+    EXPECT_EQ(e.keyframe,       a.keyframe);
+    EXPECT_EQ(e.discardable,    a.discardable);
+    EXPECT_EQ(e.duration_found, a.duration_found);
+    EXPECT_EQ(e.duration,       a.duration);
+    EXPECT_EQ(e.bref_found,     a.bref_found);
+    EXPECT_EQ(e.bref,           a.bref);
+    EXPECT_EQ(e.fref_found,     a.fref_found);
+    EXPECT_EQ(e.fref,           a.fref);
+    EXPECT_EQ(e.codec_state.size, a.codec_state.size);
+
+    expect_same_frames(expected, actual, e, a);
+  }
+
+  EXPECT_EQ(3u,                          actual_blocks[1].num_frames);
+  EXPECT_EQ(995 * 100000,                actual_blocks[1].timecode);
+  EXPECT_EQ(4u,                          actual_blocks[2].num_frames);
+  EXPECT_EQ(3u,                          actual_blocks[3].num_frames);
+  EXPECT_EQ(-2,                          actual_blocks[4].bref);
+  EXPECT_EQ(5,                           actual_blocks[4].fref);
+  EXPECT_EQ(2u,                          actual_blocks[4].num_additions);
+}
+
+TEST(KaxClusterScanner, RejectsBrokenLacing) {
+  // The lace sizes exceed the block's size.
+  auto data = element(0x1f43b675, element(0xa3, block_header(1, 0, 0x02) + bytes_t{ 1, 200 } + frame(10, 0)));
+
+  mm_io_cptr in(new mm_mem_io_c(&data[0], data.size()));
+  kax_file_c file(in);
+  kax_cluster_scanner_c scanner;
+
+  EXPECT_FALSE(file.scan_next_cluster(scanner));
+  EXPECT_EQ(0u, in->getFilePointer());
+}
+
+}
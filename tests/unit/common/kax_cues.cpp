@@ -0,0 +1,143 @@
+#include "common/common_pch.h"
+
+#include <ebml/EbmlStream.h>
+
+#include "common/kax_cues.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef std::vector<unsigned char> bytes_t;
+
+bytes_t
+element(uint32_t id,
+        bytes_t const &content) {
+  bytes_t result;
+  for (int shift = 24; 0 <= shift; shift -= 8)
+    if ((id >> shift) || !result.empty())
+      result.push_back((id >> shift) & 0xff);
+
+  auto size = content.size();
+  if (0x7f > size)
+    result.push_back(0x80 | size);
+  else {
+    result.push_back(0x40 | (size >> 8));
+    result.push_back(size & 0xff);
+  }
+
+  result.insert(result.end(), content.begin(), content.end());
+  return result;
+}
+
+bytes_t
+uint_element(uint32_t id,
+             uint64_t value) {
+  bytes_t content;
+  do {
+    content.insert(content.begin(), value & 0xff);
+    value >>= 8;
+  } while (value);
+
+  return element(id, content);
+}
+
+bytes_t
+operator +(bytes_t a,
+           bytes_t const &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+bytes_t
+cue_track_positions(uint64_t track_number,
+                    uint64_t cluster_position) {
+  return element(0xb7, uint_element(0xf7, track_number) + uint_element(0xf1, cluster_position));
+}
+
+// Cue points for track 1 at 0, 1000 and 3000 and for track 2 at 0 and
+// 2000 (in ms). The last cue point lacks its cluster position.
+bytes_t
+create_segment_with_cues() {
+  auto cues =
+      element(0xbb, uint_element(0xb3,    0) + cue_track_positions(1,   100) + cue_track_positions(2, 100))
+    + element(0xbb, uint_element(0xb3, 1000) + cue_track_positions(1,  5000))
+    + element(0xbb, uint_element(0xb3, 2000) + cue_track_positions(2,  9000))
+    + element(0xbb, uint_element(0xb3, 3000) + cue_track_positions(1, 12000))
+    + element(0xbb, uint_element(0xb3, 4000) + element(0xb7, uint_element(0xf7, 1)));
+
+  return element(0x18538067, element(0x1c53bb6b, cues));
+}
+
+std::vector<kax_cue_point_t>
+create_cue_points() {
+  return std::vector<kax_cue_point_t>{
+    { 0,             100,   1 },
+    { 0,             100,   2 },
+    { 1000000000,    5000,  1 },
+    { 2000000000,    9000,  2 },
+    { 3000000000ll,  12000, 1 },
+  };
+}
+
+TEST(KaxCues, ReadCuePoints) {
+  auto bytes = create_segment_with_cues();
+  mm_io_cptr in(new mm_mem_io_c(&bytes[0], bytes.size()));
+  EbmlStream es(*in);
+
+  std::unique_ptr<EbmlElement> l0(es.FindNextID(EBML_INFO(KaxSegment), 0xFFFFFFFFFFFFFFFFLL));
+  ASSERT_TRUE(!!dynamic_cast<KaxSegment *>(l0.get()));
+
+  auto &segment = *static_cast<KaxSegment *>(l0.get());
+  kax_file_c file(in);
+
+  in->setFilePointer(0);
+  auto cue_points = read_cue_points(*in, file, segment.GetGlobalPosition(0), segment, 1000000);
+
+  EXPECT_EQ(0u, in->getFilePointer());
+
+  auto expected = create_cue_points();
+  ASSERT_EQ(expected.size(), cue_points.size());
+
+  for (size_t idx = 0; expected.size() > idx; ++idx) {
+    EXPECT_EQ(expected[idx].timecode,                                                  cue_points[idx].timecode);
+    EXPECT_EQ(static_cast<int64_t>(segment.GetGlobalPosition(expected[idx].position)), cue_points[idx].position);
+    EXPECT_EQ(expected[idx].track_number,                                              cue_points[idx].track_number);
+  }
+}
+
+TEST(KaxCues, RangeStartWithCues) {
+  auto cue_points  = create_cue_points();
+  auto all_tracks  = [](uint64_t) { return true; };
+  auto first_track = [](uint64_t track_number) { return 1 == track_number; };
+
+  auto start = find_range_start_cue_point(cue_points, 3500000000ll, first_track);
+  ASSERT_TRUE(!!start);
+  EXPECT_EQ(12000, start->position);
+
+  // Each track has to reach a key frame before the start.
+  start = find_range_start_cue_point(cue_points, 3500000000ll, all_tracks);
+  ASSERT_TRUE(!!start);
+  EXPECT_EQ(2000000000, start->timecode);
+  EXPECT_EQ(9000,       start->position);
+
+  start = find_range_start_cue_point(cue_points, 2500000000ll, all_tracks);
+  ASSERT_TRUE(!!start);
+  EXPECT_EQ(5000, start->position);
+
+  start = find_range_start_cue_point(cue_points, 1000000000, first_track);
+  ASSERT_TRUE(!!start);
+  EXPECT_EQ(5000, start->position);
+}
+
+TEST(KaxCues, RangeStartWithoutCues) {
+  auto all_tracks = [](uint64_t) { return true; };
+
+  EXPECT_EQ(nullptr, find_range_start_cue_point(std::vector<kax_cue_point_t>{}, 1000000000, all_tracks));
+
+  auto cue_points = create_cue_points();
+  EXPECT_EQ(nullptr, find_range_start_cue_point(cue_points, 1000000000, [](uint64_t track_number) { return 3 == track_number; }));
+  EXPECT_EQ(nullptr, find_range_start_cue_point(cue_points, -1,         all_tracks));
+}
+
+}
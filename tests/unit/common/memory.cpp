@@ -0,0 +1,79 @@
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Memory, PoolBlockSizes) {
+  EXPECT_EQ(32u,     mtx::mem::get_pool_block_size(0));
+  EXPECT_EQ(32u,     mtx::mem::get_pool_block_size(32));
+  EXPECT_EQ(40u,     mtx::mem::get_pool_block_size(33));
+  EXPECT_EQ(64u,     mtx::mem::get_pool_block_size(64));
+  EXPECT_EQ(80u,     mtx::mem::get_pool_block_size(65));
+  EXPECT_EQ(1792u,   mtx::mem::get_pool_block_size(1536 + 1));
+  EXPECT_EQ(2048u,   mtx::mem::get_pool_block_size(1792 + 1));
+  EXPECT_EQ(mtx::mem::max_pool_block_size,     mtx::mem::get_pool_block_size(mtx::mem::max_pool_block_size));
+  EXPECT_EQ(mtx::mem::max_pool_block_size + 1, mtx::mem::get_pool_block_size(mtx::mem::max_pool_block_size + 1));
+}
+
+TEST(Memory, CloneAndResize) {
+  unsigned char const data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+  auto mem = memory_c::clone(data, sizeof(data));
+  ASSERT_EQ(sizeof(data), mem->get_size());
+  EXPECT_EQ(0, memcmp(mem->get_buffer(), data, sizeof(data)));
+
+  // Growing beyond the pool block moves the buffer to the heap.
+  mem->add(data, sizeof(data));
+  mem->resize(100000);
+  EXPECT_EQ(100000u, mem->get_size());
+  EXPECT_EQ(0, memcmp(mem->get_buffer(),                data, sizeof(data)));
+  EXPECT_EQ(0, memcmp(mem->get_buffer() + sizeof(data), data, sizeof(data)));
+
+  mem->set_offset(2);
+  mem->resize(4);
+  EXPECT_EQ(4u, mem->get_size());
+  EXPECT_EQ(0, memcmp(mem->get_buffer(), &data[2], 4));
+}
+
+TEST(Memory, LockedBufferCanBeFreed) {
+  auto mem = memory_c::alloc(16);
+  memset(mem->get_buffer(), 42, 16);
+  mem->lock();
+
+  unsigned char *buffer = mem->get_buffer();
+  mem.reset();
+
+  EXPECT_EQ(42, buffer[15]);
+  free(buffer);
+}
+
+TEST(Memory, ViewsKeepTheirParentAlive) {
+  unsigned char const data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+  auto parent = memory_c::clone(data, sizeof(data));
+  auto view   = memory_c::view(parent, 2, 4);
+  parent.reset();
+
+  ASSERT_EQ(4u, view->get_size());
+  EXPECT_EQ(0, memcmp(view->get_buffer(), &data[2], 4));
+
+  // Growing the view copies the data instead of touching the parent.
+  view->set_offset(1);
+  view->add(data, 2);
+  ASSERT_EQ(5u, view->get_size());
+  EXPECT_EQ(0, memcmp(view->get_buffer(),     &data[3], 3));
+  EXPECT_EQ(0, memcmp(view->get_buffer() + 3, data,     2));
+}
+
+TEST(Memory, BuffersAreRecycled) {
+  auto mem                  = memory_c::alloc(1000);
+  unsigned char const *used = mem->get_buffer();
+  mem.reset();
+
+  EXPECT_EQ(used, memory_c::alloc(1000)->get_buffer());
+}
+
+}
@@ -0,0 +1,53 @@
+#include "common/common_pch.h"
+
+#include "common/mm_mmap_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+#if !defined(SYS_WINDOWS)
+
+TEST(MmMmapIo, ViewsOutliveTheFile) {
+  auto file_name = (bfs::temp_directory_path() / bfs::unique_path()).string();
+  std::string const content("0123456789abcdef");
+
+  {
+    mm_file_io_c out(file_name, MODE_CREATE);
+    out.write(content);
+  }
+
+  memory_cptr view;
+  {
+    mm_mmap_io_c in(file_name);
+    ASSERT_EQ(static_cast<int64_t>(content.length()), in.get_size());
+
+    in.setFilePointer(4);
+    view = in.read_view(6);
+    EXPECT_EQ(10u, in.getFilePointer());
+    EXPECT_THROW(in.read_view(7), mtx::mm_io::end_of_file_x);
+  }
+
+  ASSERT_EQ(6u, view->get_size());
+  EXPECT_EQ(0, memcmp(view->get_buffer(), "456789", 6));
+
+  // Views are read-only. Copies of them can be modified without the
+  // changes ending up in the file.
+  view->grab();
+  view->get_buffer()[0] = 'X';
+  EXPECT_EQ(0, memcmp(view->get_buffer(), "X56789", 6));
+  view.reset();
+
+  {
+    mm_file_io_c in(file_name);
+    std::string read_back;
+    in.read(read_back, content.length());
+    EXPECT_EQ(content, read_back);
+  }
+
+  bfs::remove(file_name);
+}
+
+#endif  // !SYS_WINDOWS
+
+}
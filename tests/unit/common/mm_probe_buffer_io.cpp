@@ -0,0 +1,70 @@
+#include "common/common_pch.h"
+
+#include "common/mm_probe_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+#include "tests/unit/util.h"
+
+namespace {
+
+class counting_mem_io_c: public mm_mem_io_c {
+public:
+  size_t m_num_bytes_read;
+
+  counting_mem_io_c(memory_c const &mem)
+    : mm_mem_io_c(mem)
+    , m_num_bytes_read(0)
+  {
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) {
+    auto num_read     = mm_mem_io_c::_read(buffer, size);
+    m_num_bytes_read += num_read;
+    return num_read;
+  }
+};
+
+TEST(MmProbeBufferIo, ReadsThePrefixOnlyOnce) {
+  auto pattern = mtxut::create_pattern(300000);
+  counting_mem_io_c file(*pattern);
+  mm_probe_buffer_io_c in(&file, 200000);
+
+  std::vector<unsigned char> buffer(150000);
+  int round;
+  for (round = 0; 5 > round; ++round) {
+    in.setFilePointer(0);
+    ASSERT_EQ(buffer.size(), in.read(&buffer[0], buffer.size()));
+    EXPECT_EQ(buffer.size(), in.getFilePointer());
+    EXPECT_TRUE(!memcmp(&buffer[0], pattern->get_buffer(), buffer.size()));
+  }
+
+  EXPECT_GE(200000u, file.m_num_bytes_read);
+}
+
+TEST(MmProbeBufferIo, ReadsBeyondThePrefix) {
+  auto pattern = mtxut::create_pattern(100000);
+  mm_probe_buffer_io_c in(new mm_mem_io_c(*pattern), 4096, true);
+
+  int64_t positions[] = { 10, 5000, 4000, 4095, 4096, 99990, 0, 50000, -1 };
+  unsigned char buffer[200];
+
+  for (int idx = 0; 0 <= positions[idx]; ++idx) {
+    in.setFilePointer(positions[idx]);
+    EXPECT_EQ(positions[idx], static_cast<int64_t>(in.getFilePointer()));
+
+    auto num_read = in.read(buffer, 200);
+    EXPECT_EQ(std::min<int64_t>(200, 100000 - positions[idx]), num_read);
+    EXPECT_TRUE(!memcmp(buffer, pattern->get_buffer() + positions[idx], num_read));
+  }
+
+  EXPECT_FALSE(in.eof());
+
+  in.setFilePointer(99950);
+  EXPECT_EQ(50u, in.read(buffer, 200));
+  EXPECT_TRUE(in.eof());
+  EXPECT_EQ(100000, in.get_size());
+}
+
+}
@@ -0,0 +1,92 @@
+#include "common/common_pch.h"
+
+#include "common/mm_read_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+#include "tests/unit/util.h"
+
+namespace {
+
+void
+test_sequential_reads(bool read_ahead) {
+  auto pattern = mtxut::create_pattern(100000);
+  mm_read_buffer_io_c in(new mm_mem_io_c(*pattern), 4096, true, read_ahead);
+
+  std::vector<unsigned char> buffer(100000);
+  size_t pos = 0;
+  for (size_t chunk = 1; pos < buffer.size(); chunk = (chunk * 3) % 9000 + 1) {
+    auto num_read = in.read(&buffer[pos], std::min(chunk, buffer.size() - pos));
+    ASSERT_GT(num_read, 0u);
+    pos += num_read;
+    EXPECT_EQ(pos, in.getFilePointer());
+  }
+
+  EXPECT_TRUE(!memcmp(&buffer[0], pattern->get_buffer(), buffer.size()));
+  EXPECT_EQ(0u, in.read(&buffer[0], 1));
+  EXPECT_TRUE(in.eof());
+}
+
+void
+test_seeking(bool read_ahead) {
+  auto pattern = mtxut::create_pattern(100000);
+  mm_read_buffer_io_c in(new mm_mem_io_c(*pattern), 4096, true, read_ahead);
+
+  int64_t positions[] = { 10, 5000, 4100, 8191, 8192, 99990, 0, 12289, 50000, 50001, 4096, -1 };
+  unsigned char buffer[200];
+
+  for (int idx = 0; 0 <= positions[idx]; ++idx) {
+    in.setFilePointer(positions[idx]);
+    EXPECT_EQ(positions[idx], static_cast<int64_t>(in.getFilePointer()));
+
+    auto num_read = in.read(buffer, 200);
+    EXPECT_EQ(std::min<int64_t>(200, 100000 - positions[idx]), num_read);
+    EXPECT_TRUE(!memcmp(buffer, pattern->get_buffer() + positions[idx], num_read));
+  }
+}
+
+void
+test_relative_seeking(bool read_ahead) {
+  auto pattern = mtxut::create_pattern(100000);
+  mm_read_buffer_io_c in(new mm_mem_io_c(*pattern), 4096, true, read_ahead);
+  unsigned char buffer[100];
+
+  EXPECT_EQ(100u, in.read(buffer, 100));
+
+  // Leave the current buffer while the data following it is read ahead.
+  in.setFilePointer(20000, seek_current);
+  EXPECT_EQ(20100u, in.getFilePointer());
+  EXPECT_EQ(100u,   in.read(buffer, 100));
+  EXPECT_TRUE(!memcmp(buffer, pattern->get_buffer() + 20100, 100));
+
+  in.setFilePointer(0, seek_end);
+  EXPECT_EQ(100000u, in.getFilePointer());
+  EXPECT_EQ(0u,      in.read(buffer, 1));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST(MmReadBufferIo, SequentialReads) {
+  test_sequential_reads(false);
+}
+
+TEST(MmReadBufferIo, SequentialReadsWithReadAhead) {
+  test_sequential_reads(true);
+}
+
+TEST(MmReadBufferIo, Seeking) {
+  test_seeking(false);
+}
+
+TEST(MmReadBufferIo, SeekingWithReadAhead) {
+  test_seeking(true);
+}
+
+TEST(MmReadBufferIo, RelativeSeeking) {
+  test_relative_seeking(false);
+}
+
+TEST(MmReadBufferIo, RelativeSeekingWithReadAhead) {
+  test_relative_seeking(true);
+}
+
+}
@@ -0,0 +1,87 @@
+#include "common/common_pch.h"
+
+#include "common/mm_write_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void
+test_writing(unsigned int num_async_buffers) {
+  auto mem_io = new mm_mem_io_c(nullptr, 0, 1000);
+  mm_write_buffer_io_c out(mem_io, 4096, false, num_async_buffers);
+
+  std::vector<unsigned char> expected;
+  for (size_t chunk = 1; expected.size() < 100000; chunk = (chunk * 3) % 9000 + 1) {
+    std::vector<unsigned char> data(chunk);
+    for (auto &c : data)
+      c = (expected.size() + (&c - &data[0])) & 0xff;
+
+    EXPECT_EQ(chunk, out.write(&data[0], chunk));
+    expected.insert(expected.end(), data.begin(), data.end());
+    EXPECT_EQ(expected.size(), out.getFilePointer());
+  }
+
+  // Overwrite data that has already been handed off.
+  out.setFilePointer(100);
+  EXPECT_EQ(100u, out.getFilePointer());
+  EXPECT_EQ(4u, out.write("abcd", 4));
+  memcpy(&expected[100], "abcd", 4);
+
+  out.setFilePointer(expected.size());
+  EXPECT_EQ(3u, out.write("xyz", 3));
+  expected.insert(expected.end(), { 'x', 'y', 'z' });
+
+  out.flush();
+
+  EXPECT_EQ(expected.size(), mem_io->getFilePointer());
+
+  std::vector<unsigned char> written(expected.size() + 1);
+  mem_io->setFilePointer(0);
+  EXPECT_EQ(expected.size(), mem_io->read(&written[0], written.size()));
+  EXPECT_TRUE(!memcmp(&expected[0], &written[0], expected.size()));
+
+  out.close();
+  delete mem_io;
+}
+
+class failing_mem_io_c: public mm_mem_io_c {
+public:
+  failing_mem_io_c()
+    : mm_mem_io_c(nullptr, 0, 1000)
+  {
+  }
+
+protected:
+  virtual size_t _write(const void *, size_t) {
+    throw mtx::mm_io::insufficient_space_x();
+  }
+};
+
+TEST(MmWriteBufferIo, Synchronous) {
+  test_writing(0);
+}
+
+TEST(MmWriteBufferIo, Asynchronous) {
+  test_writing(1);
+  test_writing(3);
+}
+
+TEST(MmWriteBufferIo, CloseReportsWriterErrors) {
+  mm_write_buffer_io_c out(new failing_mem_io_c, 4096, true, 2);
+
+  EXPECT_EQ(100u, out.write(std::string(100, 'x')));
+  EXPECT_THROW(out.close(), mtx::mm_io::insufficient_space_x);
+
+  EXPECT_THROW(out.write("abcd", 4), mtx::mm_io::wrong_read_write_access_x);
+  EXPECT_NO_THROW(out.close());
+}
+
+TEST(MmWriteBufferIo, DestructorSwallowsWriterErrors) {
+  EXPECT_NO_THROW({
+    mm_write_buffer_io_c out(new failing_mem_io_c, 4096, true, 2);
+    out.write(std::string(100, 'x'));
+  });
+}
+
+}
@@ -0,0 +1,124 @@
+#include "common/common_pch.h"
+
+#include <random>
+
+#include "common/start_code.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+unsigned char const *
+find_slowly(unsigned char const *begin,
+            unsigned char const *end,
+            std::vector<unsigned char> const &pattern) {
+  for (auto p = begin; (end - p) >= static_cast<ptrdiff_t>(pattern.size()); ++p)
+    if (std::equal(pattern.begin(), pattern.end(), p))
+      return p;
+
+  return end;
+}
+
+std::vector<unsigned char>
+create_data(size_t size,
+            unsigned int seed) {
+  // Mostly zeros and ones so that partial matches are frequent.
+  std::vector<unsigned char> data(size);
+  for (auto &c : data) {
+    seed = seed * 1103515245 + 12345;
+    auto r = (seed >> 16) % 8;
+    c = r < 5 ? 0x00 : r < 7 ? 0x01 : ((seed >> 8) & 0xff);
+  }
+
+  return data;
+}
+
+TEST(StartCode, Find) {
+  std::vector<unsigned char> const start_code{ 0x00, 0x00, 0x01 };
+
+  for (unsigned int seed = 0; 50 > seed; ++seed) {
+    auto data  = create_data(200, seed);
+    auto begin = &data[0];
+    auto end   = begin + data.size();
+
+    for (size_t offset = 0; 40 > offset; ++offset)
+      for (auto p = begin + offset; p < end; ++p) {
+        EXPECT_EQ(find_slowly(p, end, start_code), mtx::start_code::find(p, end));
+        if (find_slowly(p, end, start_code) == end)
+          break;
+        p = const_cast<unsigned char *>(find_slowly(p, end, start_code));
+      }
+  }
+}
+
+TEST(StartCode, FindAtBoundaries) {
+  std::vector<unsigned char> data(100, 0xff);
+  auto begin = &data[0];
+
+  for (size_t pos = 0; (data.size() - 3) >= pos; ++pos) {
+    std::fill(data.begin(), data.end(), 0xff);
+    data[pos]     = 0x00;
+    data[pos + 1] = 0x00;
+    data[pos + 2] = 0x01;
+
+    EXPECT_EQ(begin + pos,         mtx::start_code::find(begin, begin + data.size()));
+    EXPECT_EQ(begin + pos + 2,     mtx::start_code::find(begin, begin + pos + 2));
+    EXPECT_EQ(begin + data.size(), mtx::start_code::find(begin + pos + 1, begin + data.size()));
+  }
+
+  EXPECT_EQ(begin,     mtx::start_code::find(begin, begin));
+  EXPECT_EQ(begin + 2, mtx::start_code::find(begin, begin + 2));
+}
+
+TEST(StartCode, FindMarker) {
+  std::vector<unsigned char> const marker{ 0x00, 0x01, 0x00, 0x01 };
+
+  for (unsigned int seed = 0; 50 > seed; ++seed) {
+    auto data  = create_data(200, seed);
+    auto begin = &data[0];
+    auto end   = begin + data.size();
+
+    for (size_t offset = 0; 40 > offset; ++offset)
+      EXPECT_EQ(find_slowly(begin + offset, end, marker), mtx::start_code::find_marker(begin + offset, end, 0x00010001));
+  }
+
+  unsigned char const bbcd[] = "xxBBCBBCDyy";
+  EXPECT_EQ(&bbcd[5], mtx::start_code::find_marker(&bbcd[0], &bbcd[11], 0x42424344));
+  EXPECT_EQ(&bbcd[8], mtx::start_code::find_marker(&bbcd[0], &bbcd[8],  0x42424344));
+}
+
+TEST(StartCode, VectorizedMatchesScalar) {
+  // Random data with start codes and markers placed around the
+  // positions at which the vector loop moves on to the next chunk and
+  // at which it hands over to the scalar tail.
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> random_byte(0, 255);
+
+  for (int round = 0; 200 > round; ++round) {
+    std::vector<unsigned char> data(64 + round % 64);
+    for (auto &c : data)
+      c = random_byte(generator);
+
+    for (size_t chunk_end : std::vector<size_t>{ 16, 32, 48, 64, data.size() }) {
+      auto pos = chunk_end - std::min<size_t>(chunk_end, 1 + round % 4);
+      if ((pos + 4) > data.size())
+        continue;
+
+      data[pos]     = 0x00;
+      data[pos + 1] = 0x00;
+      data[pos + 2] = 0x01;
+      data[pos + 3] = 0xb3;
+    }
+
+    auto begin = &data[0];
+    auto end   = begin + data.size();
+
+    for (size_t offset = 0; data.size() > offset; ++offset)
+      for (auto last = begin + offset; last <= end; last += 7) {
+        EXPECT_EQ(mtx::start_code::find_scalar(begin + offset, last),                    mtx::start_code::find(begin + offset, last));
+        EXPECT_EQ(mtx::start_code::find_marker_scalar(begin + offset, last, 0x000001b3), mtx::start_code::find_marker(begin + offset, last, 0x000001b3));
+      }
+  }
+}
+
+}
@@ -0,0 +1,33 @@
+#include "common/common_pch.h"
+
+#include "common/strings/formatting.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(StringsFormatting, FormatTimecode) {
+  EXPECT_EQ("00:00:00.000000000", format_timecode(0));
+  EXPECT_EQ("01:02:03.004005006", format_timecode(3723004005006ll));
+  EXPECT_EQ("01:02:03.004",       format_timecode(3723004005006ll, 3));
+  EXPECT_EQ("01:02:03",           format_timecode(3723004005006ll, 0));
+  EXPECT_EQ("-00:00:01.5",        format_timecode(-1500000000ll, 1));
+  EXPECT_EQ("123:00:00.000",      format_timecode(442800000000000ll, 3));
+}
+
+TEST(StringsFormatting, ToStringWithPrecision) {
+  EXPECT_EQ("3",     to_string(30, 10, 1));
+  EXPECT_EQ("3.05",  to_string(305, 100, 2));
+  EXPECT_EQ("0.001", to_string(1, 1000, 3));
+  EXPECT_EQ("1.5",   to_string(1.5, 3));
+}
+
+TEST(StringsFormatting, ToHex) {
+  unsigned char const data[] = { 0x00, 0x0f, 0xa0, 0xff };
+
+  EXPECT_EQ("0x00 0x0f 0xa0 0xff", to_hex(data, sizeof(data), false));
+  EXPECT_EQ("000fa0ff",            to_hex(data, sizeof(data), true));
+  EXPECT_EQ("",                    to_hex(data, 0,            false));
+}
+
+}
@@ -0,0 +1,33 @@
+#include "common/common_pch.h"
+
+#include "common/thread_pool.h"
+
+#include "tests/unit/init.h"
+
+namespace {
+
+TEST(ThreadPool, RunsAllJobs) {
+  thread_pool_c pool(3);
+  std::vector<std::future<size_t> > results;
+
+  for (size_t idx = 0; 100 > idx; ++idx) {
+    auto task = std::make_shared< std::packaged_task<size_t()> >([idx]() { return idx * idx; });
+    results.push_back(task->get_future());
+    pool.enqueue([task]() { (*task)(); });
+  }
+
+  for (size_t idx = 0; results.size() > idx; ++idx)
+    EXPECT_EQ(idx * idx, get_job_result(results[idx]));
+}
+
+TEST(ThreadPool, ReportsErrorsOnTheCallingThread) {
+  thread_pool_c pool(1);
+
+  auto task   = std::make_shared< std::packaged_task<void()> >([]() { throw mtx::output::error_x("job failed"); });
+  auto result = task->get_future();
+  pool.enqueue([task]() { (*task)(); });
+
+  EXPECT_THROW(get_job_result(result), mtxut::mxerror_x);
+}
+
+}
@@ -66,6 +66,15 @@ dump(EbmlElement *element,
     dump(el, with_values, level + 1);
 }
 
+memory_cptr
+create_pattern(size_t size) {
+  auto mem = memory_c::alloc(size);
+  for (size_t idx = 0; idx < size; ++idx)
+    mem->get_buffer()[idx] = (idx * 7 + idx / 251) & 0xff;
+
+  return mem;
+}
+
 //
 // ----------------------------------------------------------------------
 //
@@ -30,6 +30,11 @@ using namespace libebml;
 
 void dump(EbmlElement *element, bool with_values = false, unsigned int level = 0);
 
+// Returns size bytes of data that doesn't repeat within small
+// distances, e.g. for checking that I/O classes read from the right
+// positions.
+memory_cptr create_pattern(size_t size);
+
 ::testing::AssertionResult EbmlEquals(char const *a_expr, char const *b_expr, EbmlElement &a, EbmlElement &b);
 
 class ebml_equals_c {